@@ -0,0 +1,51 @@
+#version 330 core
+
+// Deferred path, first lighting pass: every pixel, lit by the LightData lights the forward
+// uber-shader evaluates, shadowed where ShadowData says so. The scene's ranged lights are
+// added after it as light volumes.
+
+#include "include/frame_data.glsl"
+#include "include/light_data.glsl"
+#include "include/gbuffer.glsl"
+#include "include/shadows.glsl"
+
+out vec4 FragColor;
+
+void main()
+{
+    GBufferSample g = ReadGBuffer();
+    if (!g.covered) {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0); // the forward path's clear color
+        return;
+    }
+
+    // the view matrix is a rotation and a translation, so its inverse is cheap
+    mat3 viewToWorld = transpose(mat3(viewMatrix));
+    vec3 worldPos = viewToWorld * (g.position - viewMatrix[3].xyz);
+    vec3 worldNormal = viewToWorld * g.normal;
+
+    vec3 result = ShadeLight(g, normalize(mat3(viewMatrix) * -dirLight.direction), dirLight.ambientColor,
+                             dirLight.diffuseColor, dirLight.specularColor, CascadeShadow(worldPos, worldNormal));
+
+    for (int i = 0; i < pointLightCount; i++) {
+        PointLight light = pointLights[i];
+        vec3 toLight = (viewMatrix * vec4(light.position, 1.0)).xyz - g.position;
+        float d = length(toLight);
+        float attenuation = 1.0 / (light.constantAttTerm + light.linearAttTerm * d + light.quadraticAttTerm * d * d);
+        float shadow = i == 0 ? PointShadow(worldPos, worldNormal) : 1.0;
+        result += ShadeLight(g, toLight / d, light.ambientColor, light.diffuseColor, light.specularColor, shadow)
+            * attenuation;
+    }
+
+    vec3 toSpot = (viewMatrix * vec4(spotLight.position, 1.0)).xyz - g.position;
+    float spotDistance = length(toSpot);
+    vec3 spotDir = toSpot / spotDistance;
+    float theta = dot(spotDir, normalize(mat3(viewMatrix) * -spotLight.direction));
+    float intensity = clamp((theta - spotLight.outerCutOff) / (spotLight.cutOff - spotLight.outerCutOff), 0.0, 1.0);
+    float spotAttenuation = 1.0 / (spotLight.constantAttTerm + spotLight.linearAttTerm * spotDistance
+                                   + spotLight.quadraticAttTerm * spotDistance * spotDistance);
+    result += ShadeLight(g, spotDir, spotLight.ambientColor, spotLight.diffuseColor, spotLight.specularColor, 1.0)
+        * spotAttenuation * intensity;
+
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,34 @@
+#version 330 core
+
+// Depth pre-pass (see DepthPrepass): only the alpha test of fragmentShaderPhong.glsl, so
+// cutouts leave the same holes in the depth buffer as in the shaded image.
+// With OVERDRAW it is the overdraw view instead: drawn additively in place of the scene's
+// shaders, each fragment adds a step that saturates red at 8 layers, green at 16 and blue
+// at 32, so the image runs from black through red and yellow to white.
+// With LIGHT_DISTANCE it draws a point light's cube shadow map (see ShadowMaps), storing
+// the distance to the light over its range rather than the depth of the face's projection.
+
+uniform sampler2D texture_diffuse0;
+
+in vec2 TexCoords;
+
+#ifdef LIGHT_DISTANCE
+in vec3 FragPos;
+uniform vec4 lightPositionRange;
+#endif
+
+#ifdef OVERDRAW
+out vec4 FragColor;
+#endif
+
+void main()
+{
+    if (texture(texture_diffuse0, TexCoords).a < 0.1)
+        discard;
+#ifdef LIGHT_DISTANCE
+    gl_FragDepth = length(FragPos - lightPositionRange.xyz) / lightPositionRange.w;
+#endif
+#ifdef OVERDRAW
+    FragColor = vec4(1.0 / 8.0, 1.0 / 16.0, 1.0 / 32.0, 1.0);
+#endif
+}
@@ -0,0 +1,29 @@
+#version 330 core
+
+// Geometry pass of the deferred path: the material and surface of the nearest fragment,
+// for the lighting passes to shade (see include/gbuffer.glsl).
+
+uniform sampler2D texture_diffuse0;
+uniform sampler2D texture_specular0;
+
+#include "include/frame_data.glsl"
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+in vec4 Tint;
+
+layout (location = 0) out vec4 gAlbedoSpecular;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out float gDepth;
+
+void main()
+{
+    vec4 diffuse = texture(texture_diffuse0, TexCoords);
+    if (diffuse.a < 0.1)
+        discard;
+
+    gAlbedoSpecular = vec4(diffuse.rgb * Tint.rgb, texture(texture_specular0, TexCoords).r);
+    gNormal = vec4(normalize(mat3(viewMatrix) * Normal), 0.0);
+    gDepth = -(viewMatrix * vec4(FragPos, 1.0)).z;
+}
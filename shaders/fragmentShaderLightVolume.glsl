@@ -0,0 +1,28 @@
+#version 330 core
+
+// Deferred path: adds one ranged light to the pixels its volume covers. The volume's back
+// faces are depth tested against the scene, so pixels whose surface lies beyond the sphere
+// never get here; the ones in front of it are rejected by distance.
+
+#include "include/frame_data.glsl"
+#include "include/gbuffer.glsl"
+#include "include/light_range.glsl"
+
+flat in vec3 LightPosition;
+flat in float LightRadius;
+flat in vec3 LightColor;
+
+out vec4 FragColor;
+
+void main()
+{
+    GBufferSample g = ReadGBuffer();
+    vec3 toLight = LightPosition - g.position;
+    float d = length(toLight);
+    if (!g.covered || d >= LightRadius)
+        discard;
+
+    // the clustered path's colors, see include/clustered_lights.glsl
+    vec3 light = ShadeLight(g, toLight / d, LightColor * 0.02, LightColor * 0.6, LightColor, 1.0);
+    FragColor = vec4(light * CalcRangeAttenuation(d, LightRadius), 0.0);
+}
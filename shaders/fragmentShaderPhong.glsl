@@ -1,59 +1,27 @@
 #version 330 core
 
+// Lights are compiled in per variant: DIRECTIONAL_LIGHT, POINT_LIGHTS, SPOT_LIGHT and
+// CLUSTERED_LIGHTS (see phong_features.h). With the first three this is the uber-shader.
+// SHADOWS shadows the directional light and the first point light.
+
 // material textures
 uniform sampler2D texture_diffuse0;
 uniform sampler2D texture_specular0;
 uniform float shininess;
 
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-
-    vec3 ambientColor;
-    vec3 diffuseColor;
-    vec3 specularColor;
-
-    float constantAttTerm;
-    float linearAttTerm;
-    float quadraticAttTerm;
-};
-
-struct DirLight {
-    vec3 direction;
-
-    vec3 ambientColor;
-    vec3 diffuseColor;
-    vec3 specularColor;
-};
-
-struct PointLight {
-    vec3 position;
-
-    vec3 ambientColor;
-    vec3 diffuseColor;
-    vec3 specularColor;
-
-    float constantAttTerm;
-    float linearAttTerm;
-    float quadraticAttTerm;
-};
-#define NR_POINT_LIGHTS 1
+#include "include/light_data.glsl"
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+in vec4 Tint;
 
 out vec4 FragColor;
 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform SpotLight spotLight;
+#include "include/frame_data.glsl"
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, float shadow);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, float shadow);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 vec3 CalcAmbient(vec3 ambientColor);
@@ -61,6 +29,13 @@ vec3 CalcDiffuse(vec3 diffuseColor, vec3 lightDir, vec3 normal);
 vec3 CalcSpecular(vec3 specularColor, vec3 reflectionDir, vec3 viewDir);
 float CalcAttenuation(vec3 position, vec3 fragPos, float constantAttTerm, float linearAttTerm, float quadraticAttTerm);
 
+#ifdef CLUSTERED_LIGHTS
+#include "include/clustered_lights.glsl"
+#endif
+#ifdef SHADOWS
+#include "include/shadows.glsl"
+#endif
+
 void main()
 {
     float alpha = texture(texture_diffuse0, TexCoords).a;
@@ -69,16 +44,35 @@ void main()
 
     vec3 normal = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
-    vec3 result = CalcDirLight(dirLight, normal, viewDir);
-    for (int i = 0; i < NR_POINT_LIGHTS; i++) {
-        result += CalcPointLight(pointLights[i], normal, FragPos, viewDir);
+    vec3 result = vec3(0.0);
+#ifdef DIRECTIONAL_LIGHT
+    float dirShadow = 1.0;
+#ifdef SHADOWS
+    dirShadow = CascadeShadow(FragPos, normal);
+#endif
+    result += CalcDirLight(dirLight, normal, viewDir, dirShadow);
+#endif
+#ifdef POINT_LIGHTS
+    for (int i = 0; i < pointLightCount; i++) {
+        float shadow = 1.0;
+#ifdef SHADOWS
+        if (i == 0)
+            shadow = PointShadow(FragPos, normal);
+#endif
+        result += CalcPointLight(pointLights[i], normal, FragPos, viewDir, shadow);
     }
+#endif
+#ifdef SPOT_LIGHT
     result += CalcSpotLight(spotLight, normal, FragPos, viewDir);
+#endif
+#ifdef CLUSTERED_LIGHTS
+    result += CalcClusteredLights(normal, FragPos, viewDir);
+#endif
 
-    FragColor = vec4(result, texture(texture_diffuse0, TexCoords).a);
+    FragColor = vec4(result, texture(texture_diffuse0, TexCoords).a) * Tint;
 }
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, float shadow)
 {
     vec3 lightDir = normalize(-light.direction);
 
@@ -86,7 +80,7 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 diffuse = CalcDiffuse(light.diffuseColor, lightDir, normal);
     vec3 specular = CalcSpecular(light.specularColor, reflect(-lightDir, normal), viewDir);
 
-    return ambient + diffuse + specular;
+    return ambient + (diffuse + specular) * shadow;
 }
 
 vec3 CalcAmbient(vec3 ambientColor)
@@ -112,7 +106,7 @@ float CalcAttenuation(vec3 position, vec3 fragPos, float constantAttTerm, float
     return 1.0 / (constantAttTerm + linearAttTerm*d + quadraticAttTerm*d*d);
 }
 
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, float shadow)
 {
     vec3 lightDir = normalize(light.position - fragPos);
     vec3 reflectionDir = reflect(-lightDir, normal);
@@ -122,7 +116,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     vec3 specular = CalcSpecular(light.specularColor, reflectionDir, viewDir);
 
     float attenuation = CalcAttenuation(light.position, fragPos, light.constantAttTerm, light.linearAttTerm, light.quadraticAttTerm);
-    return (ambient + diffuse + specular) * attenuation;
+    return (ambient + (diffuse + specular) * shadow) * attenuation;
 }
 
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
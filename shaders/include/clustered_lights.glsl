@@ -0,0 +1,42 @@
+// Lights binned per view-space cluster by LightClusters (light_clusters.h); needs FrameData
+// and the Calc* helpers of the including shader.
+
+uniform samplerBuffer clusterLights;        // (position, radius) then (color, 0) per light
+uniform usamplerBuffer clusterRanges;       // first index and count per cluster
+uniform usamplerBuffer clusterLightIndices;
+
+layout (std140) uniform ClusterData
+{
+    uvec4 clusterGrid;  // tiles across and down, depth slices, lights
+    vec4 clusterScale;  // tiles per pixel across and down, then the depth slice scale and bias
+};
+
+#include "light_range.glsl"
+
+vec3 CalcClusteredLights(vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    float depth = -(viewMatrix * vec4(fragPos, 1.0)).z;
+    float slice = max(log(depth) * clusterScale.z + clusterScale.w, 0.0);
+    uvec3 cluster = min(uvec3(uvec2(gl_FragCoord.xy * clusterScale.xy), uint(slice)), clusterGrid.xyz - 1u);
+    int clusterIndex = int(cluster.x + clusterGrid.x * (cluster.y + clusterGrid.y * cluster.z));
+    uvec2 range = texelFetch(clusterRanges, clusterIndex).xy;
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < range.y; i++) {
+        int light = int(texelFetch(clusterLightIndices, int(range.x + i)).x);
+        vec4 positionRadius = texelFetch(clusterLights, 2 * light);
+        vec3 color = texelFetch(clusterLights, 2 * light + 1).rgb;
+
+        vec3 toLight = positionRadius.xyz - fragPos;
+        float d = length(toLight);
+        if (d >= positionRadius.w)
+            continue;
+        vec3 lightDir = toLight / d;
+
+        vec3 ambient = CalcAmbient(color * 0.02);
+        vec3 diffuse = CalcDiffuse(color * 0.6, lightDir, normal);
+        vec3 specular = CalcSpecular(color, reflect(-lightDir, normal), viewDir);
+        result += (ambient + diffuse + specular) * CalcRangeAttenuation(d, positionRadius.w);
+    }
+    return result;
+}
@@ -0,0 +1,8 @@
+// FrameData in uniform_blocks.h
+layout (std140) uniform FrameData
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    vec3 viewPos;
+    float time;
+};
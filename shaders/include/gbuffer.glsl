@@ -0,0 +1,43 @@
+// The G-buffer of DeferredRenderer (deferred_renderer.h), read one pixel at a time by the
+// lighting passes; needs FrameData. Everything is in view space.
+
+uniform sampler2D gAlbedoSpecular; // diffuse color, specular intensity
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;          // distance along the view direction, 0 where nothing was drawn
+uniform float shininess;
+
+struct GBufferSample {
+    vec3 albedo;
+    float specular;
+    vec3 normal;
+    vec3 position;
+    bool covered;
+};
+
+GBufferSample ReadGBuffer()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    GBufferSample g;
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    g.covered = depth > 0.0;
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+    g.albedo = albedoSpecular.rgb;
+    g.specular = albedoSpecular.a;
+    g.normal = g.covered ? normalize(texelFetch(gNormal, pixel, 0).xyz) : vec3(0.0, 0.0, 1.0);
+
+    // back along the pixel's ray; the projection is symmetric, so only its scale matters
+    vec2 ndc = gl_FragCoord.xy / vec2(textureSize(gDepth, 0)) * 2.0 - 1.0;
+    g.position = vec3(ndc.x / projectionMatrix[0][0], ndc.y / projectionMatrix[1][1], -1.0) * depth;
+    return g;
+}
+
+// fragmentShaderPhong.glsl's terms, with the material read back from the G-buffer; the
+// shadow dims all but the ambient term
+vec3 ShadeLight(GBufferSample g, vec3 lightDir, vec3 ambientColor, vec3 diffuseColor, vec3 specularColor, float shadow)
+{
+    vec3 viewDir = normalize(-g.position);
+    vec3 ambient = ambientColor * g.albedo;
+    vec3 diffuse = diffuseColor * max(dot(g.normal, lightDir), 0.0) * g.albedo;
+    float spec = pow(max(dot(viewDir, reflect(-lightDir, g.normal)), 0.0), shininess);
+    return ambient + (diffuse + specularColor * spec * g.specular) * shadow;
+}
@@ -0,0 +1,44 @@
+// LightData in uniform_blocks.h. Every variant declares the whole block, so one buffer
+// serves them all; MAX_POINT_LIGHTS is defined by the shader preprocessor.
+
+// light structs are laid out so every vec3 shares a std140 slot with a float
+struct SpotLight {
+    vec3 position;
+    float cutOff;
+    vec3 direction;
+    float outerCutOff;
+
+    vec3 ambientColor;
+    float constantAttTerm;
+    vec3 diffuseColor;
+    float linearAttTerm;
+    vec3 specularColor;
+    float quadraticAttTerm;
+};
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambientColor;
+    vec3 diffuseColor;
+    vec3 specularColor;
+};
+
+struct PointLight {
+    vec3 position;
+    float constantAttTerm;
+
+    vec3 ambientColor;
+    float linearAttTerm;
+    vec3 diffuseColor;
+    float quadraticAttTerm;
+    vec3 specularColor;
+};
+
+layout (std140) uniform LightData
+{
+    DirLight dirLight;
+    PointLight pointLights[MAX_POINT_LIGHTS];
+    SpotLight spotLight;
+    int pointLightCount;
+};
@@ -0,0 +1,7 @@
+// The point lights' falloff, windowed to reach zero at the light's radius; for the lights
+// with a hard range (ClusterLight), whichever path shades them.
+float CalcRangeAttenuation(float d, float radius)
+{
+    float window = clamp(1.0 - pow(d / radius, 4.0), 0.0, 1.0);
+    return window * window / (1.0 + 0.09 * d + 0.032 * d * d);
+}
@@ -0,0 +1,40 @@
+// ShadowData in uniform_blocks.h and the maps ShadowMaps (shadow_maps.h) renders; needs
+// FrameData. Positions and normals are in world space; SHADOW_CASCADES is defined by the
+// shader preprocessor.
+layout (std140) uniform ShadowData
+{
+    mat4 cascadeMatrices[SHADOW_CASCADES];
+    vec4 cascadeSplits;     // view distance each cascade reaches, 0 with shadows off
+    vec4 cascadeTexelSizes;
+    vec4 pointShadow;       // position of pointLights[0], then its shadow range, 0 without one
+};
+
+uniform sampler2DArrayShadow cascadeShadowMap;
+uniform samplerCubeShadow pointShadowMap;
+
+// 1 where dirLight reaches the surface, 0 in its shadow, filtered in between
+float CascadeShadow(vec3 worldPos, vec3 normal)
+{
+    float viewDistance = -(viewMatrix * vec4(worldPos, 1.0)).z;
+    for (int i = 0; i < SHADOW_CASCADES; i++) {
+        if (viewDistance < cascadeSplits[i]) {
+            // about a texel out along the normal, so a surface doesn't shadow itself
+            vec3 offsetPos = worldPos + normal * cascadeTexelSizes[i] * 1.5;
+            vec3 coords = (cascadeMatrices[i] * vec4(offsetPos, 1.0)).xyz * 0.5 + 0.5;
+            return texture(cascadeShadowMap, vec4(coords.xy, float(i), coords.z));
+        }
+    }
+    return 1.0;
+}
+
+float PointShadow(vec3 worldPos, vec3 normal)
+{
+    if (pointShadow.w <= 0.0)
+        return 1.0;
+    // the map holds the distance to the light over the range, see fragmentShaderDepthOnly.glsl
+    vec3 fromLight = worldPos + normal * 0.02 - pointShadow.xyz;
+    float reference = length(fromLight) / pointShadow.w;
+    if (reference >= 1.0)
+        return 1.0;
+    return texture(pointShadowMap, vec4(fromLight, reference - 0.002));
+}
@@ -3,19 +3,32 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in mat4 aInstanceMatrix; // locations 3..6, advanced per instance
+layout (location = 7) in vec4 aInstanceTint;
+
+#include "include/frame_data.glsl"
 
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+uniform vec4 tint;
+uniform bool instanced; // set by Model::drawInstanced and the render queue
+uniform vec3 positionScale;  // quantized positions arrive in [0, 1] and are mapped back into the mesh bounds
+uniform vec3 positionOffset;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+out vec4 Tint;
+// every program drawing with this shader must put a vertex at exactly the same depth, or the
+// shading pass after a depth pre-pass (GL_LEQUAL, see DepthPrepass) would lose fragments
+invariant gl_Position;
 
 void main()
 {
-    gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(aPos, 1.0);
-    FragPos = vec3(modelMatrix * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(modelMatrix))) * aNormal; // normal matrix required, see chapter 13 section 5
+    mat4 model = instanced ? aInstanceMatrix : modelMatrix;
+    vec3 position = positionOffset + positionScale * aPos;
+    gl_Position = projectionMatrix * viewMatrix * model * vec4(position, 1.0);
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal; // normal matrix required, see chapter 13 section 5
     TexCoords = aTexCoords;
+    Tint = instanced ? aInstanceTint : tint;
 }
@@ -0,0 +1,20 @@
+#version 330 core
+
+// Deferred path: one sphere per ranged light, drawn instanced around the pixels it can reach.
+layout (location = 0) in vec3 aPos;            // a unit sphere, enlarged to enclose the true one
+layout (location = 1) in vec4 aPositionRadius; // per instance, a ClusterLight
+layout (location = 2) in vec3 aColor;
+
+#include "include/frame_data.glsl"
+
+flat out vec3 LightPosition; // view space
+flat out float LightRadius;
+flat out vec3 LightColor;
+
+void main()
+{
+    gl_Position = projectionMatrix * viewMatrix * vec4(aPositionRadius.xyz + aPos * aPositionRadius.w, 1.0);
+    LightPosition = (viewMatrix * vec4(aPositionRadius.xyz, 1.0)).xyz;
+    LightRadius = aPositionRadius.w;
+    LightColor = aColor;
+}
@@ -0,0 +1,24 @@
+#version 330 core
+
+// Shadow casters (see ShadowMaps): vertexShaderDefault.glsl's inputs, seen from the light.
+
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in mat4 aInstanceMatrix; // locations 3..6, advanced per instance
+
+uniform mat4 lightMatrix; // world to the cascade's or cube face's clip space
+uniform mat4 modelMatrix;
+uniform bool instanced;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+out vec3 FragPos;
+out vec2 TexCoords;
+
+void main()
+{
+    mat4 model = instanced ? aInstanceMatrix : modelMatrix;
+    FragPos = vec3(model * vec4(positionOffset + positionScale * aPos, 1.0));
+    gl_Position = lightMatrix * vec4(FragPos, 1.0);
+    TexCoords = aTexCoords;
+}
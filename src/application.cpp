@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
 #include <iostream>
 #include <vector>
 
@@ -5,201 +9,741 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "application.h"
+#include "lib/allocation_counter.h"
+#include "render/asset_loader.h"
+#include "render/gl_state.h"
+#include "render/program_cache.h"
 
-void Application::run()
+void Application::run(const SessionSettings &settings)
 {
-    startup();
+    startup(settings);
     while (!glfwWindowShouldClose(window))
     {
+        auto frameBegin = std::chrono::steady_clock::now();
         process();
+        if (inputReplay && !glfwWindowShouldClose(window)) // the frame after the log ran out doesn't count
+        {
+            std::chrono::duration<float, std::milli> frameTime = std::chrono::steady_clock::now() - frameBegin;
+            replayFrameMilliseconds.push_back(frameTime.count());
+        }
     }
+    if (inputReplay)
+        printReplaySummary();
     cleanup();
 }
 
-void Application::startup()
+HeadlessResult Application::runHeadless(const HeadlessSettings &settings)
+{
+    HeadlessResult result;
+    headless = true;
+    renderPath = settings.renderPath;
+    if (!createContext(settings.osmesa))
+        return result;
+    if (!initRenderer() || !createOffscreenTarget(settings.width, settings.height))
+    {
+        cleanup();
+        return result;
+    }
+    result.renderer = (const char *)glGetString(GL_RENDERER);
+    result.version = (const char *)glGetString(GL_VERSION);
+
+    initShaders();
+    GeneratedScene scene = generateScene(settings.scene);
+    linkShaders();
+    CameraPath cameraPath = scene.cameraPath;
+    loadGeneratedScene(std::move(scene));
+    initFrameState();
+    depthPrepass->enabled = settings.depthPrepass;
+    shadowMaps->enabled = shadowMaps->enabled && settings.shadows; // stays off if the maps couldn't be made
+    shadowMaps->caching = settings.shadowCaching;
+
+    std::uint64_t draws = 0, triangles = 0;
+    double shadedPerPixel = 0.0;
+    std::uint64_t shadowMapsRendered = 0, shadowMapsSkipped = 0;
+    result.frameMilliseconds.reserve(settings.frames);
+
+    // the moving caster sways about its anchor, so every frame is a change
+    constexpr float CASTER_SWAY = 0.25f;
+    bool moveCaster = settings.movingCaster != MOVING_CASTER_NONE && !sceneObjects.empty();
+    glm::mat4 anchoredTransform(1.0f);
+    if (moveCaster)
+    {
+        glm::vec3 anchor = pointLightPos + glm::vec3(1.5f, 0.0f, 0.0f);
+        if (settings.movingCaster == MOVING_CASTER_FAR)
+        {
+            // sideways to the sun, so no cascade can reach it along the light either
+            glm::vec3 side = std::abs(SUN_DIRECTION.y) > 0.99f
+                ? glm::vec3(1.0f, 0.0f, 0.0f)
+                : glm::normalize(glm::cross(SUN_DIRECTION, glm::vec3(0.0f, 1.0f, 0.0f)));
+            float reach = ShadowMaps::SHADOW_DISTANCE + ShadowMaps::POINT_SHADOW_RANGE;
+            anchor = shadowCasterBounds.center() + side * (glm::length(shadowCasterBounds.extent()) + 4.0f * reach);
+        }
+        const SceneObject &object = sceneObjects[0];
+        anchoredTransform = glm::translate(glm::mat4(1.0f), anchor - object.worldBounds.center()) * object.transform;
+
+        // the whole sway counts as casters from the start, so the cascades are fitted to it once
+        AABB swept = object.model->getBounds().transformed(anchoredTransform);
+        swept.min.x -= CASTER_SWAY;
+        swept.max.x += CASTER_SWAY;
+        shadowCasterBounds.expand(swept);
+        shadowMaps->setCasterBounds(shadowCasterBounds);
+    }
+
+    for (unsigned int frame = 0; frame < settings.warmupFrames + settings.frames; frame++)
+    {
+        // the measured frames fly the whole loop; warm-up frames fly its start ahead of them
+        unsigned int pathFrame = frame < settings.warmupFrames ? frame : frame - settings.warmupFrames;
+        cameraPath.apply((float)pathFrame / (float)settings.frames, cam);
+        scriptedTime = (float)frame / HEADLESS_FRAME_RATE;
+        if (moveCaster)
+        {
+            glm::vec3 sway(CASTER_SWAY * std::sin(0.3f * (float)frame), 0.0f, 0.0f);
+            moveSceneObject(0, glm::translate(glm::mat4(1.0f), sway) * anchoredTransform);
+        }
+
+        auto frameBegin = std::chrono::steady_clock::now();
+        process();
+        std::chrono::duration<float, std::milli> frameTime = std::chrono::steady_clock::now() - frameBegin;
+        if (frame < settings.warmupFrames)
+            continue;
+
+        result.frameMilliseconds.push_back(frameTime.count());
+        draws += renderQueue.stats().draws + overlayQueue.stats().draws;
+        triangles += renderQueue.stats().triangles + overlayQueue.stats().triangles;
+        // a few frames behind, but every frame is finished, so none is dropped
+        shadedPerPixel += depthPrepass->stats().shadedPerPixel;
+        shadowMapsRendered += shadowMaps->stats().rendered;
+        shadowMapsSkipped += shadowMaps->stats().skipped;
+        result.frameAllocations += frameAllocations;
+    }
+
+    result.drawsPerFrame = (double)draws / settings.frames;
+    result.trianglesPerFrame = (double)triangles / settings.frames;
+    result.shadedSamplesPerPixel = shadedPerPixel / settings.frames;
+    result.shadowMapsRenderedPerFrame = (double)shadowMapsRendered / settings.frames;
+    result.shadowMapsSkippedPerFrame = (double)shadowMapsSkipped / settings.frames;
+    for (ProfileZoneId zone = 0; zone < profiler->zoneCount(); zone++)
+        result.zones.emplace_back(profiler->zoneName(zone), profiler->stats(zone));
+    result.ok = true;
+
+    cleanup();
+    return result;
+}
+
+void Application::startup(const SessionSettings &settings)
+{
+    auto startupBegin = std::chrono::steady_clock::now();
+
+    if (!createContext(false))
+        return;
+
+    input.emplace(window);
+    actions.moveForward = input->createAction("move_forward", {GLFW_KEY_W});
+    actions.moveBackward = input->createAction("move_backward", {GLFW_KEY_S});
+    actions.moveLeft = input->createAction("move_left", {GLFW_KEY_A});
+    actions.moveRight = input->createAction("move_right", {GLFW_KEY_D});
+    actions.moveUp = input->createAction("move_up", {GLFW_KEY_SPACE});
+    actions.moveDown = input->createAction("move_down", {GLFW_KEY_LEFT_SHIFT});
+    actions.quit = input->createAction("quit", {GLFW_KEY_ESCAPE});
+    actions.toggleWireframe = input->createAction("toggle_wireframe", {GLFW_KEY_LEFT_ALT});
+    actions.toggleLightMode = input->createAction("toggle_light_mode", {GLFW_KEY_Q});
+    actions.toggleLightPlacement = input->createAction("toggle_light_placement", {GLFW_KEY_E});
+    actions.toggleFlashlight = input->createAction("toggle_flashlight", {GLFW_KEY_F});
+    actions.printRenderStats = input->createAction("print_render_stats", {GLFW_KEY_I});
+    actions.toggleLod = input->createAction("toggle_lod", {GLFW_KEY_L});
+    actions.toggleProfileCapture = input->createAction("toggle_profile_capture", {GLFW_KEY_P});
+    actions.toggleRenderPath = input->createAction("toggle_render_path", {GLFW_KEY_R});
+    actions.toggleDepthPrepass = input->createAction("toggle_depth_prepass", {GLFW_KEY_Z});
+    actions.toggleOverdraw = input->createAction("toggle_overdraw", {GLFW_KEY_O});
+    actions.toggleShadows = input->createAction("toggle_shadows", {GLFW_KEY_H});
+
+    if (!settings.replayPath.empty())
+    {
+        inputReplay.emplace(settings.replayPath);
+        if (!inputReplay->valid())
+        {
+            std::cout << "ERROR::INPUT_REPLAY::LOAD_FAILED " << settings.replayPath << std::endl;
+            inputReplay.reset();
+        }
+        else
+        {
+            replayFrameMilliseconds.reserve(inputReplay->frameCount());
+            std::cout << "input: replaying " << inputReplay->frameCount() << " frames from " << settings.replayPath
+                << std::endl;
+        }
+    }
+    else if (!settings.recordPath.empty())
+    {
+        inputRecorder.emplace(settings.recordPath);
+        if (!inputRecorder->valid())
+        {
+            std::cout << "ERROR::INPUT_RECORDER::OPEN_FAILED " << settings.recordPath << std::endl;
+            inputRecorder.reset();
+        }
+    }
+
+    if (!initRenderer())
+        return;
+
+    /* 3. OpenGL: Initializing shaders and objects */
+    // models parse and decode on worker threads while this thread compiles shaders
+    auto modelsBegin = std::chrono::steady_clock::now();
+    AssetLoader loader(*geometry, ThreadPool::defaultWorkerCount(), &*uploadStreamer);
+    loader.loadModel(backpack, "assets/models/backpack/backpack.obj");
+    loader.loadModel(container, "assets/models/container/container.obj");
+    loader.loadModel(cube, "assets/models/cube/cube.obj");
+    loader.loadModel(grass, "assets/models/grass/grass.obj", GL_CLAMP_TO_EDGE);
+    loader.loadModel(transparentWindow, "assets/models/window/window.obj", GL_CLAMP_TO_EDGE);
+
+    initShaders();
+
+    /* 3.2 Model upload */
+    loader.finish();
+    std::chrono::duration<double, std::milli> modelLoadTime = std::chrono::steady_clock::now() - modelsBegin;
+    linkShaders();
+
+    unsigned int cachedModels = 0, totalModels = 0;
+    const char *modelNames[] = { "draw backpack", "draw container", "draw cube", "draw grass", "draw window" };
+    unsigned int modelIndex = 0;
+    for (auto *model : { &backpack, &container, &cube, &grass, &transparentWindow })
+    {
+        (*model)->setProfileZone(profiler->zone(modelNames[modelIndex++], true));
+        (*model)->releaseCpuData();
+        cachedModels += (*model)->loadedFromCache() ? 1 : 0;
+        totalModels++;
+    }
+
+    for (unsigned int i = 0; i < grassPositions.size(); i++)
+    {
+        auto modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-5.0f, 0.0f, -1.0f));
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        grassTransforms.push_back(modelMatrix);
+    }
+
+    sceneObjects = {
+        { &*backpack, glm::mat4(1.0f), PASS_OPAQUE },
+        { &*container, glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, 0.0f, 0.0f)), PASS_OPAQUE },
+        { &*transparentWindow, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 2.0f)), PASS_TRANSPARENT },
+    };
+    buildSceneCuller();
+
+    /* 4. Prepare for main loop */
+    initFrameState();
+
+    // a cold start imports through Assimp and cooks the mesh cache; a warm one maps it. Models are
+    // only allocated by now, their contents stream in during the first frames.
+    std::chrono::duration<double, std::milli> startupTime = std::chrono::steady_clock::now() - startupBegin;
+    std::cout << "startup: " << startupTime.count() << " ms (models ready after " << modelLoadTime.count() << " ms on "
+        << loader.workerCount() << " workers, " << cachedModels << "/" << totalModels << " from the mesh cache, "
+        << (cachedModels == totalModels ? "warm" : "cold") << " start), textures "
+        << Texture::uploadedBytes() / (1024.0 * 1024.0) << " MiB" << std::endl;
+}
+
+bool Application::createContext(bool osmesa)
 {
     /* 1. GLFW: Set up context */
-    glfwInit();
+#ifdef GLFW_PLATFORM_NULL
+    // headless runs need no display server: GLFW's null platform with a surfaceless EGL or an OSMesa context
+    if (headless)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+    if (!glfwInit())
+    {
+        std::cout << "Failed to initialize GLFW" << std::endl;
+        return false;
+    }
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (headless)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, osmesa ? GLFW_OSMESA_CONTEXT_API : GLFW_EGL_CONTEXT_API);
+    }
 
-    window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "LearnOpenGL - Dowsley", nullptr, nullptr);
+    // a headless window only carries the context; frames go to the offscreen framebuffer
+    window = headless ? glfwCreateWindow(64, 64, "LearnOpenGL - headless", nullptr, nullptr)
+                      : glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "LearnOpenGL - Dowsley", nullptr, nullptr);
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
-        return;
+        return false;
     }
     glfwMakeContextCurrent(window);
     glfwSetWindowUserPointer(window, this);
-    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    input.emplace(window);
-    input->createAction("move_forward", {GLFW_KEY_W});
-    input->createAction("move_backward", {GLFW_KEY_S});
-    input->createAction("move_left", {GLFW_KEY_A});
-    input->createAction("move_right", {GLFW_KEY_D});
-    input->createAction("move_up", {GLFW_KEY_SPACE});
-    input->createAction("move_down", {GLFW_KEY_LEFT_SHIFT});
-    input->createAction("quit", {GLFW_KEY_ESCAPE});
-    input->createAction("toggle_wireframe", {GLFW_KEY_LEFT_ALT});
-    input->createAction("toggle_light_mode", {GLFW_KEY_Q});
-    input->createAction("toggle_light_placement", {GLFW_KEY_E});
-    input->createAction("toggle_flashlight", {GLFW_KEY_F});
+    if (!headless)
+    {
+        glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
+    return true;
+}
 
+bool Application::initRenderer()
+{
     /* 2. GLAD: Initializing pointers */
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
-        return;
+        return false;
     }
+    GLState::invalidate(); // the shadow state may be left over from an earlier context
+    Texture::detectCompressionSupport();
+    Shader::detectCompileSupport();
+    geometry.emplace();
+    uploadStreamer.emplace();
+
+    profiler.emplace();
+    zones.input = profiler->zone("input");
+    zones.streaming = profiler->zone("upload streaming", true);
+    zones.clear = profiler->zone("clear", true);
+    zones.uniforms = profiler->zone("uniform setup", true);
+    zones.lightBinning = profiler->zone("light binning");
+    zones.shadows = profiler->zone("shadow maps", true);
+    zones.submit = profiler->zone("cull and submit");
+    zones.depthPrepass = profiler->zone("depth pre-pass", true);
+    zones.execute = profiler->zone("render queue"); // CPU only, so the model zones inside get the timer queries
+    zones.deferredLighting = profiler->zone("deferred lighting", true);
+    zones.swap = profiler->zone(headless ? "finish" : "swap");
 
     int nAttributes;
     glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nAttributes);
     std::cout << "Maximum number of attributes: " << nAttributes << std::endl;
+    return true;
+}
 
-    /* 3. OpenGL: Initializing shaders and objects */
-    backpack.emplace("assets/models/backpack/backpack.obj");
-    container.emplace("assets/models/container/container.obj");
-    cube.emplace("assets/models/cube/cube.obj");
-    grass.emplace("assets/models/grass/grass.obj", GL_CLAMP_TO_EDGE);
-    transparentWindow.emplace("assets/models/window/window.obj", GL_CLAMP_TO_EDGE);
-
-    /* 3.2 Shader setup */
+void Application::initShaders()
+{
+    /* 3.1 Shader setup */
+    // only submitted here; the driver compiles them while startup goes on, see linkShaders()
     lightSourceShader.emplace("shaders/vertexShaderDefault.glsl", "shaders/fragmentShaderLightSource.glsl");
-    defaultShader.emplace("shaders/vertexShaderDefault.glsl", "shaders/fragmentShaderPhong.glsl");
+    // the variants the demo scene switches between with the flashlight; others build on demand
+    phongVariants.emplace("shaders/vertexShaderDefault.glsl", "shaders/fragmentShaderPhong.glsl", PHONG_FEATURE_DEFINES);
+    phongVariants->get(PHONG_DIRECTIONAL_LIGHT | PHONG_POINT_LIGHTS | PHONG_SHADOWS);
+    phongVariants->get(PHONG_UBER_SHADER | PHONG_SHADOWS);
+    deferred.emplace();
+    depthPrepass.emplace();
+    shadowMaps.emplace();
+
+    frameUniforms.emplace(FRAME_DATA_BINDING, sizeof(FrameData));
+    lightUniforms.emplace(LIGHT_DATA_BINDING, sizeof(LightData));
+}
 
-    /* 4. Prepare for main loop */
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+void Application::linkShaders()
+{
+    // waits for the programs, so the stats below are complete
+    lightSourceShader->use();
+    phongShader(PHONG_DIRECTIONAL_LIGHT | PHONG_POINT_LIGHTS | PHONG_SHADOWS);
+    phongShader(PHONG_UBER_SHADER | PHONG_SHADOWS);
+    deferred->linkShaders(MATERIAL_SHININESS);
+    depthPrepass->linkShaders();
+    shadowMaps->linkShaders();
+
+    const ShaderCompileStats &stats = Shader::compileStats();
+    std::cout << "shaders: " << stats.programs << " programs, " << stats.cacheHits << " from the program cache, "
+        << stats.cacheMisses << " compiled" << (ProgramCache::supported() ? "" : " (no program binary support)")
+        << ", " << stats.submitMilliseconds << " ms to submit, " << stats.waitMilliseconds << " ms waiting on the driver"
+        << std::endl;
+}
+
+void Application::initFrameState()
+{
+    GLState::setDepthTest(true);
+    GLState::setBlend(true);
+    GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (!headless)
+        glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
     glViewport(0, 0, fbWidth, fbHeight);
 }
 
-void Application::process()
+void Application::buildSceneCuller()
 {
-    auto currentFrame = (float)glfwGetTime();
-    deltaTime = currentFrame - lastFrame;
-    lastFrame = currentFrame;
+    AABB casterBounds;
+    streamingCasters.clear();
+    for (std::uint32_t id = 0; id < sceneObjects.size(); id++)
+    {
+        SceneObject &object = sceneObjects[id];
+        object.worldBounds = object.model->getBounds().transformed(object.transform);
+        sceneCuller.add(object.worldBounds);
+        if (object.pass != PASS_TRANSPARENT)
+        {
+            casterBounds.expand(object.worldBounds);
+            streamingCasters.push_back(id);
+        }
+    }
+    sceneCuller.build();
+    visibleObjects.reserve(sceneObjects.size());
+
+    grassBounds = {};
+    if (grass)
+        for (const glm::mat4 &transform : grassTransforms)
+            grassBounds.expand(grass->getBounds().transformed(transform));
+    casterBounds.expand(grassBounds);
+    shadowCasterBounds = casterBounds;
+    shadowMaps->setCasterBounds(casterBounds);
+    shadowCasters.reserve(sceneObjects.size());
+}
 
-    processInput();
+void Application::moveSceneObject(std::uint32_t id, const glm::mat4 &transform)
+{
+    SceneObject &object = sceneObjects[id];
+    AABB bounds = object.model->getBounds().transformed(transform);
+    if (object.pass != PASS_TRANSPARENT)
+    {
+        shadowMaps->invalidate(object.worldBounds);
+        shadowMaps->invalidate(bounds);
+        // the cascades only reach as far toward the light as the casters they were told of
+        if (!shadowCasterBounds.contains(bounds))
+        {
+            shadowCasterBounds.expand(bounds);
+            shadowMaps->setCasterBounds(shadowCasterBounds);
+        }
+    }
+    object.transform = transform;
+    object.worldBounds = bounds;
+    sceneCuller.update(id, bounds);
+}
 
-    /* Drawing/Rendering */
-    // glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Application::loadGeneratedScene(GeneratedScene scene)
+{
+    // one zone for every generated model, so the sorted queue isn't cut into a timer query per model
+    ProfileZoneId zone = profiler->zone("draw generated", true);
+    generatedModels.reserve(scene.models.size()); // scene objects point into it
+    for (ModelData &data : scene.models)
+    {
+        Model &model = generatedModels.emplace_back(std::move(data), *geometry);
+        model.setProfileZone(zone);
+        model.releaseCpuData();
+    }
+
+    sceneObjects.reserve(scene.objects.size());
+    for (const SceneObjectPlacement &object : scene.objects)
+        sceneObjects.push_back({ &generatedModels[object.model], object.transform, PASS_OPAQUE });
+    buildSceneCuller();
+
+    sceneLights = std::move(scene.lights);
+    if (sceneLights.size() > LightClusters::MAX_LIGHTS)
+    {
+        std::cout << "WARNING::SCENE::TOO_MANY_LIGHTS " << sceneLights.size() << ", keeping "
+            << LightClusters::MAX_LIGHTS << std::endl;
+        sceneLights.resize(LightClusters::MAX_LIGHTS);
+    }
+    if (!sceneLights.empty())
+    {
+        clusterLights.resize(sceneLights.size());
+        lightClusters.emplace();
+    }
+}
 
-    if (wireframeMode) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    } else {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+bool Application::createOffscreenTarget(int width, int height)
+{
+    offscreenColor = GLRenderbuffer::create();
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenColor.get());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    offscreenDepth = GLRenderbuffer::create();
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenDepth.get());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+    offscreenFramebuffer = GLFramebuffer::create();
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer.get());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenColor.get());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, offscreenDepth.get());
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE " << width << "x" << height << std::endl;
+        return false;
     }
+    fbWidth = width;
+    fbHeight = height;
+    return true;
+}
 
-    // 1. cube
-    auto viewMatrix = cam.getViewMatrix();
-    auto projectionMatrix = glm::perspective(
-        glm::radians(cam.fov), (float)fbWidth/(float)fbHeight, 0.1f, 100.0f);
+void Application::process()
+{
+    std::size_t allocationsBefore = AllocationCounter::count();
+
+    profiler->beginFrame();
 
-    defaultShader->use();
-    defaultShader->setMat4("viewMatrix", viewMatrix, 1, GL_FALSE);
-    defaultShader->setMat4("projectionMatrix", projectionMatrix, 1, GL_FALSE);
-    defaultShader->setVec3("viewPos", cam.pos);
-    defaultShader->setFloat("shininess", 32.0f);
+    float currentFrame = advanceClock();
 
-    defaultShader->setVec3("dirLight.direction", { 0.0f, -1.0f, 0.0f });
-    defaultShader->setVec3("dirLight.ambientColor", WHITE * glm::vec3(.1f));
-    defaultShader->setVec3("dirLight.diffuseColor", WHITE * glm::vec3(1.0f));
-    defaultShader->setVec3("dirLight.specularColor", WHITE * glm::vec3(1.0f));
+    profiler->begin(zones.input);
+    if (!headless)
+        processInput();
+    profiler->end();
+    GLState::resetStats(); // after input, so print_render_stats reports the previous frame
 
+    profiler->begin(zones.streaming);
+    uploadStreamer->update(UPLOAD_BUDGET_MS);
+    profiler->end();
+
+    /* Drawing/Rendering */
     glm::vec3 pointLightColor = boringWhiteMode
         ? WHITE
         : glm::vec3{ sin(currentFrame * 2.0f), sin(currentFrame * 0.7f), sin(currentFrame * 1.3f) };
-    defaultShader->setVec3("pointLights[0].position", pointLightPos);
-    defaultShader->setVec3("pointLights[0].ambientColor", pointLightColor * glm::vec3(0.02f));
-    defaultShader->setVec3("pointLights[0].diffuseColor", pointLightColor * glm::vec3(0.6f));
-    defaultShader->setVec3("pointLights[0].specularColor", glm::vec3(1.0f, 1.0f, 1.0f));
-    defaultShader->setFloat("pointLights[0].constantAttTerm", 1.0f);
-    defaultShader->setFloat("pointLights[0].linearAttTerm", 0.09f);
-    defaultShader->setFloat("pointLights[0].quadraticAttTerm", 0.032f);
+    profiler->begin(zones.uniforms);
+    updateFrameUniforms(currentFrame, pointLightColor);
+    profiler->end();
+    if (lightClusters)
+    {
+        profiler->begin(zones.lightBinning);
+        updateSceneLights(currentFrame);
+        profiler->end();
+    }
+    // before the target is bound: the passes that are due draw into the shadow maps' own framebuffer
+    profiler->begin(zones.shadows);
+    renderShadowMaps();
+    profiler->end();
+
+    profiler->begin(zones.clear);
+    // an incomplete G-buffer has been reported by now; keep drawing forward
+    if (renderPath == RENDER_DEFERRED && !deferred->beginGeometry(fbWidth, fbHeight))
+        renderPath = RENDER_FORWARD;
+    if (renderPath == RENDER_FORWARD)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer.get()); // 0, the window's, outside headless runs
+        // glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+    profiler->end();
 
-    // spotlight (flashlight attached to camera)
-    defaultShader->setVec3("spotLight.position", cam.pos);
-    defaultShader->setVec3("spotLight.direction", cam.front);
-    defaultShader->setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-    defaultShader->setFloat("spotLight.outerCutOff", glm::cos(glm::radians(17.5f)));
-    defaultShader->setVec3("spotLight.ambientColor", BLACK);
-    defaultShader->setVec3("spotLight.diffuseColor", flashlightOn ? WHITE : BLACK);
-    defaultShader->setVec3("spotLight.specularColor", flashlightOn ? WHITE : BLACK);
-    defaultShader->setFloat("spotLight.constantAttTerm", 1.0f);
-    defaultShader->setFloat("spotLight.linearAttTerm", 0.027f);
-    defaultShader->setFloat("spotLight.quadraticAttTerm", 0.0028f);
-
-    auto modelMatrix = glm::mat4(1.0f);
-    defaultShader->setMat4("modelMatrix", modelMatrix, 1, GL_FALSE);
-    backpack->draw(*defaultShader);
-
-    modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, 0.0f, 0.0f));
-    defaultShader->setMat4("modelMatrix", modelMatrix, 1, GL_FALSE);
-    container->draw(*defaultShader);
+    GLState::setPolygonMode(wireframeMode ? GL_LINE : GL_FILL);
 
-    for (unsigned int i = 0; i < grassPositions.size(); i++)
+    const Shader &phong = phongShader(phongFeatures());
+    // the deferred path fills the G-buffer with what it can, and draws the rest forward after shading
+    const Shader &sceneShader = renderPath == RENDER_DEFERRED ? deferred->geometryShader() : phong;
+    RenderQueue &forwardQueue = renderPath == RENDER_DEFERRED ? overlayQueue : renderQueue;
+
+    // 1. scene
+    profiler->begin(zones.submit);
+    Frustum frustum = Frustum::fromMatrix(frameData.projectionMatrix * frameData.viewMatrix);
+    renderQueue.begin(cam.pos, FAR_PLANE, frustum);
+    overlayQueue.begin(cam.pos, FAR_PLANE, frustum);
+
+    lodSelector.begin(cam.pos, cam.fov, fbHeight);
+
+    visibleObjects.clear();
+    sceneCuller.cull(frustum, visibleObjects);
+    for (std::uint32_t id : visibleObjects)
     {
-        modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-5.0f, 0.0f, -1.0f));
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        defaultShader->setMat4("modelMatrix", modelMatrix, 1, GL_FALSE);
-        grass->draw(*defaultShader);
+        SceneObject &object = sceneObjects[id];
+        lodSelector.select(*object.model, object.model->getBoundingSphere().transformed(object.transform), object.lod);
+        if (object.pass == PASS_TRANSPARENT)
+            forwardQueue.submit(*object.model, phong, object.transform, object.pass, glm::vec4(1.0f), object.lod);
+        else
+            renderQueue.submit(*object.model, sceneShader, object.transform, object.pass, glm::vec4(1.0f), object.lod);
     }
 
-    modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 2.0f));
-    defaultShader->setMat4("modelMatrix", modelMatrix, 1, GL_FALSE);
-    transparentWindow->draw(*defaultShader);
+    // the batch shares one level, so the nearest instance decides it
+    if (grass)
+    {
+        const glm::mat4 *nearestGrass = nullptr;
+        float nearestGrassDistance = FAR_PLANE * FAR_PLANE;
+        for (const glm::mat4 &transform : grassTransforms)
+        {
+            glm::vec3 offset = glm::vec3(transform[3]) - cam.pos;
+            if (glm::dot(offset, offset) < nearestGrassDistance)
+            {
+                nearestGrassDistance = glm::dot(offset, offset);
+                nearestGrass = &transform;
+            }
+        }
+        if (nearestGrass != nullptr)
+            lodSelector.select(*grass, grass->getBoundingSphere().transformed(*nearestGrass), grassLod);
+        renderQueue.submitInstanced(*grass, sceneShader, grassTransforms, {}, PASS_CUTOUT, grassLod);
+    }
 
-    // 3. light sources
-    lightSourceShader->use();
-    lightSourceShader->setMat4("viewMatrix", viewMatrix, 1, GL_FALSE);
-    lightSourceShader->setMat4("projectionMatrix", projectionMatrix, 1, GL_FALSE);
+    // 2. light sources
+    if (cube)
+    {
+        auto lightModelMatrix = glm::translate(glm::mat4(1.0f), pointLightPos);
+        lightModelMatrix = glm::scale(lightModelMatrix, glm::vec3(0.2f));
+        forwardQueue.submit(*cube, *lightSourceShader, lightModelMatrix, PASS_OPAQUE, glm::vec4(pointLightColor, 1.0f));
+    }
+    profiler->end();
+
+    if (depthPrepass->enabled)
+    {
+        // timed as a whole; the model zones inside would each want a timer query of their own
+        profiler->begin(zones.depthPrepass);
+        depthPrepass->fillDepth(renderQueue, nullptr);
+        profiler->end();
+    }
 
-    modelMatrix = glm::translate(glm::mat4(1.0f), pointLightPos);
-    modelMatrix = glm::scale(modelMatrix, glm::vec3(0.2f));
-    lightSourceShader->setVec3("color", pointLightColor);
-    lightSourceShader->setMat4("modelMatrix", modelMatrix, 1, GL_FALSE);
-    cube->draw(*lightSourceShader);
+    profiler->begin(zones.execute);
+    const Shader *overdrawShader = depthPrepass->beginShading(fbWidth * fbHeight);
+    renderQueue.execute(&*profiler, overdrawShader);
+    depthPrepass->endShading();
+    profiler->end();
+
+    if (renderPath == RENDER_DEFERRED)
+    {
+        profiler->begin(zones.deferredLighting);
+        deferred->shade(clusterLights, offscreenFramebuffer.get());
+        profiler->end();
+        GLState::setPolygonMode(wireframeMode ? GL_LINE : GL_FILL);
+        overlayQueue.execute(&*profiler);
+    }
+
+    profiler->begin(zones.swap);
+    if (headless)
+        glFinish(); // nothing is presented, so wait for the frame here and time the whole of it
+    else
+        glfwSwapBuffers(window);
+    profiler->end();
+    if (!headless)
+        glfwPollEvents();
+    profiler->endFrame();
+
+    // only non-zero in LEARN_OPENGL_COUNT_ALLOCATIONS builds; the frame loop must not allocate
+    frameAllocations = AllocationCounter::count() - allocationsBefore;
+    if (frameAllocations > 0)
+        std::cout << "WARNING::FRAME::HEAP_ALLOCATIONS " << frameAllocations << std::endl;
+}
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+void Application::printReplaySummary()
+{
+    if (replayFrameMilliseconds.empty())
+        return;
+    std::vector<float> sorted = replayFrameMilliseconds;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](float fraction) {
+        return sorted[(std::size_t)(fraction * (float)(sorted.size() - 1) + 0.5f)];
+    };
+    std::cout << "replay: " << sorted.size() << " frames, frame ms p50 " << std::fixed << std::setprecision(2)
+        << percentile(0.50f) << ", p95 " << percentile(0.95f) << ", p99 " << percentile(0.99f) << ", max "
+        << sorted.back() << std::defaultfloat << std::endl;
+    profiler->printSummary();
 }
 
 void Application::cleanup()
 {
-    defaultShader.reset();
+    if (inputRecorder)
+    {
+        std::uint32_t frames = inputRecorder->frameCount();
+        if (inputRecorder->finish())
+            std::cout << "input: recorded " << frames << " frames" << std::endl;
+        else
+            std::cout << "ERROR::INPUT_RECORDER::WRITE_FAILED" << std::endl;
+        inputRecorder.reset();
+    }
+
+    // GPU resources release their GL objects on destruction, so drop them while the context lives
+    backpack.reset();
+    container.reset();
+    cube.reset();
+    grass.reset();
+    transparentWindow.reset();
+    generatedModels.clear();
+    lightClusters.reset();
+    deferred.reset();
+    depthPrepass.reset();
+    shadowMaps.reset();
+    offscreenFramebuffer.reset();
+    offscreenColor.reset();
+    offscreenDepth.reset();
+    uploadStreamer.reset();
+    geometry.reset();
+    profiler.reset();
+    frameUniforms.reset();
+    lightUniforms.reset();
+    phongVariants.reset();
     lightSourceShader.reset();
+    Texture::releaseBlack();
     glfwTerminate();
 }
 
-void Application::processInput()
+float Application::advanceClock()
 {
-    input->update();
+    if (inputReplay)
+    {
+        // recorded delta times, however long this frame takes, so every replayed frame matches its original
+        if (!inputReplay->next(replayedInput, deltaTime))
+            glfwSetWindowShouldClose(window, true);
+        lastFrame += deltaTime;
+        return lastFrame;
+    }
+
+    float currentFrame = headless ? scriptedTime : (float)glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    return currentFrame;
+}
 
-    if (input->isActionJustPressed("quit"))
+void Application::processInput()
+{
+    if (inputReplay)
+        input->update(replayedInput);
+    else
+        input->update();
+    if (inputRecorder)
+        inputRecorder->record(input->snapshot(), deltaTime);
+
+    if (input->isActionJustPressed(actions.quit))
         glfwSetWindowShouldClose(window, true);
 
-    if (input->isActionJustPressed("toggle_wireframe"))
+    if (input->isActionJustPressed(actions.toggleWireframe))
         wireframeMode = !wireframeMode;
 
-    if (input->isActionPressed("move_left"))
+    if (input->isActionJustPressed(actions.printRenderStats))
+        printRenderStats();
+
+    if (input->isActionJustPressed(actions.toggleLod))
+        lodSelector.enabled = !lodSelector.enabled;
+
+    if (input->isActionJustPressed(actions.toggleRenderPath))
+    {
+        renderPath = renderPath == RENDER_FORWARD ? RENDER_DEFERRED : RENDER_FORWARD;
+        depthPrepass->showOverdraw = false;
+        std::cout << "render path: " << renderPathName(renderPath) << std::endl;
+    }
+
+    if (input->isActionJustPressed(actions.toggleShadows))
+    {
+        shadowMaps->enabled = !shadowMaps->enabled;
+        std::cout << "shadows: " << (shadowMaps->enabled ? "on" : "off") << std::endl;
+    }
+
+    if (input->isActionJustPressed(actions.toggleDepthPrepass))
+    {
+        depthPrepass->enabled = !depthPrepass->enabled;
+        std::cout << "depth pre-pass: " << (depthPrepass->enabled ? "on" : "off") << std::endl;
+    }
+
+    // the G-buffer has no color target to add fragments up in
+    if (input->isActionJustPressed(actions.toggleOverdraw) && renderPath == RENDER_FORWARD)
+    {
+        depthPrepass->showOverdraw = !depthPrepass->showOverdraw;
+        std::cout << "overdraw view: " << (depthPrepass->showOverdraw ? "on" : "off") << std::endl;
+    }
+    else if (input->isActionJustPressed(actions.toggleOverdraw))
+        std::cout << "overdraw view: forward path only" << std::endl;
+
+    if (input->isActionJustPressed(actions.toggleProfileCapture))
+    {
+        if (!profiler->capturing())
+        {
+            profiler->startCapture();
+            std::cout << "profiler: capturing" << std::endl;
+        }
+        else if (profiler->stopCapture(PROFILE_TRACE_PATH))
+            std::cout << "profiler: trace written to " << PROFILE_TRACE_PATH << std::endl;
+        else
+            std::cout << "ERROR::PROFILER::TRACE_WRITE_FAILED " << PROFILE_TRACE_PATH << std::endl;
+    }
+
+    if (input->isActionPressed(actions.moveLeft))
         cam.processKeyboard(LEFT, deltaTime);
-    if (input->isActionPressed("move_right"))
+    if (input->isActionPressed(actions.moveRight))
         cam.processKeyboard(RIGHT, deltaTime);
-    if (input->isActionPressed("move_forward"))
+    if (input->isActionPressed(actions.moveForward))
         cam.processKeyboard(FORWARD, deltaTime);
-    if (input->isActionPressed("move_backward"))
+    if (input->isActionPressed(actions.moveBackward))
         cam.processKeyboard(BACKWARD, deltaTime);
-    if (input->isActionPressed("move_down"))
+    if (input->isActionPressed(actions.moveDown))
         cam.processKeyboard(DOWN, deltaTime);
-    if (input->isActionPressed("move_up"))
+    if (input->isActionPressed(actions.moveUp))
         cam.processKeyboard(UP, deltaTime);
 
     auto mouseDelta = input->getMouseDelta();
@@ -211,12 +755,12 @@ void Application::processInput()
         cam.processScroll(scrollDelta.y);
 
     // light config
-    if (input->isActionJustPressed("toggle_flashlight"))
+    if (input->isActionJustPressed(actions.toggleFlashlight))
         flashlightOn = !flashlightOn;
-    if (input->isActionJustPressed("toggle_light_mode"))
+    if (input->isActionJustPressed(actions.toggleLightMode))
         boringWhiteMode = !boringWhiteMode;
 
-    if (input->isActionJustPressed("toggle_light_placement"))
+    if (input->isActionJustPressed(actions.toggleLightPlacement))
         lightPlacementMode = !lightPlacementMode;
 
     if (lightPlacementMode) {
@@ -228,6 +772,226 @@ void Application::processInput()
     }
 }
 
+std::uint32_t Application::phongFeatures() const
+{
+    // a light with all-black colors adds nothing, so the variant without it renders the same
+    auto contributes = [](const glm::vec3 &ambient, const glm::vec3 &diffuse, const glm::vec3 &specular) {
+        return ambient != glm::vec3(0.0f) || diffuse != glm::vec3(0.0f) || specular != glm::vec3(0.0f);
+    };
+    const DirLightData &dir = lightData.dirLight;
+    const SpotLightData &spot = lightData.spotLight;
+
+    std::uint32_t features = 0;
+    if (contributes(dir.ambientColor, dir.diffuseColor, dir.specularColor))
+        features |= PHONG_DIRECTIONAL_LIGHT;
+    if (lightData.pointLightCount > 0)
+        features |= PHONG_POINT_LIGHTS;
+    if (contributes(spot.ambientColor, spot.diffuseColor, spot.specularColor))
+        features |= PHONG_SPOT_LIGHT;
+    if (renderPath == RENDER_FORWARD && lightClusters && lightClusters->stats().visibleLights > 0)
+        features |= PHONG_CLUSTERED_LIGHTS;
+    if (shadowMaps->enabled && (features & (PHONG_DIRECTIONAL_LIGHT | PHONG_POINT_LIGHTS)))
+        features |= PHONG_SHADOWS;
+    return features;
+}
+
+Shader &Application::phongShader(std::uint32_t features)
+{
+    Shader &shader = phongVariants->get(features);
+    if (!configuredPhongVariants.test(features))
+    {
+        // only variants with a light read the shininess
+        configuredPhongVariants.set(features);
+        if (features != 0)
+        {
+            shader.use();
+            shader.set(shader.uniform<float>("shininess"), MATERIAL_SHININESS);
+        }
+        if (features & PHONG_CLUSTERED_LIGHTS)
+            LightClusters::setSamplers(shader);
+        if (features & PHONG_SHADOWS)
+            ShadowMaps::setSamplers(shader);
+    }
+    return shader;
+}
+
+void Application::printRenderStats() const
+{
+    const RenderQueueStats &stats = renderQueue.stats();
+    std::cout << "render queue: " << stats.draws << " draws"
+        << ", program changes " << stats.programChanges << " (unsorted " << stats.unsortedProgramChanges << ")"
+        << ", texture changes " << stats.textureChanges << " (unsorted " << stats.unsortedTextureChanges << ")"
+        << ", vao changes " << stats.vertexArrayChanges << " (unsorted " << stats.unsortedVertexArrayChanges << ")"
+        << std::endl;
+    std::cout << "culling: " << visibleObjects.size() << "/" << sceneObjects.size() << " objects visible ("
+        << FrustumCuller::kernelName(FrustumCuller::bestKernel()) << "), " << stats.culledMeshes << " meshes and "
+        << stats.culledInstances << " instances culled" << std::endl;
+    std::cout << "lod: " << stats.triangles << " triangles drawn, " << stats.fullDetailTriangles
+        << " without LOD (" << (lodSelector.enabled ? "on" : "off") << ", " << lodSelector.pixelError
+        << " px error)" << std::endl;
+
+    const UploadStreamerStats &uploads = uploadStreamer->stats();
+    std::cout << "streaming: " << uploads.uploadedBytes / 1024 << " KiB uploaded, " << uploads.pendingBytes / 1024
+        << " KiB pending, " << uploads.fenceStalls << " fence stalls" << std::endl;
+
+    GeometryArenaStats arena = geometry->stats();
+    std::cout << "geometry: " << std::fixed << std::setprecision(1) << arena.usedBytes / (1024.0 * 1024.0) << "/"
+        << arena.capacityBytes / (1024.0 * 1024.0) << " MiB in " << arena.blocks << " blocks, "
+        << arena.allocations << " allocations, " << arena.utilisation() * 100.0f << "% used, " << arena.freeRanges
+        << " free ranges, " << arena.fragmentation * 100.0f << "% fragmented" << std::defaultfloat << std::endl;
+
+    std::cout << "shaders: phong variant " << phongVariants->describe(phongFeatures()) << ", "
+        << phongVariants->builtCount() << "/" << phongVariants->allFeatures() + 1 << " variants built" << std::endl;
+
+    std::cout << "render path: " << renderPathName(renderPath);
+    if (renderPath == RENDER_DEFERRED)
+        std::cout << ", " << deferred->stats().lightVolumes << " light volumes, " << overlayQueue.stats().draws
+            << " draws after shading";
+    std::cout << std::endl;
+    const DepthPrepassStats &prepass = depthPrepass->stats();
+    std::cout << "depth pre-pass: " << (depthPrepass->enabled ? "on" : "off") << ", " << stats.depthOnlyDraws
+        << " depth-only draws, " << prepass.shadedSamples << " samples shaded (" << prepass.shadedPerPixel
+        << " per pixel, " << prepass.lateFrames << " late queries)" << (depthPrepass->showOverdraw ? ", overdraw view" : "")
+        << std::endl;
+    if (lightClusters && renderPath == RENDER_FORWARD)
+    {
+        const LightClusterStats &clusters = lightClusters->stats();
+        std::cout << "clusters: " << clusters.visibleLights << "/" << clusters.lights << " lights visible, "
+            << clusters.indices << " light references, at most " << clusters.maxClusterLights << " in a cluster, "
+            << clusters.droppedIndices << " dropped, " << clusters.binMilliseconds << " ms binning on "
+            << lightClusters->workerCount() << " workers" << std::endl;
+    }
+
+    const ShadowStats &shadows = shadowMaps->stats();
+    std::cout << "shadows: " << (shadowMaps->enabled ? "on" : "off") << ", " << shadows.rendered << "/"
+        << ShadowMaps::MAP_COUNT << " maps drawn this frame, " << shadows.totalRendered << " drawn and "
+        << shadows.totalSkipped << " kept since startup (caching " << (shadowMaps->caching ? "on" : "off") << ")"
+        << std::endl;
+
+    const GLStateStats &glStats = GLState::stats();
+    std::cout << "gl state: " << glStats.issued << " calls issued, " << glStats.skipped << " redundant calls skipped"
+        << std::endl;
+
+    profiler->printSummary();
+}
+
+void Application::updateFrameUniforms(float currentFrame, const glm::vec3 &pointLightColor)
+{
+    frameData.viewMatrix = cam.getViewMatrix();
+    frameData.projectionMatrix = glm::perspective(
+        glm::radians(cam.fov), (float)fbWidth/(float)fbHeight, NEAR_PLANE, FAR_PLANE);
+    frameData.viewPos = cam.pos;
+    frameData.time = currentFrame;
+    frameUniforms->update(frameData);
+
+    DirLightData &dirLight = lightData.dirLight;
+    dirLight.direction = SUN_DIRECTION;
+    dirLight.ambientColor = WHITE * glm::vec3(.1f);
+    dirLight.diffuseColor = WHITE * glm::vec3(1.0f);
+    dirLight.specularColor = WHITE * glm::vec3(1.0f);
+
+    PointLightData &pointLight = lightData.pointLights[0];
+    pointLight.position = pointLightPos;
+    pointLight.ambientColor = pointLightColor * glm::vec3(0.02f);
+    pointLight.diffuseColor = pointLightColor * glm::vec3(0.6f);
+    pointLight.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    pointLight.constantAttTerm = 1.0f;
+    pointLight.linearAttTerm = 0.09f;
+    pointLight.quadraticAttTerm = 0.032f;
+
+    // generated scenes' lights are ranged instead, see updateSceneLights()
+    lightData.pointLightCount = 1;
+
+    // spotlight (flashlight attached to camera)
+    SpotLightData &spotLight = lightData.spotLight;
+    spotLight.position = cam.pos;
+    spotLight.direction = cam.front;
+    spotLight.cutOff = glm::cos(glm::radians(12.5f));
+    spotLight.outerCutOff = glm::cos(glm::radians(17.5f));
+    spotLight.ambientColor = BLACK;
+    spotLight.diffuseColor = flashlightOn ? WHITE : BLACK;
+    spotLight.specularColor = flashlightOn ? WHITE : BLACK;
+    spotLight.constantAttTerm = 1.0f;
+    spotLight.linearAttTerm = 0.027f;
+    spotLight.quadraticAttTerm = 0.0028f;
+    lightUniforms->update(lightData);
+}
+
+void Application::updateSceneLights(float currentFrame)
+{
+    // every light circles its spot at its own pace, so the clusters change each frame
+    for (std::size_t i = 0; i < sceneLights.size(); i++)
+    {
+        const SceneLight &light = sceneLights[i];
+        float angle = currentFrame * (0.5f + 0.1f * (float)(i % 7)) + 2.4f * (float)i;
+        clusterLights[i].position = light.position + glm::vec3(glm::cos(angle), 0.0f, glm::sin(angle)) * 0.75f;
+        clusterLights[i].radius = light.radius;
+        clusterLights[i].color = light.color;
+    }
+    if (renderPath == RENDER_DEFERRED)
+        return; // each light is drawn as a volume instead
+
+    lightClusters->bin(frameData.viewMatrix, glm::radians(cam.fov), (float)fbWidth / (float)fbHeight, NEAR_PLANE,
+                       FAR_PLANE, clusterLights);
+    lightClusters->upload(fbWidth, fbHeight);
+}
+
+void Application::renderShadowMaps()
+{
+    // a caster's shadow changes as it streams in: it appears with the meshes, and its alpha-tested
+    // holes open once the textures replace their placeholders
+    auto streamProgress = [](const Model &model) -> std::uint8_t {
+        return model.geometryResident() ? (model.resident() ? 2 : 1) : 0;
+    };
+    for (std::size_t i = 0; i < streamingCasters.size();)
+    {
+        SceneObject &object = sceneObjects[streamingCasters[i]];
+        std::uint8_t progress = streamProgress(*object.model);
+        if (progress != object.streamed)
+        {
+            shadowMaps->invalidate(object.worldBounds);
+            object.streamed = progress;
+        }
+        if (progress < 2)
+            i++;
+        else
+        {
+            streamingCasters[i] = streamingCasters.back();
+            streamingCasters.pop_back();
+        }
+    }
+    if (grass && grassStreamed < 2 && streamProgress(*grass) != grassStreamed)
+    {
+        grassStreamed = streamProgress(*grass);
+        shadowMaps->invalidate(grassBounds);
+    }
+    shadowMaps->update(frameData.viewMatrix, glm::radians(cam.fov), (float)fbWidth / (float)fbHeight, NEAR_PLANE,
+                       lightData.dirLight.direction, pointLightPos);
+
+    for (const ShadowPass &pass : shadowMaps->stalePasses())
+    {
+        const Shader &casterShader = shadowMaps->beginPass(pass);
+        shadowQueue.begin(pass.origin, pass.range, pass.frustum);
+        shadowCasters.clear();
+        sceneCuller.cull(pass.frustum, shadowCasters);
+        for (std::uint32_t id : shadowCasters)
+        {
+            // blended surfaces let the light through
+            const SceneObject &object = sceneObjects[id];
+            if (object.pass != PASS_TRANSPARENT)
+                shadowQueue.submit(*object.model, casterShader, object.transform, object.pass, glm::vec4(1.0f),
+                                   pass.lod);
+        }
+        // ahead of the scene's own submission, which uploads the instances it sees over these
+        if (grass)
+            shadowQueue.submitInstanced(*grass, casterShader, grassTransforms, {}, PASS_CUTOUT, pass.lod);
+        shadowQueue.executeDepthOnly(casterShader);
+    }
+    if (!shadowMaps->stalePasses().empty())
+        shadowMaps->endPasses(fbWidth, fbHeight);
+    shadowMaps->bind();
+}
+
 void Application::framebufferSizeCallback(GLFWwindow *window, int width, int height)
 {
     auto *app = static_cast<Application *>(glfwGetWindowUserPointer(window));
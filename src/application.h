@@ -1,31 +1,186 @@
 #pragma once
 
+#include <bitset>
 #include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "render/camera.h"
+#include "render/culling.h"
+#include "render/deferred_renderer.h"
+#include "render/depth_prepass.h"
+#include "render/geometry_arena.h"
+#include "render/light_clusters.h"
+#include "render/lod_selector.h"
 #include "render/model.h"
+#include "render/render_queue.h"
+#include "render/scene_generator.h"
+#include "render/shadow_maps.h"
+#include "render/phong_features.h"
 #include "render/shader.h"
+#include "render/shader_variants.h"
+#include "render/uniform_blocks.h"
+#include "render/uniform_buffer.h"
+#include "render/upload_streamer.h"
+#include "systems/input_recording.h"
 #include "systems/input_system.h"
+#include "systems/profiler.h"
 
 constexpr unsigned int SCALE = 2;
 constexpr unsigned int WINDOW_WIDTH = 800 * SCALE;
 constexpr unsigned int WINDOW_HEIGHT = 600 * SCALE;
+constexpr float NEAR_PLANE = 0.1f;
+constexpr float FAR_PLANE = 100.0f;
+// CPU time per frame spent copying streamed meshes and textures into staging buffers
+constexpr double UPLOAD_BUDGET_MS = 2.0;
+constexpr char PROFILE_TRACE_PATH[] = "profiles/trace.json";
+constexpr float MATERIAL_SHININESS = 32.0f;
+// fixed timestep of headless runs, so animated lights match from run to run
+constexpr float HEADLESS_FRAME_RATE = 60.0f;
+
+// Interactive session options, from the command line
+struct SessionSettings
+{
+    std::string recordPath; // --record: log every frame's input and delta time here
+    std::string replayPath; // --replay: take input and frame times from a log instead of the devices
+};
+
+// A caster the headless run moves every frame, to show which shadow maps a change redraws.
+enum MovingCaster
+{
+    MOVING_CASTER_NONE,
+    MOVING_CASTER_NEAR, // beside the point light, inside its cube map
+    MOVING_CASTER_FAR,  // off to the side of every caster, out of reach of every map
+};
+
+// Offscreen benchmark run (see `--bench headless`): a generated scene drawn into a framebuffer
+// object along a scripted camera path, on a context that needs no display.
+struct HeadlessSettings
+{
+    unsigned int frames = 600;
+    unsigned int warmupFrames = 60; // drawn but not measured
+    int width = 1280;
+    int height = 720;
+    bool osmesa = false; // an OSMesa context instead of EGL
+    RenderPath renderPath = RENDER_FORWARD;
+    bool depthPrepass = false;
+    bool shadows = true;
+    bool shadowCaching = true; // off, every shadow map is drawn every frame
+    MovingCaster movingCaster = MOVING_CASTER_NONE;
+    SceneSettings scene;
+};
+
+struct HeadlessResult
+{
+    bool ok = false;
+    std::string renderer; // GL_RENDERER, e.g. "llvmpipe (LLVM 17.0.6, 256 bits)"
+    std::string version;
+    std::vector<float> frameMilliseconds; // measured frames, in order
+    double drawsPerFrame = 0.0;
+    double trianglesPerFrame = 0.0;
+    double shadedSamplesPerPixel = 0.0; // see DepthPrepassStats
+    double shadowMapsRenderedPerFrame = 0.0; // cascades and cube faces, see ShadowStats
+    double shadowMapsSkippedPerFrame = 0.0;
+    std::uint64_t frameAllocations = 0; // over the measured frames; see AllocationCounter
+    std::vector<std::pair<std::string, ProfileZoneStats>> zones; // over the last Profiler::HISTORY_FRAMES
+};
 
 class Application
 {
 public:
-    void run();
+    void run(const SessionSettings &settings = {});
+    // Frames are timed from the start of process() until glFinish() returns, on a fixed timestep.
+    HeadlessResult runHeadless(const HeadlessSettings &settings);
 
 private:
     const glm::vec3 WHITE{1.0};
     const glm::vec3 BLACK{0.0};
+    const glm::vec3 SUN_DIRECTION{0.0f, -1.0f, 0.0f};
 
     GLFWwindow *window = nullptr;
     std::optional<InputSystem> input;
-    std::optional<Shader> defaultShader;
+
+    // Action handles, resolved when the actions are registered
+    struct InputActions
+    {
+        ActionId moveForward = InputSystem::NO_ACTION;
+        ActionId moveBackward = InputSystem::NO_ACTION;
+        ActionId moveLeft = InputSystem::NO_ACTION;
+        ActionId moveRight = InputSystem::NO_ACTION;
+        ActionId moveUp = InputSystem::NO_ACTION;
+        ActionId moveDown = InputSystem::NO_ACTION;
+        ActionId quit = InputSystem::NO_ACTION;
+        ActionId toggleWireframe = InputSystem::NO_ACTION;
+        ActionId toggleLightMode = InputSystem::NO_ACTION;
+        ActionId toggleLightPlacement = InputSystem::NO_ACTION;
+        ActionId toggleFlashlight = InputSystem::NO_ACTION;
+        ActionId printRenderStats = InputSystem::NO_ACTION;
+        ActionId toggleLod = InputSystem::NO_ACTION;
+        ActionId toggleProfileCapture = InputSystem::NO_ACTION;
+        ActionId toggleRenderPath = InputSystem::NO_ACTION;
+        ActionId toggleDepthPrepass = InputSystem::NO_ACTION;
+        ActionId toggleOverdraw = InputSystem::NO_ACTION;
+        ActionId toggleShadows = InputSystem::NO_ACTION;
+    } actions;
+    // Phong variants are picked per frame by the lights that contribute, see phongFeatures()
+    std::optional<ShaderVariants> phongVariants;
+    std::bitset<PHONG_ALL_FEATURES + 1> configuredPhongVariants; // material uniforms set
     std::optional<Shader> lightSourceShader;
+    RenderPath renderPath = RENDER_FORWARD;
+    std::optional<DeferredRenderer> deferred;
+    std::optional<DepthPrepass> depthPrepass;
+    std::optional<ShadowMaps> shadowMaps;
+    RenderQueue shadowQueue; // one stale shadow map's casters at a time
+    std::vector<std::uint32_t> shadowCasters;
+    AABB shadowCasterBounds; // as ShadowMaps last heard
+    std::vector<std::uint32_t> streamingCasters; // scene objects whose shadows change as they stream in
+    AABB grassBounds;
+    std::uint8_t grassStreamed = 0;
+
+    // Per-frame camera and light data, shared by every program through uniform blocks
+    std::optional<UniformBuffer> frameUniforms;
+    std::optional<UniformBuffer> lightUniforms;
+    FrameData frameData{};
+    LightData lightData{};
+
+    RenderQueue renderQueue;
+    RenderQueue overlayQueue; // deferred path only: blended surfaces and light sources, drawn forward after shading
+    std::optional<Profiler> profiler;
+
+    // Built-in profiler zones; each model's draws get a zone of their own
+    struct ProfileZones
+    {
+        ProfileZoneId input;
+        ProfileZoneId streaming;
+        ProfileZoneId clear;
+        ProfileZoneId uniforms;
+        ProfileZoneId lightBinning;
+        ProfileZoneId shadows;
+        ProfileZoneId submit;
+        ProfileZoneId depthPrepass;
+        ProfileZoneId execute;
+        ProfileZoneId deferredLighting;
+        ProfileZoneId swap;
+    } zones{};
+    std::optional<GeometryArena> geometry;
+    std::optional<UploadStreamer> uploadStreamer;
+
+    // Props, culled as a batch before they are submitted; moveSceneObject() moves one
+    struct SceneObject
+    {
+        Model *model;
+        glm::mat4 transform;
+        RenderPass pass;
+        std::uint8_t lod = 0; // last frame's level, for LodSelector's hysteresis
+        AABB worldBounds{}; // see buildSceneCuller() and moveSceneObject()
+        std::uint8_t streamed = 0; // 1 once the meshes are resident, 2 once the textures are too
+    };
+    std::vector<SceneObject> sceneObjects; // indexed by culler id
+    FrustumCuller sceneCuller;
+    std::vector<std::uint32_t> visibleObjects;
 
     Camera cam;
     std::optional<Model> backpack;
@@ -41,6 +196,26 @@ private:
         { -0.3f, 0.0f, -2.3f },
         { 0.5f, 0.0f, -0.6f },
     };
+    std::vector<glm::mat4> grassTransforms; // one instance per grassPositions entry
+    std::uint8_t grassLod = 0;
+    LodSelector lodSelector;
+
+    // headless runs only: the generated scene and the framebuffer it is drawn into
+    bool headless = false;
+    float scriptedTime = 0.0f; // stands in for glfwGetTime()
+    std::vector<Model> generatedModels;
+    std::vector<SceneLight> sceneLights; // lit through lightClusters, beside the movable point light
+    std::vector<ClusterLight> clusterLights; // sceneLights where they are this frame
+    std::optional<LightClusters> lightClusters;
+    GLFramebuffer offscreenFramebuffer;
+    GLRenderbuffer offscreenColor;
+    GLRenderbuffer offscreenDepth;
+
+    // input recording and replay; a replayed session re-renders the recorded frames exactly
+    std::optional<InputRecorder> inputRecorder;
+    std::optional<InputReplay> inputReplay;
+    InputSystem::Snapshot replayedInput;
+    std::vector<float> replayFrameMilliseconds;
 
     bool boringWhiteMode = true;
     bool flashlightOn = false;
@@ -52,14 +227,33 @@ private:
 
     float deltaTime = 0.0f;
     float lastFrame = 0.0f;
+    std::size_t frameAllocations = 0; // by the last process(); only counted with LEARN_OPENGL_COUNT_ALLOCATIONS
 
     int fbWidth = 0;
     int fbHeight = 0;
 
-    void startup();
+    void startup(const SessionSettings &settings);
+    float advanceClock();
+    void printReplaySummary();
+    bool createContext(bool osmesa);
+    bool initRenderer();
+    void initShaders();
+    void linkShaders();
+    void initFrameState();
+    void buildSceneCuller();
+    // Moves a scene object, redrawing the shadow maps that saw it before or see it now.
+    void moveSceneObject(std::uint32_t id, const glm::mat4 &transform);
+    void loadGeneratedScene(GeneratedScene scene);
+    bool createOffscreenTarget(int width, int height);
     void process();
     void cleanup();
     void processInput();
+    std::uint32_t phongFeatures() const;
+    Shader &phongShader(std::uint32_t features);
+    void updateFrameUniforms(float currentFrame, const glm::vec3 &pointLightColor);
+    void updateSceneLights(float currentFrame);
+    void renderShadowMaps();
+    void printRenderStats() const;
 
     static void framebufferSizeCallback(GLFWwindow *window, int width, int height);
 };
@@ -0,0 +1,34 @@
+#include "benchmarks.h"
+
+#include <array>
+#include <iostream>
+#include <utility>
+
+int runBenchmark(std::string_view name, BenchmarkArgs args)
+{
+    constexpr std::array<std::pair<std::string_view, int (*)(BenchmarkArgs)>, 11> BENCHMARKS = {{
+        { "culling", runCullingBenchmark },
+        { "depth_prepass", runDepthPrepassBenchmark },
+        { "frame_allocations", runFrameAllocationBenchmark },
+        { "headless", runHeadlessBenchmark },
+        { "input", runInputBenchmark },
+        { "light_clusters", runLightClusterBenchmark },
+        { "render_paths", runRenderPathBenchmark },
+        { "shader_variants", runShaderVariantBenchmark },
+        { "shadow_cache", runShadowCacheBenchmark },
+        { "startup", runStartupBenchmark },
+        { "vertex_formats", runVertexFormatBenchmark },
+    }};
+
+    for (const auto &[benchName, run] : BENCHMARKS)
+    {
+        if (benchName == name)
+            return run(args);
+    }
+
+    std::cout << "ERROR::BENCH::UNKNOWN_BENCHMARK " << name << "\navailable:";
+    for (const auto &[benchName, run] : BENCHMARKS)
+        std::cout << ' ' << benchName;
+    std::cout << std::endl;
+    return 1;
+}
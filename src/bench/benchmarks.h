@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <string_view>
+#include <vector>
+
+struct HeadlessSettings;
+struct HeadlessResult;
+
+// Arguments after the benchmark's name; most benchmarks take none.
+using BenchmarkArgs = std::span<const std::string_view>;
+
+// Standalone benchmarks, run with `learn_opengl --bench <name> [args...]` and no window.
+// Each returns a process exit code and prints its results to stdout.
+int runBenchmark(std::string_view name, BenchmarkArgs args = {});
+
+int runCullingBenchmark(BenchmarkArgs);
+int runDepthPrepassBenchmark(BenchmarkArgs args);
+int runFrameAllocationBenchmark(BenchmarkArgs args);
+int runHeadlessBenchmark(BenchmarkArgs args);
+
+// For the benchmarks that compare headless runs of one scene under two settings.
+constexpr std::array<unsigned int, 3> COMPARISON_OBJECT_COUNTS = { 500, 2000, 8000 };
+// Reads [--frames N] [--objects N] [--osmesa], and [--deferred] if allowDeferred, over the defaults
+// already in settings. Benchmarks that sweep scene sizes pass objectCounts, which gets
+// COMPARISON_OBJECT_COUNTS or just the --objects count; without it --objects sets the scene's.
+// A bad argument is reported with the benchmark's usage and returns false.
+bool parseComparisonArgs(BenchmarkArgs args, std::string_view benchmark, bool allowDeferred,
+                         HeadlessSettings &settings, std::vector<unsigned int> *objectCounts = nullptr);
+float medianMilliseconds(const HeadlessResult &result);
+int runInputBenchmark(BenchmarkArgs);
+int runLightClusterBenchmark(BenchmarkArgs);
+int runRenderPathBenchmark(BenchmarkArgs args);
+int runShadowCacheBenchmark(BenchmarkArgs);
+int runShaderVariantBenchmark(BenchmarkArgs);
+int runStartupBenchmark(BenchmarkArgs);
+int runVertexFormatBenchmark(BenchmarkArgs);
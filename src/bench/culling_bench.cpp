@@ -0,0 +1,96 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "render/culling.h"
+
+namespace
+{
+    constexpr int OBJECT_COUNT = 100000;
+    constexpr int ITERATIONS = 200;
+
+    template <typename Fn>
+    double averageMicroseconds(Fn &&fn)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++)
+            fn();
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / ITERATIONS;
+    }
+}
+
+int runCullingBenchmark(BenchmarkArgs)
+{
+    // props scattered through a 1 km cube, seen by a camera at its centre
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+
+    FrustumCuller culler;
+    for (int i = 0; i < OBJECT_COUNT; i++)
+    {
+        glm::vec3 center(position(rng), position(rng), position(rng));
+        glm::vec3 extent(size(rng));
+        culler.add({ center - extent, center + extent });
+    }
+    culler.build();
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.2f, 0.3f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 300.0f);
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    std::vector<std::uint32_t> reference, visible;
+    reference.reserve(OBJECT_COUNT);
+    visible.reserve(OBJECT_COUNT);
+    culler.cullFlat(frustum, reference, CULL_SCALAR);
+    std::sort(reference.begin(), reference.end());
+
+    std::cout << "culling " << OBJECT_COUNT << " boxes, " << reference.size() << " visible, "
+        << ITERATIONS << " iterations\n";
+    std::cout << std::left << std::setw(10) << "kernel" << std::setw(14) << "flat (us)" << std::setw(14) << "bvh (us)"
+        << "speedup vs scalar flat\n";
+
+    int status = 0;
+    double scalarFlat = 0.0;
+    for (CullingKernel kernel : { CULL_SCALAR, CULL_SSE, CULL_AVX })
+    {
+        if (!FrustumCuller::isSupported(kernel))
+        {
+            std::cout << std::setw(10) << FrustumCuller::kernelName(kernel) << "not built\n";
+            continue;
+        }
+
+        double flat = averageMicroseconds([&] { visible.clear(); culler.cullFlat(frustum, visible, kernel); });
+        double hierarchical = averageMicroseconds([&] { visible.clear(); culler.cull(frustum, visible, kernel); });
+        if (kernel == CULL_SCALAR)
+            scalarFlat = flat;
+
+        // every kernel, with and without the BVH, must agree with the scalar reference
+        for (bool useBvh : { false, true })
+        {
+            visible.clear();
+            useBvh ? culler.cull(frustum, visible, kernel) : culler.cullFlat(frustum, visible, kernel);
+            std::sort(visible.begin(), visible.end());
+            if (visible != reference)
+            {
+                std::cout << "ERROR::BENCH::CULLING::" << FrustumCuller::kernelName(kernel)
+                    << (useBvh ? "_BVH" : "_FLAT") << "_MISMATCH" << std::endl;
+                status = 1;
+            }
+        }
+
+        std::cout << std::setw(10) << FrustumCuller::kernelName(kernel)
+            << std::setw(14) << std::fixed << std::setprecision(1) << flat
+            << std::setw(14) << hierarchical
+            << std::setprecision(2) << scalarFlat / flat << "x / " << scalarFlat / hierarchical << "x\n";
+    }
+    std::cout.flush();
+    return status;
+}
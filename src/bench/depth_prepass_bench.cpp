@@ -0,0 +1,49 @@
+#include "benchmarks.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "application.h"
+
+int runDepthPrepassBenchmark(BenchmarkArgs args)
+{
+    HeadlessSettings settings;
+    settings.frames = 120;
+    settings.warmupFrames = 20;
+    std::vector<unsigned int> objectCounts;
+    if (!parseComparisonArgs(args, "depth_prepass", true, settings, &objectCounts))
+        return 1;
+
+    std::cout << renderPathName(settings.renderPath) << " path without and with a depth pre-pass, over "
+        << settings.frames << " frames at " << settings.width << "x" << settings.height
+        << ": samples shaded per pixel and median ms per frame\n";
+    std::cout << std::left << std::setw(9) << "objects" << std::setw(18) << "shaded off/on" << std::setw(18)
+        << "ms off/on" << "speedup\n";
+    for (unsigned int objects : objectCounts)
+    {
+        settings.scene.objects = objects;
+        double shaded[2] = {};
+        float milliseconds[2] = {};
+        for (bool prepass : { false, true })
+        {
+            settings.depthPrepass = prepass;
+            Application app;
+            HeadlessResult result = app.runHeadless(settings);
+            if (!result.ok)
+            {
+                std::cout << "ERROR::BENCH::DEPTH_PREPASS::NO_GL_CONTEXT (" << (settings.osmesa ? "osmesa" : "egl")
+                    << ")" << std::endl;
+                return 1;
+            }
+            shaded[prepass] = result.shadedSamplesPerPixel;
+            milliseconds[prepass] = medianMilliseconds(result);
+        }
+        std::ostringstream shadedColumn, msColumn;
+        shadedColumn << std::fixed << std::setprecision(2) << shaded[0] << " / " << shaded[1];
+        msColumn << std::fixed << std::setprecision(2) << milliseconds[0] << " / " << milliseconds[1];
+        std::cout << std::setw(9) << objects << std::setw(18) << shadedColumn.str() << std::setw(18) << msColumn.str()
+            << std::fixed << std::setprecision(2) << milliseconds[0] / milliseconds[1] << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "benchmarks.h"
+
+#include <iostream>
+
+#include "application.h"
+#include "lib/allocation_counter.h"
+
+// Exit code ctest reads as skipped rather than failed (SKIP_RETURN_CODE in CMakeLists.txt).
+static constexpr int SKIPPED = 77;
+
+int runFrameAllocationBenchmark(BenchmarkArgs args)
+{
+    HeadlessSettings settings;
+    settings.frames = 120;
+    settings.warmupFrames = 60; // long enough for the streamed uploads to finish
+    if (!parseComparisonArgs(args, "frame_allocations", true, settings))
+        return 1;
+
+    if (!AllocationCounter::enabled())
+    {
+        std::cout << "frame_allocations: skipped, configure with -DLEARN_OPENGL_COUNT_ALLOCATIONS=ON to count"
+            << std::endl;
+        return SKIPPED;
+    }
+
+    Application app;
+    HeadlessResult result = app.runHeadless(settings);
+    if (!result.ok)
+    {
+        std::cout << "ERROR::BENCH::FRAME_ALLOCATIONS::NO_GL_CONTEXT (" << (settings.osmesa ? "osmesa" : "egl") << ")"
+            << std::endl;
+        return 1;
+    }
+
+    std::cout << "frame_allocations: " << result.frameAllocations << " heap allocations over " << settings.frames
+        << " frames after " << settings.warmupFrames << " warm-up frames (" << renderPathName(settings.renderPath)
+        << " path)" << std::endl;
+    if (result.frameAllocations > 0)
+    {
+        std::cout << "ERROR::BENCH::FRAME_ALLOCATIONS::FRAME_LOOP_ALLOCATES" << std::endl;
+        return 1;
+    }
+    return 0;
+}
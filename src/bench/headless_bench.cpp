@@ -0,0 +1,271 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "application.h"
+
+namespace
+{
+    constexpr char DEFAULT_OUTPUT_PATH[] = "profiles/headless.json";
+
+    bool parseNumber(std::string_view text, unsigned int &value)
+    {
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return error == std::errc() && end == text.data() + text.size();
+    }
+
+    bool parseSize(std::string_view text, int &width, int &height)
+    {
+        std::size_t x = text.find('x');
+        unsigned int w = 0, h = 0;
+        if (x == std::string_view::npos || !parseNumber(text.substr(0, x), w) || !parseNumber(text.substr(x + 1), h)
+            || w == 0 || h == 0)
+            return false;
+        width = (int)w;
+        height = (int)h;
+        return true;
+    }
+
+    void printUsage()
+    {
+        std::cout << "usage: learn_opengl --bench headless [--frames N] [--warmup N] [--size WxH] [--objects N]\n"
+            "       [--meshes N] [--lights N] [--textures N] [--texture-size N] [--seed N] [--osmesa] [--deferred]\n"
+            "       [--prepass] [--no-shadows] [--no-shadow-cache] [--out PATH]\n"
+            "Renders a generated scene offscreen along a scripted camera path and writes frame-time percentiles\n"
+            "as JSON to PATH (default " << DEFAULT_OUTPUT_PATH << "). Without a GPU, Mesa renders on llvmpipe;\n"
+            "GALLIUM_DRIVER=llvmpipe forces it." << std::endl;
+    }
+
+    // nearest rank over sorted samples
+    float percentile(const std::vector<float> &sorted, float fraction)
+    {
+        auto rank = (std::size_t)(fraction * (float)(sorted.size() - 1) + 0.5f);
+        return sorted[rank];
+    }
+
+    void writeString(std::ostream &out, const std::string &text)
+    {
+        out << '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\';
+            if ((unsigned char)c >= 0x20)
+                out << c;
+        }
+        out << '"';
+    }
+
+    void writeReport(std::ostream &out, const HeadlessSettings &settings, const HeadlessResult &result)
+    {
+        std::vector<float> sorted = result.frameMilliseconds;
+        std::sort(sorted.begin(), sorted.end());
+        double total = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+        double mean = total / (double)sorted.size();
+
+        out << std::fixed << std::setprecision(3) << "{\n  \"renderer\": ";
+        writeString(out, result.renderer);
+        out << ",\n  \"version\": ";
+        writeString(out, result.version);
+        out << ",\n  \"context\": \"" << (settings.osmesa ? "osmesa" : "egl") << "\""
+            << ",\n  \"render_path\": \"" << renderPathName(settings.renderPath) << "\""
+            << ",\n  \"depth_prepass\": " << (settings.depthPrepass ? "true" : "false")
+            << ",\n  \"shadows\": " << (settings.shadows ? "true" : "false")
+            << ",\n  \"shadow_caching\": " << (settings.shadowCaching ? "true" : "false")
+            << ",\n  \"width\": " << settings.width << ",\n  \"height\": " << settings.height
+            << ",\n  \"frames\": " << settings.frames << ",\n  \"warmup_frames\": " << settings.warmupFrames
+            << ",\n  \"scene\": { \"objects\": " << settings.scene.objects << ", \"meshes\": " << settings.scene.meshes
+            << ", \"lights\": " << settings.scene.lights << ", \"textures\": " << settings.scene.textures
+            << ", \"texture_size\": " << settings.scene.textureSize << ", \"seed\": " << settings.scene.seed << " }"
+            << ",\n  \"frame_ms\": { \"mean\": " << mean << ", \"min\": " << sorted.front()
+            << ", \"p50\": " << percentile(sorted, 0.50f) << ", \"p90\": " << percentile(sorted, 0.90f)
+            << ", \"p95\": " << percentile(sorted, 0.95f) << ", \"p99\": " << percentile(sorted, 0.99f)
+            << ", \"max\": " << sorted.back() << " }"
+            << ",\n  \"fps_mean\": " << 1000.0 / mean
+            << ",\n  \"draws_per_frame\": " << result.drawsPerFrame
+            << ",\n  \"triangles_per_frame\": " << result.trianglesPerFrame
+            << ",\n  \"shaded_samples_per_pixel\": " << result.shadedSamplesPerPixel
+            << ",\n  \"shadow_maps_rendered_per_frame\": " << result.shadowMapsRenderedPerFrame
+            << ",\n  \"shadow_maps_skipped_per_frame\": " << result.shadowMapsSkippedPerFrame
+            << ",\n  \"zone_window_frames\": " << std::min(settings.frames, Profiler::HISTORY_FRAMES)
+            << ",\n  \"zones\": [";
+        bool first = true;
+        for (const auto &[name, stats] : result.zones)
+        {
+            if (stats.samples == 0)
+                continue;
+            out << (first ? "\n" : ",\n") << "    { \"name\": ";
+            writeString(out, name);
+            out << ", \"cpu_ms\": { \"p50\": " << stats.cpuP50 << ", \"p95\": " << stats.cpuP95 << ", \"p99\": "
+                << stats.cpuP99 << " }";
+            if (stats.gpuSamples > 0)
+                out << ", \"gpu_ms\": { \"p50\": " << stats.gpuP50 << ", \"p95\": " << stats.gpuP95 << ", \"p99\": "
+                    << stats.gpuP99 << " }";
+            out << " }";
+            first = false;
+        }
+        out << "\n  ]\n}\n";
+    }
+}
+
+bool parseComparisonArgs(BenchmarkArgs args, std::string_view benchmark, bool allowDeferred,
+                         HeadlessSettings &settings, std::vector<unsigned int> *objectCounts)
+{
+    if (objectCounts != nullptr)
+        objectCounts->assign(COMPARISON_OBJECT_COUNTS.begin(), COMPARISON_OBJECT_COUNTS.end());
+    for (std::size_t i = 0; i < args.size(); i++)
+    {
+        bool valid = true;
+        if (args[i] == "--osmesa")
+            settings.osmesa = true;
+        else if (args[i] == "--objects" && i + 1 < args.size())
+        {
+            valid = parseNumber(args[++i], settings.scene.objects) && settings.scene.objects > 0;
+            if (objectCounts != nullptr)
+                objectCounts->assign(1, settings.scene.objects);
+        }
+        else if (allowDeferred && args[i] == "--deferred")
+            settings.renderPath = RENDER_DEFERRED;
+        else if (args[i] == "--frames" && i + 1 < args.size())
+            valid = parseNumber(args[++i], settings.frames) && settings.frames > 0;
+        else
+            valid = false;
+        if (!valid)
+        {
+            std::string name(benchmark);
+            std::transform(name.begin(), name.end(), name.begin(),
+                           [](unsigned char c) { return (char)std::toupper(c); });
+            std::cout << "ERROR::BENCH::" << name << "::BAD_ARGUMENT " << args[i] << "\n"
+                "usage: learn_opengl --bench " << benchmark << " [--frames N] [--objects N]"
+                << (allowDeferred ? " [--deferred]" : "") << " [--osmesa]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+float medianMilliseconds(const HeadlessResult &result)
+{
+    std::vector<float> frames = result.frameMilliseconds;
+    std::nth_element(frames.begin(), frames.begin() + frames.size() / 2, frames.end());
+    return frames[frames.size() / 2];
+}
+
+int runHeadlessBenchmark(BenchmarkArgs args)
+{
+    HeadlessSettings settings;
+    std::string outputPath = DEFAULT_OUTPUT_PATH;
+
+    for (std::size_t i = 0; i < args.size(); i++)
+    {
+        std::string_view option = args[i];
+        if (option == "--osmesa")
+        {
+            settings.osmesa = true;
+            continue;
+        }
+        if (option == "--deferred")
+        {
+            settings.renderPath = RENDER_DEFERRED;
+            continue;
+        }
+        if (option == "--prepass")
+        {
+            settings.depthPrepass = true;
+            continue;
+        }
+        if (option == "--no-shadows")
+        {
+            settings.shadows = false;
+            continue;
+        }
+        if (option == "--no-shadow-cache")
+        {
+            settings.shadowCaching = false;
+            continue;
+        }
+        if (option == "--help")
+        {
+            printUsage();
+            return 0;
+        }
+        if (i + 1 == args.size())
+        {
+            std::cout << "ERROR::BENCH::HEADLESS::MISSING_VALUE " << option << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        std::string_view value = args[++i];
+        bool valid = true;
+        if (option == "--frames")
+            valid = parseNumber(value, settings.frames) && settings.frames > 0;
+        else if (option == "--warmup")
+            valid = parseNumber(value, settings.warmupFrames);
+        else if (option == "--size")
+            valid = parseSize(value, settings.width, settings.height);
+        else if (option == "--objects")
+            valid = parseNumber(value, settings.scene.objects);
+        else if (option == "--meshes")
+            valid = parseNumber(value, settings.scene.meshes);
+        else if (option == "--lights")
+            valid = parseNumber(value, settings.scene.lights);
+        else if (option == "--textures")
+            valid = parseNumber(value, settings.scene.textures);
+        else if (option == "--texture-size")
+            valid = parseNumber(value, settings.scene.textureSize) && settings.scene.textureSize > 0;
+        else if (option == "--seed")
+            valid = parseNumber(value, settings.scene.seed);
+        else if (option == "--out")
+            outputPath = value;
+        else
+            valid = false;
+
+        if (!valid)
+        {
+            std::cout << "ERROR::BENCH::HEADLESS::BAD_ARGUMENT " << option << " " << value << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+    Application app;
+    HeadlessResult result = app.runHeadless(settings);
+    if (!result.ok)
+    {
+        std::cout << "ERROR::BENCH::HEADLESS::NO_GL_CONTEXT (" << (settings.osmesa ? "osmesa" : "egl") << ")"
+            << std::endl;
+        return 1;
+    }
+
+    std::error_code error;
+    std::filesystem::path parent = std::filesystem::path(outputPath).parent_path();
+    if (!parent.empty())
+        std::filesystem::create_directories(parent, error);
+    std::ofstream out(outputPath, std::ios::trunc);
+    writeReport(out, settings, result);
+    if (!out)
+    {
+        std::cout << "ERROR::BENCH::HEADLESS::REPORT_WRITE_FAILED " << outputPath << std::endl;
+        return 1;
+    }
+
+    std::vector<float> sorted = result.frameMilliseconds;
+    std::sort(sorted.begin(), sorted.end());
+    std::cout << std::fixed << std::setprecision(2) << "headless: " << settings.frames << " frames at "
+        << settings.width << "x" << settings.height << " " << renderPathName(settings.renderPath)
+        << (settings.depthPrepass ? " with depth pre-pass" : "") << " on " << result.renderer << ", p50 "
+        << percentile(sorted, 0.50f) << " ms, p95 " << percentile(sorted, 0.95f) << " ms, p99 "
+        << percentile(sorted, 0.99f) << " ms, " << result.shadedSamplesPerPixel
+        << " samples shaded per pixel; report written to " << outputPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include "benchmarks.h"
+
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "systems/input_system.h"
+
+namespace
+{
+    constexpr int FRAME_COUNT = 4096;
+    constexpr int ITERATIONS = 50;
+
+    struct ActionBinding
+    {
+        const char *name;
+        int key;
+    };
+
+    // the application's bindings (see Application::startup)
+    constexpr std::array<ActionBinding, 18> BINDINGS = {{
+        { "move_forward", GLFW_KEY_W },
+        { "move_backward", GLFW_KEY_S },
+        { "move_left", GLFW_KEY_A },
+        { "move_right", GLFW_KEY_D },
+        { "move_up", GLFW_KEY_SPACE },
+        { "move_down", GLFW_KEY_LEFT_SHIFT },
+        { "quit", GLFW_KEY_ESCAPE },
+        { "toggle_wireframe", GLFW_KEY_LEFT_ALT },
+        { "toggle_light_mode", GLFW_KEY_Q },
+        { "toggle_light_placement", GLFW_KEY_E },
+        { "toggle_flashlight", GLFW_KEY_F },
+        { "print_render_stats", GLFW_KEY_I },
+        { "toggle_lod", GLFW_KEY_L },
+        { "toggle_profile_capture", GLFW_KEY_P },
+        { "toggle_render_path", GLFW_KEY_R },
+        { "toggle_depth_prepass", GLFW_KEY_Z },
+        { "toggle_overdraw", GLFW_KEY_O },
+        { "toggle_shadows", GLFW_KEY_H },
+    }};
+
+    constexpr std::array<const char *, 3> QUERY_NAMES = { "pressed", "just_pressed", "just_released" };
+
+    // What InputSystem did before actions were interned: bool arrays copied every frame and
+    // a string lookup per query.
+    class NamedActionInput
+    {
+    public:
+        struct NameHash
+        {
+            using is_transparent = void;
+            std::size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+        };
+
+        void createAction(const std::string &name, std::vector<int> keys) { actions[name] = std::move(keys); }
+
+        void update(const std::array<bool, InputSystem::KEY_COUNT> &keys)
+        {
+            previousKeys = currentKeys;
+            currentKeys = keys;
+        }
+
+        bool isActionPressed(std::string_view name) const
+        {
+            return any(name, [this](int key) { return currentKeys[key]; });
+        }
+        bool isActionJustPressed(std::string_view name) const
+        {
+            return any(name, [this](int key) { return currentKeys[key] && !previousKeys[key]; });
+        }
+        bool isActionJustReleased(std::string_view name) const
+        {
+            return any(name, [this](int key) { return !currentKeys[key] && previousKeys[key]; });
+        }
+
+    private:
+        std::array<bool, InputSystem::KEY_COUNT> currentKeys{};
+        std::array<bool, InputSystem::KEY_COUNT> previousKeys{};
+        std::unordered_map<std::string, std::vector<int>, NameHash, std::equal_to<>> actions;
+
+        template <typename Test>
+        bool any(std::string_view name, Test &&test) const
+        {
+            auto it = actions.find(name);
+            if (it == actions.end()) return false;
+            for (int key : it->second)
+                if (test(key)) return true;
+            return false;
+        }
+    };
+
+    template <typename Fn>
+    double nanosecondsPerFrame(Fn &&fn)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++)
+            fn();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / (ITERATIONS * FRAME_COUNT);
+    }
+}
+
+int runInputBenchmark(BenchmarkArgs)
+{
+    // each bound key held or released in runs of a few frames, with some unbound keys as noise
+    std::mt19937 rng(1234);
+    std::bernoulli_distribution toggle(0.15);
+    std::uniform_int_distribution<int> anyKey(GLFW_KEY_SPACE, GLFW_KEY_LAST);
+    std::vector<InputSystem::Snapshot> frames(FRAME_COUNT);
+    InputSystem::Snapshot held;
+    for (InputSystem::Snapshot &frame : frames)
+    {
+        for (const ActionBinding &binding : BINDINGS)
+        {
+            if (toggle(rng))
+                held.keys.flip(binding.key);
+        }
+        if (toggle(rng))
+            held.keys.flip(anyKey(rng));
+        frame = held;
+    }
+    std::vector<std::array<bool, InputSystem::KEY_COUNT>> frameArrays(FRAME_COUNT);
+    for (int i = 0; i < FRAME_COUNT; i++)
+    {
+        for (int key = 0; key < InputSystem::KEY_COUNT; key++)
+            frameArrays[i][key] = frames[i].keys[key];
+    }
+
+    NamedActionInput named;
+    InputSystem interned(nullptr);
+    std::array<ActionId, BINDINGS.size()> ids{};
+    for (std::size_t i = 0; i < BINDINGS.size(); i++)
+    {
+        named.createAction(BINDINGS[i].name, { BINDINGS[i].key });
+        ids[i] = interned.createAction(BINDINGS[i].name, { BINDINGS[i].key });
+    }
+
+    // both answer every query the same for every action in every frame, before either is timed
+    for (int frame = 0; frame < FRAME_COUNT; frame++)
+    {
+        named.update(frameArrays[frame]);
+        interned.update(frames[frame]);
+        for (std::size_t i = 0; i < BINDINGS.size(); i++)
+        {
+            const char *name = BINDINGS[i].name;
+            std::array<bool, 3> expected = { named.isActionPressed(name), named.isActionJustPressed(name),
+                                             named.isActionJustReleased(name) };
+            std::array<bool, 3> actual = { interned.isActionPressed(ids[i]), interned.isActionJustPressed(ids[i]),
+                                           interned.isActionJustReleased(ids[i]) };
+            for (std::size_t query = 0; query < QUERY_NAMES.size(); query++)
+            {
+                if (expected[query] == actual[query])
+                    continue;
+                std::cout << "ERROR::BENCH::INPUT::QUERY_MISMATCH frame " << frame << " " << name << " "
+                    << QUERY_NAMES[query] << ": named " << expected[query] << ", interned " << actual[query]
+                    << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // every action queried three ways per frame, as processInput does for a subset of them
+    std::uint64_t namedHits = 0, internedHits = 0;
+    double namedTime = nanosecondsPerFrame([&] {
+        for (const auto &keys : frameArrays)
+        {
+            named.update(keys);
+            for (const ActionBinding &binding : BINDINGS)
+            {
+                namedHits += named.isActionPressed(binding.name);
+                namedHits += named.isActionJustPressed(binding.name);
+                namedHits += named.isActionJustReleased(binding.name);
+            }
+        }
+    });
+    double internedTime = nanosecondsPerFrame([&] {
+        for (const InputSystem::Snapshot &frame : frames)
+        {
+            interned.update(frame);
+            for (ActionId id : ids)
+            {
+                internedHits += interned.isActionPressed(id);
+                internedHits += interned.isActionJustPressed(id);
+                internedHits += interned.isActionJustReleased(id);
+            }
+        }
+    });
+
+    std::cout << "input: " << BINDINGS.size() << " actions, " << FRAME_COUNT << " frames, " << ITERATIONS
+        << " iterations, update plus 3 queries per action\n";
+    std::cout << std::left << std::setw(16) << "named" << std::fixed << std::setprecision(1) << namedTime
+        << " ns/frame\n";
+    std::cout << std::setw(16) << "interned" << internedTime << " ns/frame  " << std::setprecision(2)
+        << namedTime / internedTime << "x\n";
+
+    if (namedHits != internedHits)
+    {
+        std::cout << "ERROR::BENCH::INPUT::QUERY_MISMATCH " << namedHits << " vs " << internedHits << std::endl;
+        return 1;
+    }
+    std::cout.flush();
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "render/light_clusters.h"
+
+namespace
+{
+    constexpr int LIGHT_COUNT = 4096;
+    constexpr int ITERATIONS = 200;
+    constexpr float ASPECT = 16.0f / 9.0f;
+    constexpr float NEAR = 0.1f;
+    constexpr float FAR = 100.0f;
+}
+
+int runLightClusterBenchmark(BenchmarkArgs)
+{
+    // lights over a 120 m square, seen from above one of its corners
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> ground(-60.0f, 60.0f), height(0.5f, 4.0f), radius(2.5f, 5.0f);
+    std::vector<ClusterLight> lights(LIGHT_COUNT);
+    for (ClusterLight &light : lights)
+    {
+        light.position = { ground(rng), height(rng), ground(rng) };
+        light.radius = radius(rng);
+        light.color = glm::vec3(1.0f);
+    }
+    glm::mat4 view = glm::lookAt(glm::vec3(-50.0f, 12.0f, -50.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    float fovY = glm::radians(45.0f);
+
+    LightClusters reference(0);
+    reference.bin(view, fovY, ASPECT, NEAR, FAR, lights, CULL_SCALAR);
+    const LightClusterStats &stats = reference.stats();
+    std::cout << "binning " << LIGHT_COUNT << " lights into " << LightClusters::GRID_X << "x" << LightClusters::GRID_Y
+        << "x" << LightClusters::GRID_Z << " clusters, " << stats.visibleLights << " visible, " << stats.indices
+        << " light references, at most " << stats.maxClusterLights << " in a cluster, " << ITERATIONS << " iterations\n";
+    std::cout << std::left << std::setw(10) << "kernel" << std::setw(10) << "workers" << std::setw(12) << "bin (us)"
+        << "speedup vs scalar serial\n";
+
+    int status = 0;
+    double scalarSerial = 0.0;
+    for (unsigned int workers : { 0u, ThreadPool::defaultWorkerCount() })
+    {
+        LightClusters clusters(workers);
+        for (CullingKernel kernel : { CULL_SCALAR, CULL_SSE })
+        {
+            if (!FrustumCuller::isSupported(kernel))
+            {
+                std::cout << std::setw(10) << FrustumCuller::kernelName(kernel) << "not built\n";
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < ITERATIONS; i++)
+                clusters.bin(view, fovY, ASPECT, NEAR, FAR, lights, kernel);
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            double microseconds = elapsed.count() / ITERATIONS;
+            if (kernel == CULL_SCALAR && workers == 0)
+                scalarSerial = microseconds;
+
+            // the same clusters and lists, in the same order, however they were built
+            if (!std::ranges::equal(clusters.clusterRanges(), reference.clusterRanges())
+                || !std::ranges::equal(clusters.lightIndices(), reference.lightIndices()))
+            {
+                std::cout << "ERROR::BENCH::LIGHT_CLUSTERS::" << FrustumCuller::kernelName(kernel) << "_" << workers
+                    << "_WORKERS_MISMATCH" << std::endl;
+                status = 1;
+            }
+
+            std::cout << std::setw(10) << FrustumCuller::kernelName(kernel) << std::setw(10) << workers
+                << std::setw(12) << std::fixed << std::setprecision(1) << microseconds
+                << std::setprecision(2) << scalarSerial / microseconds << "x\n";
+        }
+    }
+    std::cout.flush();
+    return status;
+}
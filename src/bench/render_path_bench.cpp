@@ -0,0 +1,54 @@
+#include "benchmarks.h"
+
+#include <array>
+#include <iomanip>
+#include <iostream>
+
+#include "application.h"
+
+namespace
+{
+    constexpr std::array<unsigned int, 4> LIGHT_COUNTS = { 16, 128, 512, 2048 };
+}
+
+int runRenderPathBenchmark(BenchmarkArgs args)
+{
+    HeadlessSettings settings;
+    settings.frames = 120;
+    settings.warmupFrames = 20;
+    std::vector<unsigned int> objectCounts;
+    if (!parseComparisonArgs(args, "render_paths", false, settings, &objectCounts))
+        return 1;
+
+    std::cout << "forward (clustered) vs deferred (light volumes), median ms per frame over " << settings.frames
+        << " frames at " << settings.width << "x" << settings.height << "\n";
+    std::cout << std::left << std::setw(9) << "objects" << std::setw(8) << "lights" << std::setw(10) << "forward"
+        << std::setw(10) << "deferred" << "deferred speedup\n";
+    for (unsigned int objects : objectCounts)
+    {
+        for (unsigned int lights : LIGHT_COUNTS)
+        {
+            settings.scene.objects = objects;
+            settings.scene.lights = lights;
+            float milliseconds[2] = {};
+            for (RenderPath path : { RENDER_FORWARD, RENDER_DEFERRED })
+            {
+                // a context per run, so neither path inherits the other's warm caches
+                settings.renderPath = path;
+                Application app;
+                HeadlessResult result = app.runHeadless(settings);
+                if (!result.ok)
+                {
+                    std::cout << "ERROR::BENCH::RENDER_PATHS::NO_GL_CONTEXT (" << (settings.osmesa ? "osmesa" : "egl")
+                        << ")" << std::endl;
+                    return 1;
+                }
+                milliseconds[path] = medianMilliseconds(result);
+            }
+            std::cout << std::setw(9) << objects << std::setw(8) << lights << std::fixed << std::setprecision(2)
+                << std::setw(10) << milliseconds[RENDER_FORWARD] << std::setw(10) << milliseconds[RENDER_DEFERRED]
+                << milliseconds[RENDER_FORWARD] / milliseconds[RENDER_DEFERRED] << "x" << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "render/gl_state.h"
+#include "render/phong_features.h"
+#include "render/shader_variants.h"
+#include "render/uniform_blocks.h"
+#include "render/uniform_buffer.h"
+
+namespace
+{
+    constexpr int WIDTH = 1920;
+    constexpr int HEIGHT = 1080;
+    constexpr int PASSES_PER_FRAME = 8; // full-screen quads, so the fragment shader dominates
+    constexpr int WARMUP_FRAMES = 5;
+    constexpr int MEASURED_FRAMES = 30;
+    constexpr int MAX_CHANNEL_DIFFERENCE = 2; // out of 255; drivers may reorder the sums
+
+    struct Scenario
+    {
+        const char *name;
+        int pointLights;
+        bool flashlight;
+    };
+
+    constexpr std::array<Scenario, 4> SCENARIOS = {{
+        { "sun only", 0, false },
+        { "sun + 1 point", 1, false },
+        { "sun + 16 points", MAX_POINT_LIGHTS, false },
+        { "sun + 1 point + flashlight", 1, true },
+    }};
+
+    // Application::phongFeatures for the same lights: the directional light is always lit
+    std::uint32_t cheapestFeatures(const Scenario &scenario)
+    {
+        return PHONG_DIRECTIONAL_LIGHT | (scenario.pointLights > 0 ? (std::uint32_t)PHONG_POINT_LIGHTS : 0u)
+            | (scenario.flashlight ? (std::uint32_t)PHONG_SPOT_LIGHT : 0u);
+    }
+
+    LightData makeLights(const Scenario &scenario)
+    {
+        LightData lights{};
+        lights.dirLight = { { 0.0f, -1.0f, -1.0f }, 0.0f, glm::vec3(0.1f), 0.0f, glm::vec3(0.8f), 0.0f, glm::vec3(1.0f), 0.0f };
+        for (int i = 0; i < scenario.pointLights; i++)
+        {
+            PointLightData &light = lights.pointLights[i];
+            light.position = { -3.0f + 0.4f * (float)i, 1.0f - 0.1f * (float)i, 1.5f };
+            light.ambientColor = glm::vec3(0.02f);
+            light.diffuseColor = glm::vec3(0.6f, 0.5f, 0.4f);
+            light.specularColor = glm::vec3(1.0f);
+            light.constantAttTerm = 1.0f;
+            light.linearAttTerm = 0.09f;
+            light.quadraticAttTerm = 0.032f;
+        }
+        lights.pointLightCount = scenario.pointLights;
+
+        SpotLightData &spot = lights.spotLight;
+        spot.position = { 0.0f, 0.0f, 2.0f };
+        spot.direction = { 0.0f, 0.0f, -1.0f };
+        spot.cutOff = glm::cos(glm::radians(12.5f));
+        spot.outerCutOff = glm::cos(glm::radians(17.5f));
+        spot.diffuseColor = spot.specularColor = scenario.flashlight ? glm::vec3(1.0f) : glm::vec3(0.0f);
+        spot.constantAttTerm = 1.0f;
+        spot.linearAttTerm = 0.027f;
+        spot.quadraticAttTerm = 0.0028f;
+        return lights;
+    }
+
+    // Median GPU time of one full-screen pass, and the image it leaves behind.
+    double passMilliseconds(const Shader &shader, GLuint quad, std::vector<unsigned char> &pixels)
+    {
+        shader.use();
+        GLState::bindVertexArray(quad);
+        GLQuery query = GLQuery::create();
+        std::vector<double> frames;
+        for (int frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; frame++)
+        {
+            glBeginQuery(GL_TIME_ELAPSED, query.get());
+            for (int pass = 0; pass < PASSES_PER_FRAME; pass++)
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            glEndQuery(GL_TIME_ELAPSED);
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query.get(), GL_QUERY_RESULT, &nanoseconds);
+            if (frame >= WARMUP_FRAMES)
+                frames.push_back((double)nanoseconds * 1e-6 / PASSES_PER_FRAME);
+        }
+        std::nth_element(frames.begin(), frames.begin() + frames.size() / 2, frames.end());
+
+        pixels.resize((std::size_t)WIDTH * HEIGHT * 4);
+        glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        return frames[frames.size() / 2];
+    }
+}
+
+int runShaderVariantBenchmark(BenchmarkArgs)
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "shader variant bench", nullptr, nullptr);
+    if (window == nullptr)
+    {
+        std::cout << "ERROR::BENCH::SHADER_VARIANTS::NO_GL_CONTEXT" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "ERROR::BENCH::SHADER_VARIANTS::GLAD_INIT_FAILED" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    Shader::detectCompileSupport();
+
+    int status = 0;
+    {
+        // an offscreen 1080p target, so the window's size doesn't matter
+        GLFramebuffer framebuffer = GLFramebuffer::create();
+        GLRenderbuffer color = GLRenderbuffer::create();
+        glBindRenderbuffer(GL_RENDERBUFFER, color.get());
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIDTH, HEIGHT);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color.get());
+        glViewport(0, 0, WIDTH, HEIGHT);
+        GLState::setDepthTest(false);
+        GLState::setBlend(false);
+
+        // a quad facing the camera across the whole target; the vertex shader's matrices are identity
+        const float quadVertices[] = {
+            // position          normal            uv
+            -1.0f, -1.0f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f,
+             1.0f, -1.0f, 0.0f,  0.0f, 0.0f, 1.0f,  4.0f, 0.0f,
+            -1.0f,  1.0f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 4.0f,
+             1.0f,  1.0f, 0.0f,  0.0f, 0.0f, 1.0f,  4.0f, 4.0f,
+        };
+        GLVertexArray quad = GLVertexArray::create();
+        GLBuffer quadBuffer = GLBuffer::create();
+        GLState::bindVertexArray(quad.get());
+        glBindBuffer(GL_ARRAY_BUFFER, quadBuffer.get());
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+        for (GLuint attribute = 0; attribute < 3; attribute++)
+        {
+            const int offsets[] = { 0, 3, 6 }, sizes[] = { 3, 3, 2 };
+            glVertexAttribPointer(attribute, sizes[attribute], GL_FLOAT, GL_FALSE, 8 * sizeof(float),
+                                  (void *)(offsets[attribute] * sizeof(float)));
+            glEnableVertexAttribArray(attribute);
+        }
+
+        // white, fully opaque material textures
+        const unsigned char white[4] = { 255, 255, 255, 255 };
+        GLTexture texture = GLTexture::create();
+        GLState::bindTexture(0, GL_TEXTURE_2D, texture.get());
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        GLState::bindTexture(1, GL_TEXTURE_2D, texture.get());
+
+        UniformBuffer frameUniforms(FRAME_DATA_BINDING, sizeof(FrameData));
+        UniformBuffer lightUniforms(LIGHT_DATA_BINDING, sizeof(LightData));
+        FrameData frame{ glm::mat4(1.0f), glm::mat4(1.0f), { 0.0f, 0.0f, 2.0f }, 0.0f };
+        frameUniforms.update(frame);
+
+        ShaderVariants variants("shaders/vertexShaderDefault.glsl", "shaders/fragmentShaderPhong.glsl",
+                                PHONG_FEATURE_DEFINES);
+        variants.get(PHONG_UBER_SHADER);
+        for (const Scenario &scenario : SCENARIOS)
+            variants.get(cheapestFeatures(scenario)); // submitted together, so they compile in parallel
+        for (std::uint32_t features = 0; features <= PHONG_ALL_FEATURES; features++)
+        {
+            if (!variants.contains(features))
+                continue;
+            const Shader &shader = variants.get(features);
+            shader.use();
+            shader.set(shader.uniform<float>("shininess"), 32.0f);
+            shader.set(shader.builtins().modelMatrix, glm::mat4(1.0f));
+            shader.setSampler("texture_diffuse0", 0);
+            shader.setSampler("texture_specular0", 1);
+        }
+
+        std::cout << "phong fragment cost at " << WIDTH << "x" << HEIGHT << ", ms per full-screen pass (median of "
+            << MEASURED_FRAMES << " frames x " << PASSES_PER_FRAME << " passes)\n";
+        std::cout << std::left << std::setw(28) << "lights" << std::setw(10) << "uber" << std::setw(10) << "variant"
+            << std::setw(9) << "speedup" << "variant defines\n";
+        std::vector<unsigned char> uberPixels, variantPixels;
+        for (const Scenario &scenario : SCENARIOS)
+        {
+            lightUniforms.update(makeLights(scenario));
+            std::uint32_t features = cheapestFeatures(scenario);
+            double uber = passMilliseconds(variants.get(PHONG_UBER_SHADER), quad.get(), uberPixels);
+            double specialized = passMilliseconds(variants.get(features), quad.get(), variantPixels);
+
+            // the lights a variant leaves out are black, so both must draw the same image
+            int difference = 0;
+            for (std::size_t i = 0; i < uberPixels.size(); i++)
+                difference = std::max(difference, std::abs((int)uberPixels[i] - (int)variantPixels[i]));
+            if (difference > MAX_CHANNEL_DIFFERENCE)
+            {
+                std::cout << "ERROR::BENCH::SHADER_VARIANTS::IMAGE_MISMATCH " << scenario.name << " differs by "
+                    << difference << std::endl;
+                status = 1;
+            }
+
+            std::cout << std::setw(28) << scenario.name << std::fixed << std::setprecision(3) << std::setw(10) << uber
+                << std::setw(10) << specialized << std::setprecision(2) << std::setw(9) << uber / specialized
+                << variants.describe(features) << "\n";
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    std::cout.flush();
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return status;
+}
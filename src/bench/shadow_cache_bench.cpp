@@ -0,0 +1,81 @@
+#include "benchmarks.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "application.h"
+
+int runShadowCacheBenchmark(BenchmarkArgs args)
+{
+    HeadlessSettings settings;
+    settings.frames = 120;
+    settings.warmupFrames = 20;
+    std::vector<unsigned int> objectCounts;
+    if (!parseComparisonArgs(args, "shadow_cache", true, settings, &objectCounts))
+        return 1;
+
+    auto run = [&settings](HeadlessResult &result) {
+        Application app;
+        result = app.runHeadless(settings);
+        if (!result.ok)
+            std::cout << "ERROR::BENCH::SHADOW_CACHE::NO_GL_CONTEXT (" << (settings.osmesa ? "osmesa" : "egl") << ")"
+                << std::endl;
+        return result.ok;
+    };
+
+    std::cout << "shadow maps redrawn every frame vs kept until stale, over " << settings.frames << " frames at "
+        << settings.width << "x" << settings.height << ": of " << ShadowMaps::MAP_COUNT
+        << " maps, drawn per frame, and median ms per frame\n";
+    std::cout << std::left << std::setw(9) << "objects" << std::setw(18) << "drawn off/on" << std::setw(18)
+        << "ms off/on" << "speedup\n";
+    for (unsigned int objects : objectCounts)
+    {
+        settings.scene.objects = objects;
+        double drawn[2] = {};
+        float milliseconds[2] = {};
+        for (bool caching : { false, true })
+        {
+            settings.shadowCaching = caching;
+            HeadlessResult result;
+            if (!run(result))
+                return 1;
+            drawn[caching] = result.shadowMapsRenderedPerFrame;
+            milliseconds[caching] = medianMilliseconds(result);
+        }
+        std::ostringstream drawnColumn, msColumn;
+        drawnColumn << std::fixed << std::setprecision(2) << drawn[0] << " / " << drawn[1];
+        msColumn << std::fixed << std::setprecision(2) << milliseconds[0] << " / " << milliseconds[1];
+        std::cout << std::setw(9) << objects << std::setw(18) << drawnColumn.str() << std::setw(18) << msColumn.str()
+            << std::fixed << std::setprecision(2) << milliseconds[0] / milliseconds[1] << "x" << std::endl;
+    }
+
+    // a moving caster only costs the maps that can see it: far from every map, none at all
+    std::cout << "\nkept until stale, with one caster moving every frame: maps drawn per frame\n";
+    std::cout << std::left << std::setw(9) << "objects" << std::setw(10) << "still" << std::setw(10) << "far"
+        << "near the point light\n";
+    settings.shadowCaching = true;
+    int status = 0;
+    for (unsigned int objects : objectCounts)
+    {
+        settings.scene.objects = objects;
+        double drawn[3] = {};
+        for (MovingCaster caster : { MOVING_CASTER_NONE, MOVING_CASTER_FAR, MOVING_CASTER_NEAR })
+        {
+            settings.movingCaster = caster;
+            HeadlessResult result;
+            if (!run(result))
+                return 1;
+            drawn[caster] = result.shadowMapsRenderedPerFrame;
+        }
+        std::cout << std::setw(9) << objects << std::fixed << std::setprecision(2) << std::setw(10)
+            << drawn[MOVING_CASTER_NONE] << std::setw(10) << drawn[MOVING_CASTER_FAR] << drawn[MOVING_CASTER_NEAR]
+            << std::endl;
+        if (drawn[MOVING_CASTER_FAR] > drawn[MOVING_CASTER_NONE])
+        {
+            std::cout << "ERROR::BENCH::SHADOW_CACHE::FAR_CHANGE_REDREW_MAPS " << objects << " objects" << std::endl;
+            status = 1;
+        }
+    }
+    return status;
+}
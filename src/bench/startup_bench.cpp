@@ -0,0 +1,101 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "render/asset_loader.h"
+
+namespace
+{
+    constexpr int RUNS_PER_WORKER_COUNT = 3;
+
+    struct StartupModel
+    {
+        const char *path;
+        GLenum wrapMode;
+    };
+
+    // the same set Application::startup loads
+    constexpr std::array<StartupModel, 5> STARTUP_MODELS = {{
+        { "assets/models/backpack/backpack.obj", GL_REPEAT },
+        { "assets/models/container/container.obj", GL_REPEAT },
+        { "assets/models/cube/cube.obj", GL_REPEAT },
+        { "assets/models/grass/grass.obj", GL_CLAMP_TO_EDGE },
+        { "assets/models/window/window.obj", GL_CLAMP_TO_EDGE },
+    }};
+
+    double loadAllMilliseconds(unsigned int workerCount)
+    {
+        // a fresh arena per run, so every run allocates its buffers like a real startup
+        GeometryArena geometry;
+        std::array<std::optional<Model>, STARTUP_MODELS.size()> models;
+
+        auto start = std::chrono::steady_clock::now();
+        AssetLoader loader(geometry, workerCount);
+        for (std::size_t i = 0; i < STARTUP_MODELS.size(); i++)
+            loader.loadModel(models[i], STARTUP_MODELS[i].path, STARTUP_MODELS[i].wrapMode);
+        loader.finish();
+        glFinish(); // count the uploads, not just their submission
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+}
+
+int runStartupBenchmark(BenchmarkArgs)
+{
+    // uploads need a context, but nothing is ever shown
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "startup bench", nullptr, nullptr);
+    if (window == nullptr)
+    {
+        std::cout << "ERROR::BENCH::STARTUP::NO_GL_CONTEXT" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "ERROR::BENCH::STARTUP::GLAD_INIT_FAILED" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    Texture::detectCompressionSupport();
+
+    // the first pass may import through Assimp and cook the mesh cache; later passes are warm
+    std::cout << "first pass: " << std::fixed << std::setprecision(1) << loadAllMilliseconds(0) << " ms\n";
+
+    std::vector<unsigned int> workerCounts = { 0 };
+    for (unsigned int count = 1; count < ThreadPool::defaultWorkerCount(); count *= 2)
+        workerCounts.push_back(count);
+    workerCounts.push_back(ThreadPool::defaultWorkerCount());
+
+    std::cout << std::left << std::setw(10) << "workers" << std::setw(14) << "best (ms)" << "speedup vs inline\n";
+    double inlineTime = 0.0;
+    for (unsigned int workerCount : workerCounts)
+    {
+        double best = loadAllMilliseconds(workerCount);
+        for (int run = 1; run < RUNS_PER_WORKER_COUNT; run++)
+            best = std::min(best, loadAllMilliseconds(workerCount));
+        if (workerCount == 0)
+            inlineTime = best;
+
+        std::cout << std::setw(10) << workerCount << std::setw(14) << std::setprecision(1) << best
+            << std::setprecision(2) << inlineTime / best << "x\n";
+    }
+    std::cout.flush();
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
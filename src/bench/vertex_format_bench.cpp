@@ -0,0 +1,96 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "render/vertex_format.h"
+
+namespace
+{
+    constexpr int VERTEX_COUNT = 200000;
+
+    struct QuantizationError
+    {
+        float position = 0.0f;
+        float normal = 0.0f;
+        float texCoords = 0.0f; // relative to the UV's magnitude, see below
+    };
+
+    // Round-trips every vertex and records the worst error per attribute, each as a fraction
+    // of what the encoding guarantees: <= 1 means the format is within its bounds.
+    template <typename V>
+    QuantizationError measureError(const std::vector<Vertex> &vertices, const AABB &bounds)
+    {
+        // 16-bit positions land within half a step of the bounds' extent; 10-bit snorm normals
+        // within half of 1/511; half floats within 2^-11 relative, 2^-25 absolute near zero
+        glm::vec3 extent = bounds.max - bounds.min;
+        glm::vec3 positionStep = extent / 65535.0f;
+        constexpr float NORMAL_STEP = 1.0f / 511.0f;
+
+        QuantizationError worst;
+        for (const Vertex &vertex : vertices)
+        {
+            Vertex decoded = VertexFormat<V>::decode(VertexFormat<V>::encode(vertex, bounds), bounds);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                // plus float rounding in the decode, which scales with the coordinates involved
+                float rounding = 1e-6f * (std::abs(bounds.min[axis]) + std::abs(bounds.max[axis]));
+                float positionBound = 0.5f * positionStep[axis] + rounding;
+                float normalBound = 0.5f * NORMAL_STEP + 1e-6f;
+                worst.position = std::max(worst.position,
+                    std::abs(decoded.position[axis] - vertex.position[axis]) / positionBound);
+                worst.normal = std::max(worst.normal, std::abs(decoded.normal[axis] - vertex.normal[axis]) / normalBound);
+            }
+            for (int axis = 0; axis < 2; axis++)
+            {
+                float bound = std::abs(vertex.texCoords[axis]) * std::ldexp(1.0f, -11) + std::ldexp(1.0f, -25);
+                worst.texCoords = std::max(worst.texCoords, std::abs(decoded.texCoords[axis] - vertex.texCoords[axis]) / bound);
+            }
+        }
+        return worst;
+    }
+
+    template <typename V>
+    bool report(const std::vector<Vertex> &vertices, const AABB &bounds)
+    {
+        QuantizationError error = measureError<V>(vertices, bounds);
+        bool withinBounds = error.position <= 1.0f && error.normal <= 1.0f && error.texCoords <= 1.0f;
+        std::cout << std::left << std::setw(11) << VertexFormat<V>::name << std::setw(7) << sizeof(V)
+            << std::setw(10) << std::fixed << std::setprecision(2) << 100.0 * sizeof(V) / sizeof(Vertex)
+            << std::setw(11) << error.position << std::setw(9) << error.normal << std::setw(9) << error.texCoords
+            << (withinBounds ? "ok" : "FAILED") << "\n";
+        return withinBounds;
+    }
+}
+
+int runVertexFormatBenchmark(BenchmarkArgs)
+{
+    // a mesh far from the origin with unequal extents, unit normals and UVs that tile past [0, 1]
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> x(-250.0f, 1250.0f), y(3.0f, 4.5f), z(-0.01f, 0.01f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f), uv(-2.0f, 6.0f);
+    std::vector<Vertex> vertices;
+    AABB bounds;
+    for (int i = 0; i < VERTEX_COUNT; i++)
+    {
+        glm::vec3 normal(unit(rng), unit(rng), unit(rng));
+        if (glm::length(normal) < 1e-3f)
+            normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        Vertex vertex{ { x(rng), y(rng), z(rng) }, glm::normalize(normal), { uv(rng), uv(rng) } };
+        vertices.push_back(vertex);
+        bounds.expand(vertex.position);
+    }
+
+    std::cout << "vertex formats, " << VERTEX_COUNT << " vertices; errors are a fraction of each format's bound\n";
+    std::cout << std::left << std::setw(11) << "format" << std::setw(7) << "bytes" << std::setw(10) << "% float"
+        << std::setw(11) << "position" << std::setw(9) << "normal" << std::setw(9) << "uv" << "\n";
+    bool ok = report<Vertex>(vertices, bounds);
+    ok = report<CompactVertex>(vertices, bounds) && ok;
+    ok = report<QuantizedVertex>(vertices, bounds) && ok;
+    std::cout << "this build uploads " << VertexFormat<GpuVertex>::name << " vertices" << std::endl;
+    return ok ? 0 : 1;
+}
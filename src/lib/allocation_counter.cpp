@@ -0,0 +1,65 @@
+#include "allocation_counter.h"
+
+#ifdef LEARN_OPENGL_COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<std::size_t> allocationCount{0};
+
+bool AllocationCounter::enabled()
+{
+    return true;
+}
+
+std::size_t AllocationCounter::count()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+static void *countedAlloc(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+static void *countedAlignedAlloc(std::size_t size, std::align_val_t alignment)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    auto align = static_cast<std::size_t>(alignment);
+    size = (size + align - 1) / align * align;
+    if (void *ptr = std::aligned_alloc(align, size == 0 ? align : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size) { return countedAlloc(size); }
+void *operator new[](std::size_t size) { return countedAlloc(size); }
+void *operator new(std::size_t size, std::align_val_t alignment) { return countedAlignedAlloc(size, alignment); }
+void *operator new[](std::size_t size, std::align_val_t alignment) { return countedAlignedAlloc(size, alignment); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+#else
+
+bool AllocationCounter::enabled()
+{
+    return false;
+}
+
+std::size_t AllocationCounter::count()
+{
+    return 0;
+}
+
+#endif
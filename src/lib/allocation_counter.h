@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts global operator new calls when built with LEARN_OPENGL_COUNT_ALLOCATIONS.
+// Without it the counter stays at zero and costs nothing.
+class AllocationCounter
+{
+public:
+    static bool enabled();
+    static std::size_t count();
+};
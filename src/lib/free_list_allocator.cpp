@@ -0,0 +1,76 @@
+#include "free_list_allocator.h"
+
+#include <algorithm>
+#include <iterator>
+
+FreeListAllocator::FreeListAllocator(std::size_t capacity)
+    : totalSize(capacity)
+{
+    if (capacity > 0)
+        freeRanges.emplace(0, capacity);
+}
+
+std::size_t FreeListAllocator::allocate(std::size_t size, std::size_t alignment)
+{
+    if (size == 0)
+        return INVALID;
+
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+    {
+        auto [rangeOffset, rangeSize] = *it;
+        std::size_t offset = (rangeOffset + alignment - 1) / alignment * alignment;
+        std::size_t padding = offset - rangeOffset;
+        if (padding + size > rangeSize)
+            continue;
+
+        // the alignment padding stays free in front, anything past the end stays free behind
+        freeRanges.erase(it);
+        if (padding > 0)
+            freeRanges.emplace(rangeOffset, padding);
+        if (padding + size < rangeSize)
+            freeRanges.emplace(offset + size, rangeSize - padding - size);
+        usedSize += size;
+        return offset;
+    }
+    return INVALID;
+}
+
+void FreeListAllocator::free(std::size_t offset, std::size_t size)
+{
+    if (size == 0)
+        return;
+    usedSize -= size;
+
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+    freeRanges.emplace_hint(next, offset, size);
+}
+
+std::size_t FreeListAllocator::largestFreeRange() const
+{
+    std::size_t largest = 0;
+    for (const auto &[offset, size] : freeRanges)
+        largest = std::max(largest, size);
+    return largest;
+}
+
+float FreeListAllocator::fragmentation() const
+{
+    std::size_t freeSize = totalSize - usedSize;
+    if (freeSize == 0)
+        return 0.0f;
+    return 1.0f - (float)largestFreeRange() / (float)freeSize;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+
+// First-fit allocator over an abstract range [0, capacity), used to carve large GPU buffers
+// into many small ones. It never touches the memory itself. Freed ranges merge with their
+// free neighbours, so unloading everything always returns to a single free range.
+class FreeListAllocator
+{
+public:
+    static constexpr std::size_t INVALID = ~std::size_t(0);
+
+    explicit FreeListAllocator(std::size_t capacity = 0);
+
+    // Offset of a new range, or INVALID when no free range is large enough.
+    std::size_t allocate(std::size_t size, std::size_t alignment = 1);
+    // Takes back exactly what allocate() handed out.
+    void free(std::size_t offset, std::size_t size);
+
+    std::size_t capacity() const { return totalSize; }
+    std::size_t used() const { return usedSize; }
+    std::size_t freeRangeCount() const { return freeRanges.size(); }
+    std::size_t largestFreeRange() const;
+    // Share of the free space outside the largest free range: 0 while it is all one piece.
+    float fragmentation() const;
+
+private:
+    std::map<std::size_t, std::size_t> freeRanges; // offset -> size
+    std::size_t totalSize = 0;
+    std::size_t usedSize = 0;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+// Bounded multi-producer/multi-consumer queue without locks (Dmitry Vyukov's design).
+// Each slot carries a sequence number that tells producers and consumers whose turn it is,
+// so a push or pop is one compare-and-swap on the shared index plus one release store.
+template <typename T>
+class LockFreeQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit LockFreeQueue(std::size_t capacity)
+        : mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1),
+          slots(std::make_unique<Slot[]>(mask + 1))
+    {
+        for (std::size_t i = 0; i <= mask; i++)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    LockFreeQueue(const LockFreeQueue &) = delete;
+    LockFreeQueue &operator=(const LockFreeQueue &) = delete;
+
+    // Returns false when the queue is full; value is only moved from on success.
+    bool tryPush(T &&value)
+    {
+        std::size_t position = tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = slots[position & mask];
+            std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            auto difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)position;
+            if (difference == 0)
+            {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    slot.value = std::move(value);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<T> tryPop()
+    {
+        std::size_t position = head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = slots[position & mask];
+            std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            auto difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)(position + 1);
+            if (difference == 0)
+            {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    std::optional<T> value(std::move(*slot.value));
+                    slot.value.reset();
+                    slot.sequence.store(position + mask + 1, std::memory_order_release);
+                    return value;
+                }
+            }
+            else if (difference < 0)
+            {
+                return std::nullopt;
+            }
+            else
+            {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence;
+        std::optional<T> value;
+    };
+
+    const std::size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    // producers and the consumer spin on different lines
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail{ 0 };
+    alignas(CACHE_LINE) std::atomic<std::size_t> head{ 0 };
+};
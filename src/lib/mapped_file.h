@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+// Read-only memory mapping of a whole file. Move-only; the view is unmapped on destruction.
+// A missing or empty file leaves the mapping invalid rather than throwing.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    bool valid() const { return data != nullptr; }
+    std::span<const std::byte> bytes() const { return { data, size }; }
+
+private:
+    const std::byte *data = nullptr;
+    std::size_t size = 0;
+
+    void unmap();
+};
@@ -0,0 +1,101 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+{
+    workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+    if (workers.empty())
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+void ThreadPool::parallelFor(unsigned int jobCount, void (*run)(void *context, unsigned int job), void *context)
+{
+    if (workers.empty())
+    {
+        for (unsigned int i = 0; i < jobCount; i++)
+            run(context, i);
+        return;
+    }
+    if (jobCount == 0)
+        return;
+
+    std::unique_lock lock(mutex);
+    batchRun = run;
+    batchContext = context;
+    batchSize = jobCount;
+    batchNext = 0;
+    batchRemaining = jobCount;
+    jobAvailable.notify_all();
+
+    runBatchJobs(lock);
+    batchDone.wait(lock, [this] { return batchRemaining == 0; });
+    batchSize = batchNext = 0;
+}
+
+void ThreadPool::runBatchJobs(std::unique_lock<std::mutex> &lock)
+{
+    while (batchNext < batchSize)
+    {
+        unsigned int job = batchNext++;
+        lock.unlock();
+        batchRun(batchContext, job);
+        lock.lock();
+        if (--batchRemaining == 0)
+            batchDone.notify_all();
+    }
+}
+
+unsigned int ThreadPool::defaultWorkerCount()
+{
+    // hardware_concurrency() may report 0 when it cannot tell
+    unsigned int n = std::thread::hardware_concurrency();
+    return n > 1 ? n - 1 : 1;
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(mutex);
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty() || batchNext < batchSize; });
+            if (batchNext < batchSize)
+            {
+                runBatchJobs(lock);
+                continue;
+            }
+            // drain what is queued before stopping, so no submitted job is dropped
+            if (jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
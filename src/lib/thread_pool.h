@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads pulling jobs from a shared FIFO. With zero workers,
+// submit() runs each job inline, which gives a serial baseline with the same code path.
+//
+// parallelFor() is the per-frame alternative to submit(): the batch lives in the pool's
+// own fields instead of a std::function in the queue, so dispatching it never allocates.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int workerCount = defaultWorkerCount());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> job);
+
+    // Runs run(context, 0..jobCount-1) on the workers and the calling thread, and returns
+    // once every job has finished. One batch at a time: call it from a single thread.
+    void parallelFor(unsigned int jobCount, void (*run)(void *context, unsigned int job), void *context);
+    template <typename Job>
+    void parallelFor(unsigned int jobCount, Job &&job)
+    {
+        using Body = std::remove_reference_t<Job>;
+        parallelFor(jobCount, [](void *context, unsigned int i) { (*(Body *)context)(i); }, (void *)&job);
+    }
+
+    unsigned int workerCount() const { return (unsigned int)workers.size(); }
+
+    // One per hardware thread, minus the GL thread that consumes the results.
+    static unsigned int defaultWorkerCount();
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    bool stopping = false;
+
+    // the parallelFor() batch in flight, guarded by mutex; no jobs left once batchNext == batchSize
+    void (*batchRun)(void *, unsigned int) = nullptr;
+    void *batchContext = nullptr;
+    unsigned int batchSize = 0;
+    unsigned int batchNext = 0;
+    unsigned int batchRemaining = 0; // claimed or not, still unfinished
+    std::condition_variable batchDone;
+
+    void workerLoop();
+    // Claims and runs batch jobs until none are left unclaimed; lock is held between them.
+    void runBatchJobs(std::unique_lock<std::mutex> &lock);
+};
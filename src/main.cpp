@@ -1,8 +1,35 @@
+#include <iostream>
+#include <string_view>
+#include <vector>
+
 #include "application.h"
+#include "bench/benchmarks.h"
 
-int main()
+int main(int argc, char **argv)
 {
+    if (argc >= 3 && std::string_view(argv[1]) == "--bench")
+    {
+        std::vector<std::string_view> args(argv + 3, argv + argc);
+        return runBenchmark(argv[2], args);
+    }
+
+    SessionSettings session;
+    for (int i = 1; i < argc; i += 2)
+    {
+        std::string_view option = argv[i];
+        if (i + 1 < argc && option == "--record")
+            session.recordPath = argv[i + 1];
+        else if (i + 1 < argc && option == "--replay")
+            session.replayPath = argv[i + 1];
+        else
+        {
+            std::cout << "usage: learn_opengl [--record <input log> | --replay <input log>]\n"
+                "       learn_opengl --bench <name> [args...]" << std::endl;
+            return 1;
+        }
+    }
+
     Application app;
-    app.run();
+    app.run(session);
     return 0;
 }
@@ -0,0 +1,75 @@
+#include "asset_loader.h"
+
+#include <thread>
+
+AssetLoader::AssetLoader(GeometryArena &geometry, unsigned int workerCount, UploadStreamer *streamer)
+    : geometry(geometry), streamer(streamer), pool(workerCount)
+{
+}
+
+void AssetLoader::loadModel(std::optional<Model> &target, const std::string &path, GLenum wrapMode)
+{
+    // with no workers everything is published inline, so make room before the queue can fill
+    if (queued - uploaded >= QUEUE_CAPACITY)
+        uploadReady();
+
+    auto &model = pending.emplace_back(std::make_unique<PendingModel>());
+    model->target = &target;
+    queued++;
+
+    pool.submit([this, model = model.get(), path, wrapMode] {
+        model->data = ModelData::parse(path, wrapMode);
+        decodeImages(model);
+    });
+}
+
+void AssetLoader::finish()
+{
+    while (uploaded < queued)
+    {
+        unsigned int seen = published.load(std::memory_order_acquire);
+        uploadReady();
+        if (uploaded < queued)
+            published.wait(seen, std::memory_order_acquire);
+    }
+    pending.clear();
+}
+
+void AssetLoader::decodeImages(PendingModel *model)
+{
+    auto &images = model->data.images;
+    if (images.empty())
+    {
+        publish(model);
+        return;
+    }
+
+    // the map is complete after parsing, so each job may write its own entry unguarded
+    model->remainingImages.store(images.size(), std::memory_order_relaxed);
+    for (auto &entry : images)
+    {
+        pool.submit([this, model, &entry] {
+            entry.second = Texture::decode(entry.first);
+            if (model->remainingImages.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                publish(model);
+        });
+    }
+}
+
+void AssetLoader::publish(PendingModel *model)
+{
+    while (!ready.tryPush(std::move(model)))
+        std::this_thread::yield();
+    published.fetch_add(1, std::memory_order_release);
+    published.notify_one();
+}
+
+void AssetLoader::uploadReady()
+{
+    while (std::optional<PendingModel *> model = ready.tryPop())
+    {
+        PendingModel &loaded = **model;
+        loaded.target->emplace(std::move(loaded.data), geometry, streamer);
+        uploaded++;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+#include "lib/lock_free_queue.h"
+#include "lib/thread_pool.h"
+#include "model.h"
+
+// Loads models on a worker pool. Parsing and every image decode run as separate jobs, and
+// each finished model is handed to the GL thread through a lock-free queue, so the GL
+// thread does nothing but uploads.
+class AssetLoader
+{
+public:
+    // Models place their geometry in the arena. With a streamer, finished models are only
+    // allocated on the GL thread and their contents stream in over the following frames.
+    explicit AssetLoader(GeometryArena &geometry, unsigned int workerCount = ThreadPool::defaultWorkerCount(),
+                         UploadStreamer *streamer = nullptr);
+
+    AssetLoader(const AssetLoader &) = delete;
+    AssetLoader &operator=(const AssetLoader &) = delete;
+
+    // Starts loading right away; target is filled on the GL thread by finish().
+    void loadModel(std::optional<Model> &target, const std::string &path, GLenum wrapMode = GL_REPEAT);
+
+    // GL thread: uploads models as they complete, returning once every queued one is in place.
+    void finish();
+
+    unsigned int workerCount() const { return pool.workerCount(); }
+
+private:
+    static constexpr std::size_t QUEUE_CAPACITY = 64;
+
+    struct PendingModel
+    {
+        std::optional<Model> *target;
+        ModelData data;
+        std::atomic<std::size_t> remainingImages{ 0 };
+    };
+
+    std::vector<std::unique_ptr<PendingModel>> pending; // owned here, borrowed by the jobs
+    LockFreeQueue<PendingModel *> ready{ QUEUE_CAPACITY };
+    std::atomic<unsigned int> published{ 0 };
+    unsigned int queued = 0;
+    unsigned int uploaded = 0;
+    GeometryArena &geometry;
+    UploadStreamer *streamer;
+    ThreadPool pool; // last, so its workers are joined before the queue goes away
+
+    void decodeImages(PendingModel *model);
+    void publish(PendingModel *model);
+    void uploadReady();
+};
@@ -0,0 +1,46 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+void AABB::expand(const glm::vec3 &point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void AABB::expand(const AABB &other)
+{
+    if (other.empty())
+        return;
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+AABB AABB::transformed(const glm::mat4 &transform) const
+{
+    if (empty())
+        return *this;
+
+    glm::vec3 translation(transform[3]);
+    AABB result{ translation, translation };
+    for (int column = 0; column < 3; column++)
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            float a = transform[column][row] * min[column];
+            float b = transform[column][row] * max[column];
+            result.min[row] += std::min(a, b);
+            result.max[row] += std::max(a, b);
+        }
+    }
+    return result;
+}
+
+BoundingSphere BoundingSphere::transformed(const glm::mat4 &transform) const
+{
+    float scaleX = glm::length(glm::vec3(transform[0]));
+    float scaleY = glm::length(glm::vec3(transform[1]));
+    float scaleZ = glm::length(glm::vec3(transform[2]));
+    return { glm::vec3(transform * glm::vec4(center, 1.0f)), radius * std::max({ scaleX, scaleY, scaleZ }) };
+}
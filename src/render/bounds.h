@@ -0,0 +1,33 @@
+#pragma once
+
+#include <limits>
+#include <glm/glm.hpp>
+
+struct AABB
+{
+    glm::vec3 min{ std::numeric_limits<float>::max() };
+    glm::vec3 max{ -std::numeric_limits<float>::max() };
+
+    void expand(const glm::vec3 &point);
+    void expand(const AABB &other);
+    bool empty() const { return min.x > max.x; }
+    bool contains(const AABB &other) const
+    {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::lessThanEqual(other.max, max));
+    }
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+    // Box enclosing this one after an affine transform (Arvo's method).
+    AABB transformed(const glm::mat4 &transform) const;
+};
+
+struct BoundingSphere
+{
+    glm::vec3 center{ 0.0f };
+    float radius = 0.0f;
+
+    // Scales the radius by the largest axis scale, so it stays conservative.
+    BoundingSphere transformed(const glm::mat4 &transform) const;
+};
@@ -0,0 +1,77 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <numeric>
+
+void Bvh::build(std::span<const AABB> boxes, unsigned int maxLeafSize)
+{
+    nodes.clear();
+    order.resize(boxes.size());
+    std::iota(order.begin(), order.end(), 0u);
+    if (boxes.empty())
+        return;
+
+    centroids.resize(boxes.size());
+    for (std::size_t i = 0; i < boxes.size(); i++)
+        centroids[i] = boxes[i].center();
+
+    nodes.reserve(boxes.size() * 2 / std::max(maxLeafSize, 1u) + 1);
+    nodes.push_back({ {}, 0, (std::uint32_t)boxes.size() });
+    subdivide(0, boxes, std::max(maxLeafSize, 1u));
+}
+
+void Bvh::refit(std::span<const AABB> boxes)
+{
+    // children always follow their parent, so walking backwards visits them first
+    for (std::size_t n = nodes.size(); n-- > 0;)
+    {
+        BvhNode &node = nodes[n];
+        AABB bounds;
+        if (node.isLeaf())
+        {
+            for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+                bounds.expand(boxes[order[i]]);
+        }
+        else
+        {
+            bounds.expand(nodes[node.first].bounds);
+            bounds.expand(nodes[node.first + 1].bounds);
+        }
+        node.bounds = bounds;
+    }
+}
+
+void Bvh::subdivide(std::uint32_t nodeIndex, std::span<const AABB> boxes, unsigned int maxLeafSize)
+{
+    std::uint32_t first = nodes[nodeIndex].first;
+    std::uint32_t count = nodes[nodeIndex].count;
+
+    AABB bounds, centroidBounds;
+    for (std::uint32_t i = first; i < first + count; i++)
+    {
+        bounds.expand(boxes[order[i]]);
+        centroidBounds.expand(centroids[order[i]]);
+    }
+    nodes[nodeIndex].bounds = bounds;
+
+    if (count <= maxLeafSize)
+        return;
+
+    glm::vec3 size = centroidBounds.max - centroidBounds.min;
+    int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+    if (size[axis] <= 0.0f)
+        return; // all centroids coincide, splitting would not separate anything
+
+    std::uint32_t half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                     [&](std::uint32_t a, std::uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+
+    auto leftIndex = (std::uint32_t)nodes.size();
+    nodes.push_back({ {}, first, half });
+    nodes.push_back({ {}, first + half, count - half });
+    nodes[nodeIndex].first = leftIndex;
+    nodes[nodeIndex].count = 0;
+
+    subdivide(leftIndex, boxes, maxLeafSize);
+    subdivide(leftIndex + 1, boxes, maxLeafSize);
+}
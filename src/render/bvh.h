@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "bounds.h"
+
+// Leaves own a contiguous run [first, first + count) of the reordered objects;
+// interior nodes have count == 0 and their children at first and first + 1.
+struct BvhNode
+{
+    AABB bounds;
+    std::uint32_t first = 0;
+    std::uint32_t count = 0;
+
+    bool isLeaf() const { return count > 0; }
+};
+
+// Bounding volume hierarchy over a static set of boxes, split at the centroid median
+// of the longest axis. Node 0 is the root.
+class Bvh
+{
+public:
+    void build(std::span<const AABB> boxes, unsigned int maxLeafSize = 16);
+    // Recomputes every node's bounds after boxes moved, keeping the tree's shape, so it only
+    // stays tight while they move little against the rest.
+    void refit(std::span<const AABB> boxes);
+
+    const std::vector<BvhNode> &getNodes() const { return nodes; }
+    // Leaf order -> index into the boxes passed to build()
+    const std::vector<std::uint32_t> &getOrder() const { return order; }
+
+private:
+    std::vector<BvhNode> nodes;
+    std::vector<std::uint32_t> order;
+    std::vector<glm::vec3> centroids;
+
+    void subdivide(std::uint32_t nodeIndex, std::span<const AABB> boxes, unsigned int maxLeafSize);
+};
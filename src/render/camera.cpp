@@ -39,6 +39,17 @@ void Camera::processScroll(float yOffset)
     fov = glm::clamp(fov - yOffset, 1.0f, 45.0f);
 }
 
+void Camera::lookAt(const glm::vec3 &target)
+{
+    glm::vec3 direction = target - pos;
+    if (glm::dot(direction, direction) == 0.0f)
+        return;
+    direction = glm::normalize(direction);
+    yaw = glm::degrees(glm::atan(direction.z, direction.x));
+    pitch = glm::clamp(glm::degrees(glm::asin(direction.y)), -89.0f, 89.0f);
+    updateFront();
+}
+
 void Camera::updateFront()
 {
     front = glm::normalize(glm::vec3(
@@ -29,6 +29,8 @@ public:
     void processKeyboard(CameraDirection direction, float deltaTime);
     void processMouseMovement(float xOffset, float yOffset);
     void processScroll(float yOffset);
+    // Turns to face target, keeping yaw and pitch in step for later mouse movement.
+    void lookAt(const glm::vec3 &target);
 
 private:
     void updateFront();
@@ -0,0 +1,29 @@
+#include "camera_path.h"
+
+#include <cmath>
+
+namespace
+{
+    glm::vec3 catmullRom(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &p3, float t)
+    {
+        float t2 = t * t;
+        float t3 = t2 * t;
+        return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+                       + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+    }
+}
+
+void CameraPath::apply(float t, Camera &camera) const
+{
+    if (keys.empty())
+        return;
+
+    auto count = (long)keys.size();
+    float position = (t - std::floor(t)) * (float)count;
+    auto segment = (long)position;
+    float local = position - (float)segment;
+    auto key = [&](long offset) -> const Key & { return keys[(std::size_t)(((segment + offset) % count + count) % count)]; };
+
+    camera.pos = catmullRom(key(-1).position, key(0).position, key(1).position, key(2).position, local);
+    camera.lookAt(catmullRom(key(-1).target, key(0).target, key(1).target, key(2).target, local));
+}
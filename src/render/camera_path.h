@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+// Closed Catmull-Rom loop through camera positions and look-at targets, so scripted
+// fly-throughs see the same frames on every run.
+class CameraPath
+{
+public:
+    struct Key
+    {
+        glm::vec3 position;
+        glm::vec3 target;
+    };
+
+    CameraPath() = default;
+    explicit CameraPath(std::vector<Key> keys) : keys(std::move(keys)) {}
+
+    bool empty() const { return keys.empty(); }
+
+    // t in [0, 1) covers the loop once, at one key per 1/keyCount; other values wrap around.
+    void apply(float t, Camera &camera) const;
+
+private:
+    std::vector<Key> keys;
+};
@@ -0,0 +1,281 @@
+#include "culling.h"
+
+#include <array>
+#include <bit>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define LEARN_OPENGL_HAS_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    struct SoaView
+    {
+        const float *cx, *cy, *cz;
+        const float *ex, *ey, *ez;
+        const std::uint32_t *ids;
+    };
+
+    void cullScalar(const Frustum &frustum, const SoaView &soa, std::uint32_t begin, std::uint32_t end,
+                    std::vector<std::uint32_t> &visible)
+    {
+        for (std::uint32_t i = begin; i < end; i++)
+        {
+            bool inside = true;
+            for (const glm::vec4 &plane : frustum.planes)
+            {
+                float distance = plane.x * soa.cx[i] + plane.y * soa.cy[i] + plane.z * soa.cz[i] + plane.w;
+                float radius = std::abs(plane.x) * soa.ex[i] + std::abs(plane.y) * soa.ey[i] + std::abs(plane.z) * soa.ez[i];
+                if (distance + radius < 0.0f)
+                {
+                    inside = false;
+                    break;
+                }
+            }
+            if (inside)
+                visible.push_back(soa.ids[i]);
+        }
+    }
+
+#ifdef LEARN_OPENGL_HAS_SSE
+    void cullSse(const Frustum &frustum, const SoaView &soa, std::uint32_t begin, std::uint32_t end,
+                 std::vector<std::uint32_t> &visible)
+    {
+        __m128 nx[6], ny[6], nz[6], w[6], ax[6], ay[6], az[6];
+        for (int p = 0; p < 6; p++)
+        {
+            const glm::vec4 &plane = frustum.planes[p];
+            nx[p] = _mm_set1_ps(plane.x);
+            ny[p] = _mm_set1_ps(plane.y);
+            nz[p] = _mm_set1_ps(plane.z);
+            w[p] = _mm_set1_ps(plane.w);
+            ax[p] = _mm_set1_ps(std::abs(plane.x));
+            ay[p] = _mm_set1_ps(std::abs(plane.y));
+            az[p] = _mm_set1_ps(std::abs(plane.z));
+        }
+        const __m128 zero = _mm_setzero_ps();
+
+        std::uint32_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 cx = _mm_loadu_ps(soa.cx + i), cy = _mm_loadu_ps(soa.cy + i), cz = _mm_loadu_ps(soa.cz + i);
+            __m128 ex = _mm_loadu_ps(soa.ex + i), ey = _mm_loadu_ps(soa.ey + i), ez = _mm_loadu_ps(soa.ez + i);
+
+            __m128 outside = zero;
+            for (int p = 0; p < 6; p++)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)),
+                                             _mm_add_ps(_mm_mul_ps(nz[p], cz), w[p]));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)),
+                                           _mm_mul_ps(az[p], ez));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+            }
+
+            auto mask = (unsigned int)(~_mm_movemask_ps(outside) & 0xF);
+            while (mask != 0)
+            {
+                visible.push_back(soa.ids[i + std::countr_zero(mask)]);
+                mask &= mask - 1;
+            }
+        }
+        cullScalar(frustum, soa, i, end, visible);
+    }
+#endif
+
+#ifdef __AVX__
+    void cullAvx(const Frustum &frustum, const SoaView &soa, std::uint32_t begin, std::uint32_t end,
+                 std::vector<std::uint32_t> &visible)
+    {
+        __m256 nx[6], ny[6], nz[6], w[6], ax[6], ay[6], az[6];
+        for (int p = 0; p < 6; p++)
+        {
+            const glm::vec4 &plane = frustum.planes[p];
+            nx[p] = _mm256_set1_ps(plane.x);
+            ny[p] = _mm256_set1_ps(plane.y);
+            nz[p] = _mm256_set1_ps(plane.z);
+            w[p] = _mm256_set1_ps(plane.w);
+            ax[p] = _mm256_set1_ps(std::abs(plane.x));
+            ay[p] = _mm256_set1_ps(std::abs(plane.y));
+            az[p] = _mm256_set1_ps(std::abs(plane.z));
+        }
+        const __m256 zero = _mm256_setzero_ps();
+
+        std::uint32_t i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 cx = _mm256_loadu_ps(soa.cx + i), cy = _mm256_loadu_ps(soa.cy + i), cz = _mm256_loadu_ps(soa.cz + i);
+            __m256 ex = _mm256_loadu_ps(soa.ex + i), ey = _mm256_loadu_ps(soa.ey + i), ez = _mm256_loadu_ps(soa.ez + i);
+
+            __m256 outside = zero;
+            for (int p = 0; p < 6; p++)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)),
+                                                _mm256_add_ps(_mm256_mul_ps(nz[p], cz), w[p]));
+                __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)),
+                                              _mm256_mul_ps(az[p], ez));
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+            }
+
+            auto mask = (unsigned int)(~_mm256_movemask_ps(outside) & 0xFF);
+            while (mask != 0)
+            {
+                visible.push_back(soa.ids[i + std::countr_zero(mask)]);
+                mask &= mask - 1;
+            }
+        }
+        cullScalar(frustum, soa, i, end, visible);
+    }
+#endif
+}
+
+std::uint32_t FrustumCuller::add(const AABB &worldBounds)
+{
+    boxes.push_back(worldBounds);
+    return (std::uint32_t)(boxes.size() - 1);
+}
+
+void FrustumCuller::clear()
+{
+    boxes.clear();
+    build();
+}
+
+void FrustumCuller::build(unsigned int maxLeafSize)
+{
+    bvh.build(boxes, maxLeafSize);
+    ids = bvh.getOrder();
+
+    for (auto *column : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+        column->resize(ids.size());
+    slots.resize(ids.size());
+    for (std::size_t i = 0; i < ids.size(); i++)
+    {
+        slots[ids[i]] = (std::uint32_t)i;
+        storeSlot((std::uint32_t)i);
+    }
+}
+
+void FrustumCuller::update(std::uint32_t id, const AABB &worldBounds)
+{
+    boxes[id] = worldBounds;
+    storeSlot(slots[id]);
+    bvh.refit(boxes);
+}
+
+void FrustumCuller::storeSlot(std::uint32_t slot)
+{
+    glm::vec3 center = boxes[ids[slot]].center();
+    glm::vec3 extent = boxes[ids[slot]].extent();
+    centerX[slot] = center.x;
+    centerY[slot] = center.y;
+    centerZ[slot] = center.z;
+    extentX[slot] = extent.x;
+    extentY[slot] = extent.y;
+    extentZ[slot] = extent.z;
+}
+
+void FrustumCuller::cull(const Frustum &frustum, std::vector<std::uint32_t> &visible, CullingKernel kernel) const
+{
+    const std::vector<BvhNode> &nodes = bvh.getNodes();
+    if (nodes.empty())
+        return;
+
+    // median splits keep the tree balanced, so 64 entries cover any realistic object count
+    std::array<std::uint32_t, 64> stack;
+    std::size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const BvhNode &node = nodes[stack[--top]];
+        FrustumTest test = frustum.classify(node.bounds);
+        if (test == FRUSTUM_OUTSIDE)
+            continue;
+
+        if (node.isLeaf())
+        {
+            if (test == FRUSTUM_INSIDE)
+                acceptRange(node.first, node.first + node.count, visible);
+            else
+                cullRange(frustum, node.first, node.first + node.count, visible, kernel);
+            continue;
+        }
+
+        if (test == FRUSTUM_INSIDE)
+        {
+            // leaves are contiguous, so a fully contained subtree is one run between its outermost leaves
+            const BvhNode *leftmost = &node, *rightmost = &node;
+            while (!leftmost->isLeaf())
+                leftmost = &nodes[leftmost->first];
+            while (!rightmost->isLeaf())
+                rightmost = &nodes[rightmost->first + 1];
+            acceptRange(leftmost->first, rightmost->first + rightmost->count, visible);
+            continue;
+        }
+
+        stack[top++] = node.first;
+        stack[top++] = node.first + 1;
+    }
+}
+
+void FrustumCuller::cullFlat(const Frustum &frustum, std::vector<std::uint32_t> &visible, CullingKernel kernel) const
+{
+    cullRange(frustum, 0, (std::uint32_t)ids.size(), visible, kernel);
+}
+
+bool FrustumCuller::isSupported(CullingKernel kernel)
+{
+    switch (kernel)
+    {
+#ifdef LEARN_OPENGL_HAS_SSE
+        case CULL_SSE: return true;
+#endif
+#ifdef __AVX__
+        case CULL_AVX: return true;
+#endif
+        case CULL_SCALAR: return true;
+        default: return false;
+    }
+}
+
+CullingKernel FrustumCuller::bestKernel()
+{
+    if (isSupported(CULL_AVX))
+        return CULL_AVX;
+    if (isSupported(CULL_SSE))
+        return CULL_SSE;
+    return CULL_SCALAR;
+}
+
+const char *FrustumCuller::kernelName(CullingKernel kernel)
+{
+    switch (kernel)
+    {
+        case CULL_SSE: return "sse";
+        case CULL_AVX: return "avx";
+        default:       return "scalar";
+    }
+}
+
+void FrustumCuller::cullRange(const Frustum &frustum, std::uint32_t begin, std::uint32_t end,
+                              std::vector<std::uint32_t> &visible, CullingKernel kernel) const
+{
+    SoaView soa{ centerX.data(), centerY.data(), centerZ.data(),
+                 extentX.data(), extentY.data(), extentZ.data(), ids.data() };
+    switch (kernel)
+    {
+#ifdef __AVX__
+        case CULL_AVX: cullAvx(frustum, soa, begin, end, visible); return;
+#endif
+#ifdef LEARN_OPENGL_HAS_SSE
+        case CULL_SSE: cullSse(frustum, soa, begin, end, visible); return;
+#endif
+        default: cullScalar(frustum, soa, begin, end, visible); return;
+    }
+}
+
+void FrustumCuller::acceptRange(std::uint32_t begin, std::uint32_t end, std::vector<std::uint32_t> &visible) const
+{
+    visible.insert(visible.end(), ids.begin() + begin, ids.begin() + end);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+#include "bvh.h"
+#include "frustum.h"
+
+enum CullingKernel
+{
+    CULL_SCALAR, // reference implementation
+    CULL_SSE,    // 4 boxes per iteration
+    CULL_AVX,    // 8 boxes per iteration, needs LEARN_OPENGL_AVX
+};
+
+// Frustum culling for large sets of static world-space boxes. The boxes are stored
+// center/extent in SoA layout and in BVH leaf order, so every leaf the hierarchy
+// cannot reject is one contiguous run for the SIMD kernels.
+class FrustumCuller
+{
+public:
+    // Returns the id cull() reports for this box. Call build() after adding.
+    std::uint32_t add(const AABB &worldBounds);
+    void clear();
+    void build(unsigned int maxLeafSize = 16);
+    // Moves a built box and refits the hierarchy over it (see Bvh::refit); for the odd object
+    // that moves, a full build() suits a scene that mostly does.
+    void update(std::uint32_t id, const AABB &worldBounds);
+
+    // Appends the ids of visible boxes, walking the BVH.
+    void cull(const Frustum &frustum, std::vector<std::uint32_t> &visible,
+              CullingKernel kernel = bestKernel()) const;
+    // Tests every box, ignoring the hierarchy; the baseline the BVH is measured against.
+    void cullFlat(const Frustum &frustum, std::vector<std::uint32_t> &visible,
+                  CullingKernel kernel = bestKernel()) const;
+
+    std::size_t size() const { return ids.size(); }
+
+    static bool isSupported(CullingKernel kernel);
+    static CullingKernel bestKernel();
+    static const char *kernelName(CullingKernel kernel);
+
+private:
+    std::vector<AABB> boxes; // in add() order
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<std::uint32_t> ids; // BVH order -> id
+    std::vector<std::uint32_t> slots; // id -> BVH order
+    Bvh bvh;
+
+    void cullRange(const Frustum &frustum, std::uint32_t begin, std::uint32_t end,
+                   std::vector<std::uint32_t> &visible, CullingKernel kernel) const;
+    void acceptRange(std::uint32_t begin, std::uint32_t end, std::vector<std::uint32_t> &visible) const;
+    // copies boxes[ids[slot]] into the SoA columns
+    void storeSlot(std::uint32_t slot);
+};
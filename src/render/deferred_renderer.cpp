@@ -0,0 +1,207 @@
+#include "deferred_renderer.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "shadow_maps.h"
+
+namespace
+{
+    // a coarse sphere is enough: the fragment shader cuts each light off at its radius
+    constexpr int SPHERE_SEGMENTS = 16;
+    constexpr int SPHERE_RINGS = 8;
+}
+
+const char *renderPathName(RenderPath path)
+{
+    return path == RENDER_DEFERRED ? "deferred" : "forward";
+}
+
+DeferredRenderer::DeferredRenderer()
+    : geometryPass("shaders/vertexShaderDefault.glsl", "shaders/fragmentShaderGBuffer.glsl"),
+      globalLightPass("shaders/vertexShaderFullscreen.glsl", "shaders/fragmentShaderDeferredLights.glsl"),
+      lightVolumePass("shaders/vertexShaderLightVolume.glsl", "shaders/fragmentShaderLightVolume.glsl"),
+      emptyVertexArray(GLVertexArray::create())
+{
+    createSphere();
+}
+
+void DeferredRenderer::linkShaders(float shininess)
+{
+    geometryPass.use();
+    for (const Shader *pass : { &globalLightPass, &lightVolumePass })
+    {
+        pass->use();
+        pass->setSampler("gAlbedoSpecular", FIRST_TEXTURE_UNIT);
+        pass->setSampler("gNormal", FIRST_TEXTURE_UNIT + 1);
+        pass->setSampler("gDepth", FIRST_TEXTURE_UNIT + 2);
+        pass->set(pass->uniform<float>("shininess"), shininess);
+    }
+    ShadowMaps::setSamplers(globalLightPass);
+}
+
+bool DeferredRenderer::beginGeometry(int newWidth, int newHeight)
+{
+    if ((newWidth != width || newHeight != height) && !allocate(newWidth, newHeight))
+        return false;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+    const GLenum geometryBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+    glDrawBuffers(3, geometryBuffers);
+    // blending would mix the G-buffer channels with what was there, and a cleared depth of 0 marks the sky
+    GLState::setBlend(false);
+    GLState::setDepthMask(true);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    return true;
+}
+
+void DeferredRenderer::shade(std::span<const ClusterLight> lights, unsigned int targetFramebuffer)
+{
+    // both passes write only the lighting target and read the rest with texelFetch
+    const GLenum lightingBuffer = GL_COLOR_ATTACHMENT3;
+    glDrawBuffers(1, &lightingBuffer);
+    GLState::bindTexture(FIRST_TEXTURE_UNIT, GL_TEXTURE_2D, albedoSpecular.get());
+    GLState::bindTexture(FIRST_TEXTURE_UNIT + 1, GL_TEXTURE_2D, normal.get());
+    GLState::bindTexture(FIRST_TEXTURE_UNIT + 2, GL_TEXTURE_2D, depth.get());
+    GLState::setPolygonMode(GL_FILL);
+
+    GLState::setDepthTest(false);
+    globalLightPass.use();
+    GLState::bindVertexArray(emptyVertexArray.get());
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    frameStats.lightVolumes = (unsigned int)lights.size();
+    if (!lights.empty())
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.get());
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)lights.size_bytes(), nullptr, GL_STREAM_DRAW); // orphan
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)lights.size_bytes(), lights.data());
+
+        GLState::setDepthTest(true);
+        GLState::setDepthMask(false);
+        GLState::setDepthFunc(GL_GEQUAL);
+        GLState::setBlend(true);
+        GLState::setBlendFunc(GL_ONE, GL_ONE);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_DEPTH_CLAMP); // a far side past the far plane still has to be drawn
+        lightVolumePass.use();
+        GLState::bindVertexArray(sphereVertexArray.get());
+        glDrawElementsInstanced(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_SHORT, nullptr, (GLsizei)lights.size());
+        glDisable(GL_DEPTH_CLAMP);
+        glDisable(GL_CULL_FACE);
+        GLState::setDepthFunc(GL_LESS);
+        GLState::setDepthMask(true);
+    }
+    GLState::setDepthTest(true);
+    GLState::setBlend(true);
+    GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.get());
+    glReadBuffer(GL_COLOR_ATTACHMENT3);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT,
+                      GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+}
+
+bool DeferredRenderer::allocate(int newWidth, int newHeight)
+{
+    width = newWidth;
+    height = newHeight;
+    framebuffer = GLFramebuffer::create();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+
+    auto attachTexture = [&](GLTexture &texture, GLenum attachment, GLint internalFormat, GLenum format, GLenum type) {
+        texture = GLTexture::create();
+        GLState::bindTexture(FIRST_TEXTURE_UNIT, GL_TEXTURE_2D, texture.get());
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture.get(), 0);
+    };
+    attachTexture(albedoSpecular, GL_COLOR_ATTACHMENT0, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+    attachTexture(normal, GL_COLOR_ATTACHMENT1, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+    attachTexture(depth, GL_COLOR_ATTACHMENT2, GL_R32F, GL_RED, GL_FLOAT);
+
+    // only ever blitted, so neither needs to be a texture
+    auto attachRenderbuffer = [&](GLRenderbuffer &renderbuffer, GLenum attachment, GLenum internalFormat) {
+        renderbuffer = GLRenderbuffer::create();
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer.get());
+        glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, renderbuffer.get());
+    };
+    attachRenderbuffer(lighting, GL_COLOR_ATTACHMENT3, GL_RGBA8);
+    // the format of the forward targets, which glBlitFramebuffer needs to copy depth
+    attachRenderbuffer(depthStencil, GL_DEPTH_STENCIL_ATTACHMENT, GL_DEPTH24_STENCIL8);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::DEFERRED::GBUFFER_INCOMPLETE " << width << "x" << height << std::endl;
+        width = height = 0;
+        return false;
+    }
+    return true;
+}
+
+void DeferredRenderer::createSphere()
+{
+    // enlarged so its flat faces stay outside the unit sphere they approximate
+    float enclose = 1.0f / (std::cos(glm::pi<float>() / SPHERE_SEGMENTS) * std::cos(glm::pi<float>() / (2 * SPHERE_RINGS)));
+    std::vector<glm::vec3> positions;
+    for (int ring = 0; ring <= SPHERE_RINGS; ring++)
+    {
+        float polar = glm::pi<float>() * (float)ring / SPHERE_RINGS;
+        for (int segment = 0; segment < SPHERE_SEGMENTS; segment++)
+        {
+            float azimuth = glm::two_pi<float>() * (float)segment / SPHERE_SEGMENTS;
+            positions.push_back(glm::vec3(std::sin(polar) * std::cos(azimuth), std::cos(polar),
+                                          std::sin(polar) * std::sin(azimuth)) * enclose);
+        }
+    }
+    // counter-clockwise seen from outside; the pole rows give degenerate triangles, which draw nothing
+    std::vector<std::uint16_t> indices;
+    for (int ring = 0; ring < SPHERE_RINGS; ring++)
+    {
+        for (int segment = 0; segment < SPHERE_SEGMENTS; segment++)
+        {
+            auto a = (std::uint16_t)(ring * SPHERE_SEGMENTS + segment);
+            auto b = (std::uint16_t)(ring * SPHERE_SEGMENTS + (segment + 1) % SPHERE_SEGMENTS);
+            auto c = (std::uint16_t)(a + SPHERE_SEGMENTS);
+            auto d = (std::uint16_t)(b + SPHERE_SEGMENTS);
+            indices.insert(indices.end(), { a, b, c, b, d, c });
+        }
+    }
+    sphereIndexCount = (int)indices.size();
+
+    sphereVertexArray = GLVertexArray::create();
+    sphereVertices = GLBuffer::create();
+    sphereIndices = GLBuffer::create();
+    instanceBuffer = GLBuffer::create();
+    GLState::bindVertexArray(sphereVertexArray.get());
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVertices.get());
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(positions.size() * sizeof(glm::vec3)), positions.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIndices.get());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(indices.size() * sizeof(std::uint16_t)), indices.data(),
+                 GL_STATIC_DRAW);
+
+    // the lights go up as they are, one ClusterLight per instance
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.get());
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ClusterLight), (void *)offsetof(ClusterLight, position));
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ClusterLight), (void *)offsetof(ClusterLight, color));
+    for (GLuint attribute : { 1u, 2u })
+    {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+    GLState::bindVertexArray(0);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <span>
+
+#include "gl_handle.h"
+#include "light_clusters.h"
+#include "shader.h"
+
+enum RenderPath
+{
+    RENDER_FORWARD = 0,  // Phong variants, the scene's ranged lights through LightClusters
+    RENDER_DEFERRED = 1, // DeferredRenderer
+};
+
+const char *renderPathName(RenderPath path);
+
+struct DeferredStats
+{
+    unsigned int lightVolumes = 0;
+};
+
+// Deferred shading. The opaque and cutout draws go once through geometryShader() into a
+// G-buffer (albedo and specular intensity, view-space normal, view-space depth), then the
+// lighting is drawn into a color target of the same framebuffer:
+//   1. a full-screen pass for the LightData lights, which reach every pixel anyway
+//   2. one instanced draw of sphere volumes for the ranged lights: back faces tested
+//      GL_GEQUAL against the scene depth, so a light only shades pixels whose surface is
+//      in front of its far side, whether or not the camera is inside it
+// shade() then blits color and depth to the target framebuffer, where the forward path
+// draws what the G-buffer can't hold, like blended surfaces.
+class DeferredRenderer
+{
+public:
+    // the G-buffer textures take this unit and the two after it, past LightClusters'
+    static constexpr unsigned int FIRST_TEXTURE_UNIT = LightClusters::FIRST_TEXTURE_UNIT + 3;
+
+    // Submits the programs; see Shader.
+    DeferredRenderer();
+
+    // Waits for the programs and sets the uniforms that never change.
+    void linkShaders(float shininess);
+
+    const Shader &geometryShader() const { return geometryPass; }
+
+    // Binds the G-buffer, (re)allocated to the given size, and clears it.
+    bool beginGeometry(int width, int height);
+    // Lights the G-buffer, then copies it into targetFramebuffer and leaves that bound, with
+    // depth testing and alpha blending on again, as the forward path draws.
+    void shade(std::span<const ClusterLight> lights, unsigned int targetFramebuffer);
+
+    const DeferredStats &stats() const { return frameStats; }
+
+private:
+    Shader geometryPass;
+    Shader globalLightPass;
+    Shader lightVolumePass;
+
+    GLFramebuffer framebuffer;
+    GLTexture albedoSpecular, normal, depth;
+    GLRenderbuffer lighting, depthStencil;
+    int width = 0;
+    int height = 0;
+
+    GLVertexArray emptyVertexArray; // the full-screen triangle has no attributes
+    GLVertexArray sphereVertexArray;
+    GLBuffer sphereVertices, sphereIndices, instanceBuffer;
+    int sphereIndexCount = 0;
+
+    DeferredStats frameStats;
+
+    bool allocate(int newWidth, int newHeight);
+    void createSphere();
+};
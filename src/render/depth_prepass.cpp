@@ -0,0 +1,81 @@
+#include "depth_prepass.h"
+
+#include <string>
+#include <glad/glad.h>
+
+#include "gl_state.h"
+
+namespace
+{
+    const std::string OVERDRAW_DEFINES[] = { "OVERDRAW" };
+}
+
+DepthPrepass::DepthPrepass()
+    : depthPass("shaders/vertexShaderDefault.glsl", "shaders/fragmentShaderDepthOnly.glsl"),
+      overdrawPass("shaders/vertexShaderDefault.glsl", "shaders/fragmentShaderDepthOnly.glsl", OVERDRAW_DEFINES)
+{
+    for (QuerySlot &slot : slots)
+        slot.query = GLQuery::create();
+}
+
+void DepthPrepass::linkShaders()
+{
+    depthPass.use();
+    overdrawPass.use();
+}
+
+void DepthPrepass::fillDepth(RenderQueue &queue, Profiler *profiler)
+{
+    if (!enabled)
+        return;
+    GLState::setColorMask(false);
+    GLState::setDepthMask(true);
+    GLState::setDepthFunc(GL_LESS);
+    queue.executeDepthOnly(depthPass, profiler);
+    GLState::setColorMask(true);
+}
+
+const Shader *DepthPrepass::beginShading(int pixels)
+{
+    QuerySlot &slot = slots[frameIndex++ % slots.size()];
+    if (slot.pending)
+        resolve(slot);
+    glBeginQuery(GL_SAMPLES_PASSED, slot.query.get());
+    slot.pixels = pixels;
+    slot.pending = true;
+
+    if (enabled)
+    {
+        GLState::setDepthFunc(GL_LEQUAL);
+        GLState::setDepthMask(false);
+    }
+    if (!showOverdraw)
+        return nullptr;
+    GLState::setBlend(true);
+    GLState::setBlendFunc(GL_ONE, GL_ONE);
+    return &overdrawPass;
+}
+
+void DepthPrepass::endShading()
+{
+    glEndQuery(GL_SAMPLES_PASSED);
+    GLState::setDepthFunc(GL_LESS);
+    GLState::setDepthMask(true);
+    GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void DepthPrepass::resolve(QuerySlot &slot)
+{
+    slot.pending = false;
+    GLint available = 0;
+    glGetQueryObjectiv(slot.query.get(), GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+    {
+        frameStats.lateFrames++;
+        return;
+    }
+    GLuint64 samples = 0;
+    glGetQueryObjectui64v(slot.query.get(), GL_QUERY_RESULT, &samples);
+    frameStats.shadedSamples = samples;
+    frameStats.shadedPerPixel = slot.pixels > 0 ? (float)samples / (float)slot.pixels : 0.0f;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "gl_handle.h"
+#include "render_queue.h"
+#include "shader.h"
+#include "systems/profiler.h"
+
+struct DepthPrepassStats
+{
+    // samples that passed the depth test in the shading pass, and that per pixel of the
+    // target, as of the newest frame whose query has come back
+    std::uint64_t shadedSamples = 0;
+    float shadedPerPixel = 0.0f;
+    unsigned int lateFrames = 0; // queries not back after Profiler::FRAME_LATENCY frames, dropped
+};
+
+// Optional depth-only pass ahead of the shading pass. The queue's opaque and cutout draws
+// first fill the depth buffer with a program that only runs the alpha test; the shading
+// pass then tests GL_LEQUAL with depth writes off, so each pixel is shaded by its nearest
+// surface only. Without depth writes, the discard in the Phong shader no longer keeps the
+// driver from rejecting hidden fragments before they are shaded.
+//
+// Each shading pass is counted with a GL_SAMPLES_PASSED query, pre-pass or not, and the
+// overdraw view draws the queue with a program that just adds up its fragments instead.
+// Queries are read back like Profiler's, late and without stalling.
+class DepthPrepass
+{
+public:
+    bool enabled = false;
+    bool showOverdraw = false;
+
+    // Submits the programs and creates the queries; needs a current context.
+    DepthPrepass();
+
+    // Waits for the programs.
+    void linkShaders();
+
+    // Draws the queue's opaque and cutout commands into the depth buffer alone, if enabled.
+    void fillDepth(RenderQueue &queue, Profiler *profiler);
+
+    // Sets up depth testing and blending for the queue's shading pass and starts counting it.
+    // Returns the overdraw program when the queue should be drawn with it, otherwise nullptr.
+    const Shader *beginShading(int pixels);
+    // Back to GL_LESS with depth writes and alpha blending, as the other passes expect.
+    void endShading();
+
+    const DepthPrepassStats &stats() const { return frameStats; }
+
+private:
+    struct QuerySlot
+    {
+        GLQuery query;
+        int pixels = 0;
+        bool pending = false;
+    };
+
+    Shader depthPass;
+    Shader overdrawPass;
+    std::array<QuerySlot, Profiler::FRAME_LATENCY> slots;
+    unsigned int frameIndex = 0;
+    DepthPrepassStats frameStats;
+
+    void resolve(QuerySlot &slot);
+};
@@ -0,0 +1,54 @@
+#include "frustum.h"
+
+#include <cmath>
+
+Frustum Frustum::fromMatrix(const glm::mat4 &m)
+{
+    // Gribb & Hartmann: each plane is the last row of the matrix plus or minus another row
+    auto row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+
+    Frustum frustum{};
+    frustum.planes[0] = row(3) + row(0);
+    frustum.planes[1] = row(3) - row(0);
+    frustum.planes[2] = row(3) + row(1);
+    frustum.planes[3] = row(3) - row(1);
+    frustum.planes[4] = row(3) + row(2);
+    frustum.planes[5] = row(3) - row(2);
+    for (glm::vec4 &plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+bool Frustum::intersects(const BoundingSphere &sphere) const
+{
+    for (const glm::vec4 &plane : planes)
+    {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersects(const AABB &box) const
+{
+    return classify(box) != FRUSTUM_OUTSIDE;
+}
+
+FrustumTest Frustum::classify(const AABB &box) const
+{
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.extent();
+
+    FrustumTest result = FRUSTUM_INSIDE;
+    for (const glm::vec4 &plane : planes)
+    {
+        glm::vec3 normal(plane);
+        float distance = glm::dot(normal, center) + plane.w;
+        float radius = glm::dot(glm::abs(normal), extent);
+        if (distance + radius < 0.0f)
+            return FRUSTUM_OUTSIDE;
+        if (distance - radius < 0.0f)
+            result = FRUSTUM_INTERSECTS;
+    }
+    return result;
+}
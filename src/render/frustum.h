@@ -0,0 +1,26 @@
+#pragma once
+
+#include <array>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+enum FrustumTest
+{
+    FRUSTUM_OUTSIDE,
+    FRUSTUM_INTERSECTS,
+    FRUSTUM_INSIDE,
+};
+
+// Six normalized planes (xyz = inward normal, w = distance), extracted from a
+// view-projection matrix. Order: left, right, bottom, top, near, far.
+struct Frustum
+{
+    std::array<glm::vec4, 6> planes;
+
+    static Frustum fromMatrix(const glm::mat4 &viewProjection);
+
+    bool intersects(const BoundingSphere &sphere) const;
+    bool intersects(const AABB &box) const;
+    FrustumTest classify(const AABB &box) const;
+};
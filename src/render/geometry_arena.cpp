@@ -0,0 +1,145 @@
+#include "geometry_arena.h"
+
+#include <algorithm>
+#include <utility>
+#include <glm/glm.hpp>
+
+#include "gl_state.h"
+
+GeometryArena::Allocation::Allocation(Allocation &&other) noexcept
+    : block(std::exchange(other.block, nullptr)), firstVertex(other.firstVertex), vertexCount(other.vertexCount),
+      indexOffset(other.indexOffset), indexBytes(other.indexBytes)
+{
+}
+
+GeometryArena::Allocation &GeometryArena::Allocation::operator=(Allocation &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        block = std::exchange(other.block, nullptr);
+        firstVertex = other.firstVertex;
+        vertexCount = other.vertexCount;
+        indexOffset = other.indexOffset;
+        indexBytes = other.indexBytes;
+    }
+    return *this;
+}
+
+unsigned int GeometryArena::Allocation::vertexArray() const
+{
+    return block != nullptr ? block->vertexArray.get() : 0;
+}
+
+unsigned int GeometryArena::Allocation::vertexBuffer() const
+{
+    return block != nullptr ? block->vertices.get() : 0;
+}
+
+unsigned int GeometryArena::Allocation::indexBuffer() const
+{
+    return block != nullptr ? block->indices.get() : 0;
+}
+
+void GeometryArena::Allocation::attachInstanceBuffers(unsigned int transformBuffer, unsigned int tintBuffer) const
+{
+    if (block == nullptr)
+        return;
+
+    GLState::bindVertexArray(block->vertexArray.get());
+
+    glBindBuffer(GL_ARRAY_BUFFER, transformBuffer);
+    for (unsigned int column = 0; column < 4; column++)
+    {
+        unsigned int location = INSTANCE_MATRIX_LOCATION + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, tintBuffer);
+    glVertexAttribPointer(INSTANCE_TINT_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+    glVertexAttribDivisor(INSTANCE_TINT_LOCATION, 1);
+}
+
+void GeometryArena::Allocation::reset()
+{
+    if (block == nullptr)
+        return;
+    block->vertexSpace.free(firstVertex, vertexCount);
+    block->indexSpace.free(indexOffset, indexBytes);
+    block->allocations--;
+    block = nullptr;
+}
+
+GeometryArena::Allocation GeometryArena::allocate(std::size_t vertexCount, std::size_t indexBytes)
+{
+    Allocation allocation;
+    if (vertexCount == 0 || indexBytes == 0)
+        return allocation;
+
+    auto tryBlock = [&](Block &block) {
+        std::size_t firstVertex = block.vertexSpace.allocate(vertexCount);
+        if (firstVertex == FreeListAllocator::INVALID)
+            return false;
+        std::size_t indexOffset = block.indexSpace.allocate(indexBytes, sizeof(std::uint32_t));
+        if (indexOffset == FreeListAllocator::INVALID)
+        {
+            block.vertexSpace.free(firstVertex, vertexCount);
+            return false;
+        }
+
+        block.allocations++;
+        allocation.block = &block;
+        allocation.firstVertex = firstVertex;
+        allocation.vertexCount = vertexCount;
+        allocation.indexOffset = indexOffset;
+        allocation.indexBytes = indexBytes;
+        return true;
+    };
+
+    for (const std::unique_ptr<Block> &block : blocks)
+    {
+        if (tryBlock(*block))
+            return allocation;
+    }
+
+    // meshes larger than a block get a block of their own size
+    tryBlock(addBlock(std::max(vertexCount, BLOCK_VERTICES), std::max(indexBytes, BLOCK_INDEX_BYTES)));
+    return allocation;
+}
+
+GeometryArenaStats GeometryArena::stats() const
+{
+    GeometryArenaStats stats;
+    for (const std::unique_ptr<Block> &block : blocks)
+    {
+        stats.blocks++;
+        stats.allocations += block->allocations;
+        stats.capacityBytes += block->vertexSpace.capacity() * sizeof(GpuVertex) + block->indexSpace.capacity();
+        stats.usedBytes += block->vertexSpace.used() * sizeof(GpuVertex) + block->indexSpace.used();
+        stats.freeRanges += block->vertexSpace.freeRangeCount() + block->indexSpace.freeRangeCount();
+        stats.fragmentation = std::max({ stats.fragmentation, block->vertexSpace.fragmentation(),
+                                         block->indexSpace.fragmentation() });
+    }
+    return stats;
+}
+
+GeometryArena::Block &GeometryArena::addBlock(std::size_t vertexCapacity, std::size_t indexCapacity)
+{
+    auto &block = blocks.emplace_back(std::make_unique<Block>());
+    block->vertexArray = GLVertexArray::create();
+    block->vertices = GLBuffer::create();
+    block->indices = GLBuffer::create();
+    block->vertexSpace = FreeListAllocator(vertexCapacity);
+    block->indexSpace = FreeListAllocator(indexCapacity);
+
+    // the element buffer binding is VAO state, so it is set once here for every mesh in the block
+    GLState::bindVertexArray(block->vertexArray.get());
+    glBindBuffer(GL_ARRAY_BUFFER, block->vertices.get());
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(vertexCapacity * sizeof(GpuVertex)), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->indices.get());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexCapacity, nullptr, GL_STATIC_DRAW);
+    setVertexAttributes<GpuVertex>();
+    return *block;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "lib/free_list_allocator.h"
+#include "gl_handle.h"
+#include "vertex_format.h"
+
+struct GeometryArenaStats
+{
+    unsigned int blocks = 0;
+    unsigned int allocations = 0;
+    std::size_t capacityBytes = 0;
+    std::size_t usedBytes = 0;
+    std::size_t freeRanges = 0;
+    float fragmentation = 0.0f; // worst block; share of its free space outside the largest free range
+
+    float utilisation() const { return capacityBytes > 0 ? (float)usedBytes / (float)capacityBytes : 0.0f; }
+};
+
+// Shared storage for mesh geometry. Vertices and indices are sub-allocated from a few large
+// blocks, each one vertex buffer and one index buffer behind a single VAO for GpuVertex,
+// so draws differ only in their base vertex and index offset and rarely switch VAOs.
+// Blocks never move or grow, so uploads queued against an allocation stay valid.
+class GeometryArena
+{
+    struct Block;
+
+public:
+    static constexpr std::size_t BLOCK_VERTICES = 1 << 20;
+    static constexpr std::size_t BLOCK_INDEX_BYTES = 16 << 20;
+
+    // One mesh's ranges; returns them to the arena when destroyed. The arena must outlive it.
+    class Allocation
+    {
+    public:
+        Allocation() = default;
+        ~Allocation() { reset(); }
+
+        Allocation(const Allocation &) = delete;
+        Allocation &operator=(const Allocation &) = delete;
+        Allocation(Allocation &&other) noexcept;
+        Allocation &operator=(Allocation &&other) noexcept;
+
+        bool valid() const { return block != nullptr; }
+        unsigned int vertexArray() const;
+        unsigned int vertexBuffer() const;
+        unsigned int indexBuffer() const;
+        int baseVertex() const { return (int)firstVertex; }
+        std::size_t vertexByteOffset() const { return firstVertex * sizeof(GpuVertex); }
+        std::size_t indexByteOffset() const { return indexOffset; }
+
+        // Points the VAO's per-instance attributes at the given buffers. The VAO is shared,
+        // so instanced draws must call this before every draw from a different source.
+        void attachInstanceBuffers(unsigned int transformBuffer, unsigned int tintBuffer) const;
+
+        void reset();
+
+    private:
+        friend class GeometryArena;
+
+        Block *block = nullptr;
+        std::size_t firstVertex = 0;
+        std::size_t vertexCount = 0;
+        std::size_t indexOffset = 0;
+        std::size_t indexBytes = 0;
+    };
+
+    GeometryArena() = default;
+
+    GeometryArena(const GeometryArena &) = delete;
+    GeometryArena &operator=(const GeometryArena &) = delete;
+
+    // Storage only, the caller uploads. Indices are 4-byte aligned, so either index size fits.
+    // Returns an invalid allocation for empty meshes.
+    Allocation allocate(std::size_t vertexCount, std::size_t indexBytes);
+
+    GeometryArenaStats stats() const;
+
+private:
+    struct Block
+    {
+        GLVertexArray vertexArray;
+        GLBuffer vertices;
+        GLBuffer indices;
+        FreeListAllocator vertexSpace; // in vertices
+        FreeListAllocator indexSpace;  // in bytes
+        unsigned int allocations = 0;
+    };
+
+    std::vector<std::unique_ptr<Block>> blocks; // boxed, so allocations can point at them
+
+    Block &addBlock(std::size_t vertexCapacity, std::size_t indexCapacity);
+};
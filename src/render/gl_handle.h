@@ -0,0 +1,105 @@
+#pragma once
+
+#include <utility>
+#include <glad/glad.h>
+
+#include "gl_state.h"
+
+// Move-only owner of a single OpenGL object name. The object is deleted when the
+// handle goes out of scope, so GPU resources follow normal C++ ownership rules.
+template <typename Traits>
+class GLHandle
+{
+public:
+    GLHandle() = default;
+    explicit GLHandle(unsigned int id) : id(id) {}
+    ~GLHandle() { reset(); }
+
+    GLHandle(const GLHandle &) = delete;
+    GLHandle &operator=(const GLHandle &) = delete;
+
+    GLHandle(GLHandle &&other) noexcept : id(std::exchange(other.id, 0)) {}
+    GLHandle &operator=(GLHandle &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            id = std::exchange(other.id, 0);
+        }
+        return *this;
+    }
+
+    static GLHandle create() { return GLHandle(Traits::create()); }
+
+    unsigned int get() const { return id; }
+    explicit operator bool() const { return id != 0; }
+
+    void reset()
+    {
+        if (id != 0)
+        {
+            Traits::destroy(id);
+            id = 0;
+        }
+    }
+
+private:
+    unsigned int id = 0;
+};
+
+struct VertexArrayTraits
+{
+    static unsigned int create() { unsigned int id; glGenVertexArrays(1, &id); return id; }
+    static void destroy(unsigned int id) { GLState::forgetVertexArray(id); glDeleteVertexArrays(1, &id); }
+};
+
+struct BufferTraits
+{
+    static unsigned int create() { unsigned int id; glGenBuffers(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteBuffers(1, &id); }
+};
+
+struct TextureTraits
+{
+    static unsigned int create() { unsigned int id; glGenTextures(1, &id); return id; }
+    static void destroy(unsigned int id) { GLState::forgetTexture(id); glDeleteTextures(1, &id); }
+};
+
+struct ProgramTraits
+{
+    static unsigned int create() { return glCreateProgram(); }
+    static void destroy(unsigned int id) { GLState::forgetProgram(id); glDeleteProgram(id); }
+};
+
+struct FramebufferTraits
+{
+    static unsigned int create() { unsigned int id; glGenFramebuffers(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteFramebuffers(1, &id); }
+};
+
+struct RenderbufferTraits
+{
+    static unsigned int create() { unsigned int id; glGenRenderbuffers(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteRenderbuffers(1, &id); }
+};
+
+struct QueryTraits
+{
+    static unsigned int create() { unsigned int id; glGenQueries(1, &id); return id; }
+    static void destroy(unsigned int id) { glDeleteQueries(1, &id); }
+};
+
+// Shader objects need a stage at creation, so construct these with glCreateShader(type).
+struct ShaderObjectTraits
+{
+    static void destroy(unsigned int id) { glDeleteShader(id); }
+};
+
+using GLVertexArray = GLHandle<VertexArrayTraits>;
+using GLBuffer = GLHandle<BufferTraits>;
+using GLTexture = GLHandle<TextureTraits>;
+using GLProgram = GLHandle<ProgramTraits>;
+using GLShaderObject = GLHandle<ShaderObjectTraits>;
+using GLFramebuffer = GLHandle<FramebufferTraits>;
+using GLRenderbuffer = GLHandle<RenderbufferTraits>;
+using GLQuery = GLHandle<QueryTraits>;
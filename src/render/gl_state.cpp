@@ -0,0 +1,199 @@
+#include "gl_state.h"
+
+#include <array>
+
+namespace
+{
+    enum TextureTarget
+    {
+        TARGET_2D,
+        TARGET_2D_ARRAY,
+        TARGET_CUBE_MAP,
+        TARGET_BUFFER,
+        TARGET_COUNT
+    };
+
+    TextureTarget targetIndex(GLenum target)
+    {
+        switch (target)
+        {
+            case GL_TEXTURE_2D_ARRAY: return TARGET_2D_ARRAY;
+            case GL_TEXTURE_CUBE_MAP: return TARGET_CUBE_MAP;
+            case GL_TEXTURE_BUFFER:   return TARGET_BUFFER;
+            default:                  return TARGET_2D;
+        }
+    }
+
+    // ~0u marks a value as unknown, so the next set always reaches the driver
+    constexpr unsigned int UNKNOWN = ~0u;
+
+    struct ShadowState
+    {
+        unsigned int program = UNKNOWN;
+        unsigned int vertexArray = UNKNOWN;
+        unsigned int activeUnit = UNKNOWN;
+        std::array<std::array<unsigned int, TARGET_COUNT>, GLState::MAX_TEXTURE_UNITS> textures;
+
+        unsigned int blend = UNKNOWN;
+        unsigned int blendSource = UNKNOWN;
+        unsigned int blendDestination = UNKNOWN;
+        unsigned int depthTest = UNKNOWN;
+        unsigned int depthMask = UNKNOWN;
+        unsigned int depthFunc = UNKNOWN;
+        unsigned int colorMask = UNKNOWN;
+        unsigned int polygonMode = UNKNOWN;
+
+        ShadowState()
+        {
+            for (auto &unit : textures)
+                unit.fill(UNKNOWN);
+        }
+    };
+
+    ShadowState state;
+    GLStateStats counters;
+
+    // Records the new value and reports whether the call has to be issued.
+    bool changes(unsigned int &cached, unsigned int value)
+    {
+        if (cached == value)
+        {
+            counters.skipped++;
+            return false;
+        }
+        cached = value;
+        counters.issued++;
+        return true;
+    }
+
+    void setCapability(unsigned int &cached, GLenum capability, bool enabled)
+    {
+        if (!changes(cached, enabled))
+            return;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+}
+
+void GLState::useProgram(unsigned int program)
+{
+    if (changes(state.program, program))
+        glUseProgram(program);
+}
+
+void GLState::bindVertexArray(unsigned int vertexArray)
+{
+    if (changes(state.vertexArray, vertexArray))
+        glBindVertexArray(vertexArray);
+}
+
+void GLState::bindTexture(unsigned int unit, GLenum target, unsigned int texture)
+{
+    if (unit >= MAX_TEXTURE_UNITS)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        state.activeUnit = UNKNOWN;
+        counters.issued += 2;
+        return;
+    }
+
+    unsigned int &bound = state.textures[unit][targetIndex(target)];
+    if (bound == texture)
+    {
+        counters.skipped++;
+        return;
+    }
+    if (changes(state.activeUnit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    bound = texture;
+    counters.issued++;
+    glBindTexture(target, texture);
+}
+
+void GLState::setBlend(bool enabled)
+{
+    setCapability(state.blend, GL_BLEND, enabled);
+}
+
+void GLState::setBlendFunc(GLenum source, GLenum destination)
+{
+    if (state.blendSource == source && state.blendDestination == destination)
+    {
+        counters.skipped++;
+        return;
+    }
+    state.blendSource = source;
+    state.blendDestination = destination;
+    counters.issued++;
+    glBlendFunc(source, destination);
+}
+
+void GLState::setDepthTest(bool enabled)
+{
+    setCapability(state.depthTest, GL_DEPTH_TEST, enabled);
+}
+
+void GLState::setDepthMask(bool enabled)
+{
+    if (changes(state.depthMask, enabled))
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::setDepthFunc(GLenum func)
+{
+    if (changes(state.depthFunc, func))
+        glDepthFunc(func);
+}
+
+void GLState::setColorMask(bool enabled)
+{
+    if (changes(state.colorMask, enabled))
+    {
+        GLboolean mask = enabled ? GL_TRUE : GL_FALSE;
+        glColorMask(mask, mask, mask, mask);
+    }
+}
+
+void GLState::setPolygonMode(GLenum mode)
+{
+    if (changes(state.polygonMode, mode))
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void GLState::forgetProgram(unsigned int program)
+{
+    if (state.program == program)
+        state.program = UNKNOWN;
+}
+
+void GLState::forgetVertexArray(unsigned int vertexArray)
+{
+    if (state.vertexArray == vertexArray)
+        state.vertexArray = UNKNOWN;
+}
+
+void GLState::forgetTexture(unsigned int texture)
+{
+    for (auto &unit : state.textures)
+        for (unsigned int &bound : unit)
+            if (bound == texture)
+                bound = UNKNOWN;
+}
+
+void GLState::invalidate()
+{
+    state = ShadowState();
+}
+
+const GLStateStats &GLState::stats()
+{
+    return counters;
+}
+
+void GLState::resetStats()
+{
+    counters = {};
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/glad.h>
+
+struct GLStateStats
+{
+    unsigned int issued = 0;
+    unsigned int skipped = 0;
+};
+
+// Shadow copy of the GL state the renderer changes most often. Every setter compares
+// against the last value it issued and drops the call when nothing would change.
+// All program, VAO, texture, blend, depth, color-mask and polygon-mode changes must go through here,
+// otherwise the shadow copy goes stale; call invalidate() after touching them directly.
+class GLState
+{
+public:
+    static constexpr unsigned int MAX_TEXTURE_UNITS = 32;
+
+    static void useProgram(unsigned int program);
+    static void bindVertexArray(unsigned int vertexArray);
+    static void bindTexture(unsigned int unit, GLenum target, unsigned int texture);
+
+    static void setBlend(bool enabled);
+    static void setBlendFunc(GLenum source, GLenum destination);
+    static void setDepthTest(bool enabled);
+    static void setDepthMask(bool enabled);
+    static void setDepthFunc(GLenum func);
+    static void setColorMask(bool enabled); // all four channels at once
+    static void setPolygonMode(GLenum mode);
+
+    // GL recycles deleted names, so forget them or a new object could be mistaken as bound.
+    static void forgetProgram(unsigned int program);
+    static void forgetVertexArray(unsigned int vertexArray);
+    static void forgetTexture(unsigned int texture);
+
+    static void invalidate();
+
+    static const GLStateStats &stats();
+    static void resetStats();
+};
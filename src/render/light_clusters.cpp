@@ -0,0 +1,359 @@
+#include "light_clusters.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <glad/glad.h>
+
+#include "gl_state.h"
+#include "uniform_blocks.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define LEARN_OPENGL_HAS_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    constexpr std::size_t LIGHTS_PER_JOB = 256;
+    constexpr unsigned int COLUMN_PLANES = LightClusters::GRID_X + 1;
+    constexpr unsigned int ROW_PLANES = LightClusters::GRID_Y + 1;
+
+    // What the bounds kernels need from bin(): the view transform, and the planes through
+    // the eye that separate the tile columns and rows, left to right and bottom to top.
+    // Each plane is stored as its unit normal in view space, x (or y) and z; the signed
+    // distance of a point falls from left to right, so a sphere's columns are a range.
+    struct BinContext
+    {
+        glm::mat4 view;
+        float columnX[COLUMN_PLANES], columnZ[COLUMN_PLANES];
+        float rowY[ROW_PLANES], rowZ[ROW_PLANES];
+        float nearPlane, farPlane;
+        float sliceScale, sliceBias;
+    };
+
+    struct Bounds
+    {
+        int x0, x1, y0, y1, z0, z1;
+    };
+
+    std::uint8_t depthSlice(const BinContext &context, float depth)
+    {
+        int slice = (int)(std::log(depth) * context.sliceScale + context.sliceBias);
+        return (std::uint8_t)std::clamp(slice, 0, (int)LightClusters::GRID_Z - 1);
+    }
+
+    // Tiles, from plane counts per axis: `ahead` planes have the sphere's center more than
+    // one radius on their far side, `reached` planes are less than a radius behind it. The
+    // depth slices come from the center's depth, which also decides the cases the planes
+    // can't: spheres beyond the depth range, and spheres around the eye, whose side planes
+    // all meet there, which take every tile.
+    std::array<std::uint8_t, 6> finishBounds(const BinContext &context, float depth, float radius,
+                                             int columnsAhead, int columnsReached, int rowsAhead, int rowsReached)
+    {
+        constexpr std::array<std::uint8_t, 6> CULLED = { 1, 0, 1, 0, 1, 0 };
+        if (depth + radius < context.nearPlane || depth - radius > context.farPlane)
+            return CULLED;
+
+        Bounds bounds;
+        if (depth - radius < context.nearPlane)
+            bounds = { 0, (int)LightClusters::GRID_X - 1, 0, (int)LightClusters::GRID_Y - 1, 0, 0 };
+        else
+            bounds = { columnsAhead, std::min(columnsReached, (int)LightClusters::GRID_X) - 1,
+                       rowsAhead, std::min(rowsReached, (int)LightClusters::GRID_Y) - 1, 0, 0 };
+        if (bounds.x0 > bounds.x1 || bounds.y0 > bounds.y1)
+            return CULLED;
+
+        bounds.z0 = depthSlice(context, std::max(depth - radius, context.nearPlane));
+        bounds.z1 = depthSlice(context, std::min(depth + radius, context.farPlane));
+        return { (std::uint8_t)bounds.x0, (std::uint8_t)bounds.x1, (std::uint8_t)bounds.y0,
+                 (std::uint8_t)bounds.y1, (std::uint8_t)bounds.z0, (std::uint8_t)bounds.z1 };
+    }
+
+    // planes [0, count - 1) may be reached, planes [1, count) may be passed; see finishBounds
+    template <unsigned int Count>
+    void countPlanes(const float (&normalA)[Count], const float (&normalZ)[Count], float a, float z, float radius,
+                     int &ahead, int &reached)
+    {
+        ahead = 0;
+        reached = 0;
+        for (unsigned int p = 0; p < Count; p++)
+        {
+            float distance = a * normalA[p] + z * normalZ[p];
+            if (p > 0 && distance >= radius)
+                ahead++;
+            if (p + 1 < Count && distance > -radius)
+                reached++;
+        }
+    }
+
+    template <typename Output>
+    void boundsScalar(const BinContext &context, const ClusterLight *lights, std::size_t begin, std::size_t end,
+                      Output output)
+    {
+        const glm::mat4 &m = context.view;
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const glm::vec3 &p = lights[i].position;
+            float x = m[0][0] * p.x + m[1][0] * p.y + m[2][0] * p.z + m[3][0];
+            float y = m[0][1] * p.x + m[1][1] * p.y + m[2][1] * p.z + m[3][1];
+            float z = m[0][2] * p.x + m[1][2] * p.y + m[2][2] * p.z + m[3][2];
+            float radius = lights[i].radius;
+
+            int columnsAhead, columnsReached, rowsAhead, rowsReached;
+            countPlanes(context.columnX, context.columnZ, x, z, radius, columnsAhead, columnsReached);
+            countPlanes(context.rowY, context.rowZ, y, z, radius, rowsAhead, rowsReached);
+            output(i, finishBounds(context, -z, radius, columnsAhead, columnsReached, rowsAhead, rowsReached));
+        }
+    }
+
+#ifdef LEARN_OPENGL_HAS_SSE
+    template <unsigned int Count>
+    void countPlanesSse(const float (&normalA)[Count], const float (&normalZ)[Count], __m128 a, __m128 z,
+                        __m128 radius, __m128i &ahead, __m128i &reached)
+    {
+        const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+        ahead = _mm_setzero_si128();
+        reached = _mm_setzero_si128();
+        for (unsigned int p = 0; p < Count; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(normalA[p])), _mm_mul_ps(z, _mm_set1_ps(normalZ[p])));
+            // a true compare is all ones, -1 as an integer
+            if (p > 0)
+                ahead = _mm_sub_epi32(ahead, _mm_castps_si128(_mm_cmpge_ps(distance, radius)));
+            if (p + 1 < Count)
+                reached = _mm_sub_epi32(reached, _mm_castps_si128(_mm_cmpgt_ps(distance, negativeRadius)));
+        }
+    }
+
+    // four lights per iteration; the arithmetic is the scalar kernel's, in the same order
+    template <typename Output>
+    void boundsSse(const BinContext &context, const ClusterLight *lights, std::size_t begin, std::size_t end,
+                   Output output)
+    {
+        const glm::mat4 &m = context.view;
+        __m128 row[3][4];
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 4; c++)
+                row[r][c] = _mm_set1_ps(m[c][r]);
+
+        std::size_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            // (position, radius) of four lights, transposed into one register per component
+            __m128 px = _mm_loadu_ps(&lights[i].position.x);
+            __m128 py = _mm_loadu_ps(&lights[i + 1].position.x);
+            __m128 pz = _mm_loadu_ps(&lights[i + 2].position.x);
+            __m128 radius = _mm_loadu_ps(&lights[i + 3].position.x);
+            _MM_TRANSPOSE4_PS(px, py, pz, radius);
+
+            __m128 view[3];
+            for (int r = 0; r < 3; r++)
+                view[r] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(row[r][0], px), _mm_mul_ps(row[r][1], py)),
+                                                _mm_mul_ps(row[r][2], pz)), row[r][3]);
+
+            __m128i columnsAhead, columnsReached, rowsAhead, rowsReached;
+            countPlanesSse(context.columnX, context.columnZ, view[0], view[2], radius, columnsAhead, columnsReached);
+            countPlanesSse(context.rowY, context.rowZ, view[1], view[2], radius, rowsAhead, rowsReached);
+
+            alignas(16) float z[4], radii[4];
+            alignas(16) std::int32_t counts[4][4];
+            _mm_store_ps(z, view[2]);
+            _mm_store_ps(radii, radius);
+            _mm_store_si128((__m128i *)counts[0], columnsAhead);
+            _mm_store_si128((__m128i *)counts[1], columnsReached);
+            _mm_store_si128((__m128i *)counts[2], rowsAhead);
+            _mm_store_si128((__m128i *)counts[3], rowsReached);
+            for (int lane = 0; lane < 4; lane++)
+                output(i + lane, finishBounds(context, -z[lane], radii[lane], counts[0][lane], counts[1][lane],
+                                              counts[2][lane], counts[3][lane]));
+        }
+        boundsScalar(context, lights, i, end, output);
+    }
+#endif
+
+    std::size_t clusterIndex(unsigned int x, unsigned int y, unsigned int z)
+    {
+        return x + LightClusters::GRID_X * (y + LightClusters::GRID_Y * (std::size_t)z);
+    }
+}
+
+LightClusters::LightClusters(unsigned int workerCount) : pool(workerCount)
+{
+    ranges.resize(CLUSTER_COUNT);
+    cursors.resize(CLUSTER_COUNT);
+}
+
+void LightClusters::bin(const glm::mat4 &view, float fovY, float aspect, float nearPlane, float farPlane,
+                        std::span<const ClusterLight> sceneLights, CullingKernel kernel)
+{
+    auto start = std::chrono::steady_clock::now();
+    lights.assign(sceneLights.begin(), sceneLights.begin() + (std::ptrdiff_t)std::min(sceneLights.size(), MAX_LIGHTS));
+    bounds.resize(lights.size());
+
+    BinContext context;
+    context.view = view;
+    context.nearPlane = nearPlane;
+    context.farPlane = farPlane;
+    float logDepthRange = std::log(farPlane / nearPlane);
+    context.sliceScale = sliceScale = (float)GRID_Z / logDepthRange;
+    context.sliceBias = sliceBias = -(float)GRID_Z * std::log(nearPlane) / logDepthRange;
+
+    // a boundary at offset k across the image (-1 to 1) is the plane x = k * tanHalf * -z
+    float tanHalfY = std::tan(fovY * 0.5f);
+    float tanHalfX = tanHalfY * aspect;
+    for (unsigned int i = 0; i < COLUMN_PLANES; i++)
+    {
+        float slope = (-1.0f + 2.0f * (float)i / GRID_X) * tanHalfX;
+        float length = std::sqrt(1.0f + slope * slope);
+        context.columnX[i] = 1.0f / length;
+        context.columnZ[i] = slope / length;
+    }
+    for (unsigned int i = 0; i < ROW_PLANES; i++)
+    {
+        float slope = (-1.0f + 2.0f * (float)i / GRID_Y) * tanHalfY;
+        float length = std::sqrt(1.0f + slope * slope);
+        context.rowY[i] = 1.0f / length;
+        context.rowZ[i] = slope / length;
+    }
+
+    // pass 1: the clusters each light may touch
+    auto store = [this](std::size_t i, const std::array<std::uint8_t, 6> &b) {
+        bounds[i] = { b[0], b[1], b[2], b[3], b[4], b[5] };
+    };
+    auto boundsJobs = (unsigned int)((lights.size() + LIGHTS_PER_JOB - 1) / LIGHTS_PER_JOB);
+    pool.parallelFor(boundsJobs, [&](unsigned int job) {
+        std::size_t begin = job * LIGHTS_PER_JOB;
+        std::size_t end = std::min(begin + LIGHTS_PER_JOB, lights.size());
+#ifdef LEARN_OPENGL_HAS_SSE
+        if (kernel != CULL_SCALAR)
+        {
+            boundsSse(context, lights.data(), begin, end, store);
+            return;
+        }
+#endif
+        boundsScalar(context, lights.data(), begin, end, store);
+    });
+
+    // passes 2 and 3 split the depth slices between the jobs, so no two write one cluster
+    unsigned int sliceJobs = std::clamp(pool.workerCount(), 1u, GRID_Z);
+    auto forEachTouched = [&](unsigned int job, auto &&visit) {
+        unsigned int sliceBegin = GRID_Z * job / sliceJobs;
+        unsigned int sliceEnd = GRID_Z * (job + 1) / sliceJobs;
+        for (std::size_t light = 0; light < bounds.size(); light++)
+        {
+            const LightBounds &b = bounds[light];
+            unsigned int z0 = std::max<unsigned int>(b.z0, sliceBegin), z1 = std::min<unsigned int>(b.z1 + 1u, sliceEnd);
+            for (unsigned int z = z0; z < z1; z++)
+                for (unsigned int y = b.y0; y <= b.y1; y++)
+                    for (unsigned int x = b.x0; x <= b.x1; x++)
+                        visit(clusterIndex(x, y, z), light);
+        }
+    };
+
+    // pass 2: lights per cluster, then each cluster's first index
+    for (glm::uvec2 &range : ranges)
+        range.y = 0;
+    pool.parallelFor(sliceJobs, [&](unsigned int job) {
+        forEachTouched(job, [this](std::size_t cluster, std::size_t) { ranges[cluster].y++; });
+    });
+
+    LightClusterStats stats;
+    stats.lights = (unsigned int)lights.size();
+    std::size_t offset = 0;
+    for (std::size_t cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+    {
+        std::size_t count = std::min<std::size_t>(ranges[cluster].y, maxIndices - offset);
+        stats.droppedIndices += ranges[cluster].y - (unsigned int)count;
+        stats.maxClusterLights = std::max(stats.maxClusterLights, ranges[cluster].y);
+        ranges[cluster] = { (unsigned int)offset, (unsigned int)count };
+        cursors[cluster] = (std::uint32_t)offset;
+        offset += count;
+    }
+    indices.resize(offset);
+
+    // pass 3: the lists, each in ascending light order; over capacity, the last lights go
+    pool.parallelFor(sliceJobs, [&](unsigned int job) {
+        forEachTouched(job, [this](std::size_t cluster, std::size_t light) {
+            if (cursors[cluster] < ranges[cluster].x + ranges[cluster].y)
+                indices[cursors[cluster]++] = (std::uint16_t)light;
+        });
+    });
+
+    for (const LightBounds &b : bounds)
+        stats.visibleLights += b.z0 <= b.z1;
+    stats.indices = (unsigned int)indices.size();
+    stats.binMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    frameStats = stats;
+}
+
+void LightClusters::upload(int framebufferWidth, int framebufferHeight)
+{
+    if (!gpu)
+    {
+        GLint maxTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        maxIndices = (std::size_t)maxTexels;
+
+        gpu.emplace();
+        struct Attachment
+        {
+            GLBuffer &buffer;
+            GLTexture &texture;
+            GLenum format;
+        };
+        Attachment attachments[] = {
+            { gpu->lightBuffer, gpu->lightTexture, GL_RGBA32F },
+            { gpu->rangeBuffer, gpu->rangeTexture, GL_RG32UI },
+            { gpu->indexBuffer, gpu->indexTexture, GL_R16UI },
+        };
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            attachments[i].buffer = GLBuffer::create();
+            attachments[i].texture = GLTexture::create();
+            glBindBuffer(GL_TEXTURE_BUFFER, attachments[i].buffer.get());
+            glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+            GLState::bindTexture(FIRST_TEXTURE_UNIT + i, GL_TEXTURE_BUFFER, attachments[i].texture.get());
+            glTexBuffer(GL_TEXTURE_BUFFER, attachments[i].format, attachments[i].buffer.get());
+        }
+        gpu->uniforms.emplace(CLUSTER_DATA_BINDING, sizeof(ClusterData));
+    }
+
+    ClusterData data{};
+    data.grid = { GRID_X, GRID_Y, GRID_Z, (unsigned int)lights.size() };
+    data.scale = { (float)GRID_X / (float)std::max(framebufferWidth, 1), (float)GRID_Y / (float)std::max(framebufferHeight, 1),
+                   sliceScale, sliceBias };
+    gpu->uniforms->update(data);
+
+    // orphan and refill, like UniformBuffer; an empty buffer texture still needs storage
+    auto stream = [](const GLBuffer &buffer, const void *bytes, std::size_t size) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer.get());
+        glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)std::max<std::size_t>(size, 16), nullptr, GL_STREAM_DRAW);
+        if (size > 0)
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, (GLsizeiptr)size, bytes);
+    };
+    stream(gpu->lightBuffer, lights.data(), lights.size() * sizeof(ClusterLight));
+    stream(gpu->rangeBuffer, ranges.data(), ranges.size() * sizeof(glm::uvec2));
+    // only the first frame can be over the limit, binned before it was known; fetches past it read zero
+    stream(gpu->indexBuffer, indices.data(), std::min(indices.size(), maxIndices) * sizeof(std::uint16_t));
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    bind();
+}
+
+void LightClusters::bind() const
+{
+    if (!gpu)
+        return;
+    GLState::bindTexture(FIRST_TEXTURE_UNIT, GL_TEXTURE_BUFFER, gpu->lightTexture.get());
+    GLState::bindTexture(FIRST_TEXTURE_UNIT + 1, GL_TEXTURE_BUFFER, gpu->rangeTexture.get());
+    GLState::bindTexture(FIRST_TEXTURE_UNIT + 2, GL_TEXTURE_BUFFER, gpu->indexTexture.get());
+}
+
+void LightClusters::setSamplers(const Shader &shader)
+{
+    shader.use();
+    shader.setSampler("clusterLights", FIRST_TEXTURE_UNIT);
+    shader.setSampler("clusterRanges", FIRST_TEXTURE_UNIT + 1);
+    shader.setSampler("clusterLightIndices", FIRST_TEXTURE_UNIT + 2);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "culling.h"
+#include "gl_handle.h"
+#include "lib/thread_pool.h"
+#include "shader.h"
+#include "uniform_buffer.h"
+
+// A point light with a hard range, as the clustered path sees it: two RGBA32F texels on the GPU.
+struct ClusterLight
+{
+    glm::vec3 position;
+    float radius; // contributes nothing beyond this distance
+    glm::vec3 color;
+    float _pad0;
+};
+
+struct LightClusterStats
+{
+    unsigned int lights = 0;
+    unsigned int visibleLights = 0;  // touching at least one cluster
+    unsigned int indices = 0;        // light references summed over the clusters
+    unsigned int maxClusterLights = 0;
+    unsigned int droppedIndices = 0; // past the index buffer's capacity
+    float binMilliseconds = 0.0f;
+};
+
+// Clustered forward lighting. The view frustum is cut into GRID_X x GRID_Y screen tiles
+// and GRID_Z depth slices, spaced logarithmically from the near to the far plane, and
+// every light is listed in each cluster its sphere may reach; a fragment then only
+// evaluates the lights of its own cluster.
+//
+// Binning runs on the CPU in three passes over the worker pool: light bounds in view
+// space (4 lights per iteration with SSE: distances to every tile boundary plane, counted
+// per lane), then per-cluster counts and the light lists, each split by depth slice so no
+// two jobs write the same cluster. The lists go to the GPU as buffer textures:
+//   clusterLights:       two texels per light, (position, radius) and (color, 0)
+//   clusterRanges:       per cluster, first index and count
+//   clusterLightIndices: 16-bit light indices, cluster after cluster
+class LightClusters
+{
+public:
+    static constexpr unsigned int GRID_X = 16;
+    static constexpr unsigned int GRID_Y = 9;
+    static constexpr unsigned int GRID_Z = 24;
+    static constexpr unsigned int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+    static constexpr std::size_t MAX_LIGHTS = 1 << 16; // indices are 16-bit
+    // the buffer textures take this unit and the two after it, clear of the material's
+    static constexpr unsigned int FIRST_TEXTURE_UNIT = 8;
+
+    explicit LightClusters(unsigned int workerCount = ThreadPool::defaultWorkerCount());
+
+    // CPU only. fovY in radians; lights past MAX_LIGHTS are ignored. CULL_AVX bins with SSE.
+    void bin(const glm::mat4 &view, float fovY, float aspect, float nearPlane, float farPlane,
+             std::span<const ClusterLight> lights, CullingKernel kernel = FrustumCuller::bestKernel());
+
+    // Uploads the last bin() and binds the textures; needs a current context.
+    void upload(int framebufferWidth, int framebufferHeight);
+    void bind() const;
+    // Points a program's cluster samplers at the texture units bind() uses.
+    static void setSamplers(const Shader &shader);
+
+    const LightClusterStats &stats() const { return frameStats; }
+    std::span<const glm::uvec2> clusterRanges() const { return ranges; }
+    std::span<const std::uint16_t> lightIndices() const { return indices; }
+    unsigned int workerCount() const { return pool.workerCount(); }
+
+private:
+    // inclusive cluster coordinates a light may touch; z0 > z1 when it touches none
+    struct LightBounds
+    {
+        std::uint8_t x0, x1, y0, y1, z0, z1;
+    };
+
+    struct GpuResources
+    {
+        GLBuffer lightBuffer, rangeBuffer, indexBuffer;
+        GLTexture lightTexture, rangeTexture, indexTexture;
+        std::optional<UniformBuffer> uniforms;
+    };
+
+    std::vector<ClusterLight> lights;
+    std::vector<LightBounds> bounds;
+    std::vector<glm::uvec2> ranges;
+    std::vector<std::uint16_t> indices;
+    std::vector<std::uint32_t> cursors; // per cluster, while filling
+    float sliceScale = 0.0f;
+    float sliceBias = 0.0f;
+    std::size_t maxIndices = SIZE_MAX; // the driver's buffer texture limit, once upload() has asked
+    LightClusterStats frameStats;
+    std::optional<GpuResources> gpu; // created by the first upload()
+    ThreadPool pool;
+};
@@ -0,0 +1,42 @@
+#include "lod_selector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // keeps the projection finite once the camera is at or inside the sphere
+    constexpr float MIN_DISTANCE = 1e-3f;
+}
+
+void LodSelector::begin(const glm::vec3 &viewPos, float fovDegrees, int framebufferHeight)
+{
+    this->viewPos = viewPos;
+    pixelsPerUnit = (float)framebufferHeight / (2.0f * std::tan(glm::radians(fovDegrees) * 0.5f));
+}
+
+std::uint8_t LodSelector::select(const Model &model, const BoundingSphere &worldSphere, std::uint8_t &level) const
+{
+    if (!enabled || model.lodCount() <= 1)
+        return level = 0;
+
+    float modelRadius = model.getBoundingSphere().radius;
+    float scale = modelRadius > 0.0f ? worldSphere.radius / modelRadius : 1.0f;
+    float distance = std::max(glm::length(worldSphere.center - viewPos) - worldSphere.radius, MIN_DISTANCE);
+    float pixelsPerError = scale * pixelsPerUnit / distance;
+
+    auto coarsestWithin = [&](float threshold) {
+        std::size_t coarsest = 0;
+        for (std::size_t i = 1; i < model.lodCount() && model.lodError(i) * pixelsPerError <= threshold; i++)
+            coarsest = i;
+        return coarsest;
+    };
+
+    std::size_t current = std::min<std::size_t>(level, model.lodCount() - 1);
+    std::size_t coarser = coarsestWithin(pixelError * (1.0f - HYSTERESIS));
+    if (coarser > current)
+        current = coarser;
+    else if (model.lodError(current) * pixelsPerError > pixelError * (1.0f + HYSTERESIS))
+        current = coarsestWithin(pixelError);
+    return level = (std::uint8_t)current;
+}
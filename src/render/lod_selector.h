@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "model.h"
+
+// Picks a model's level of detail from how large its simplification error would look on
+// screen: the object-space error, scaled with the object and projected at the distance of
+// its bounding sphere for the camera's vertical field of view and the framebuffer height.
+// The coarsest level that stays under pixelError wins. Levels only change once the error
+// leaves a band of +-HYSTERESIS around the threshold, so objects don't pop back and forth.
+class LodSelector
+{
+public:
+    static constexpr float HYSTERESIS = 0.25f;
+
+    float pixelError = 1.0f; // largest tolerated on-screen deviation, in pixels
+    bool enabled = true;     // when off, select() always returns the full mesh
+
+    // fovDegrees as in Camera::fov.
+    void begin(const glm::vec3 &viewPos, float fovDegrees, int framebufferHeight);
+
+    // worldSphere is the model's bounding sphere after its transform. `level` holds the
+    // object's level from the previous frame and is updated; it is also returned.
+    std::uint8_t select(const Model &model, const BoundingSphere &worldSphere, std::uint8_t &level) const;
+
+private:
+    glm::vec3 viewPos{ 0.0f };
+    float pixelsPerUnit = 0.0f; // at distance 1
+};
@@ -1,67 +1,177 @@
 #include "mesh.h"
 
+#include <cstddef>
+#include <utility>
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
-Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& textures)
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<const Texture *> textures,
+           GeometryArena &arena)
+    : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures))
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this ->textures = textures;
-    setupMesh();
+    for (const Vertex &vertex : this->vertices)
+        bounds.expand(vertex.position);
+
+    setupMaterial();
+    positionTransform = PositionTransform::forBounds(bounds);
+    std::vector<GpuVertex> encoded = encodeVertices<GpuVertex>(this->vertices, bounds);
+    // no cooked levels: setupMesh draws the whole index range as level 0
+    setupMesh(encoded, { std::as_bytes(std::span(this->indices)), sizeof(unsigned int), {} }, arena);
 }
 
-void Mesh::draw(const Shader &shader) const
+Mesh::Mesh(std::span<const GpuVertex> vertices, CookedIndices indices, std::vector<const Texture *> textures,
+           const AABB &bounds, GeometryArena &arena)
+    : textures(std::move(textures)), bounds(bounds), positionTransform(PositionTransform::forBounds(bounds))
+{
+    setupMaterial();
+    setupMesh(vertices, indices, arena);
+}
+
+Mesh::Mesh(std::span<const GpuVertex> vertices, CookedIndices indices, std::vector<const Texture *> textures,
+           const AABB &bounds, GeometryArena &arena, UploadStreamer &streamer, std::shared_ptr<const void> keepAlive)
+    : textures(std::move(textures)), bounds(bounds), positionTransform(PositionTransform::forBounds(bounds)),
+      streamHandle(std::make_shared<StreamHandle>())
+{
+    setupMaterial();
+    setupMesh(vertices, indices, arena, &streamer, std::move(keepAlive));
+}
+
+void Mesh::setupMaterial()
 {
     unsigned int diffuseNr = 0, specularNr = 0;
-    for (unsigned int i = 0; i < textures.size(); i++)
+    for (const Texture *texture : textures)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-        std::string name = textures[i].type;
-        std::string number;
+        const std::string &name = texture->type;
+        MaterialSampler sampler;
         if (name == "texture_diffuse")
-            number = std::to_string(diffuseNr++);
+            sampler.index = diffuseNr++;
         else if (name == "texture_specular")
-            number = std::to_string(specularNr++);
+            sampler = { true, specularNr++ };
+        samplers.push_back(sampler);
+    }
+    hasSpecular = specularNr > 0;
+
+    // FNV-1a over the texture names, folded to 16 bits; the real names, not a streaming placeholder
+    std::uint32_t hash = 2166136261u;
+    for (const Texture *texture : textures)
+        hash = (hash ^ texture->handle.get()) * 16777619u;
+    material = (std::uint16_t)(hash ^ (hash >> 16));
+}
 
-        shader.setInt((name + number).c_str(), i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+void Mesh::draw(const Shader &shader) const
+{
+    bindTextures(shader);
+
+    // draw the mesh
+    bindVertexArray();
+    bindPositionTransform(shader);
+    drawElements();
+}
+
+void Mesh::drawInstanced(const Shader &shader, int instanceCount, bool useTints) const
+{
+    bindTextures(shader);
+
+    bindVertexArray();
+    bindPositionTransform(shader);
+    drawElements(instanceCount, useTints);
+}
+
+void Mesh::bindVertexArray() const
+{
+    GLState::bindVertexArray(geometry.vertexArray());
+}
+
+void Mesh::bindPositionTransform(const Shader &shader) const
+{
+    if constexpr (VertexFormat<GpuVertex>::quantizedPositions)
+    {
+        shader.set(shader.builtins().positionScale, positionTransform.scale);
+        shader.set(shader.builtins().positionOffset, positionTransform.offset);
     }
-    if (specularNr == 0)
+}
+
+void Mesh::drawElements(int instanceCount, bool useTints, std::size_t level) const
+{
+    if (!resident() || !geometry.valid())
+        return;
+
+    const MeshLod &range = lod(level);
+    auto indexCount = (int)range.indexCount;
+    std::size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+    auto *indexOffset = (void *)(geometry.indexByteOffset() + range.firstIndex * indexSize);
+    if (instanceCount == 0)
     {
-        unsigned int unit = textures.size();
-        glActiveTexture(GL_TEXTURE0 + unit);
-        glBindTexture(GL_TEXTURE_2D, Texture::black());
-        shader.setInt("texture_specular0", unit);
+        glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, indexType, indexOffset, geometry.baseVertex());
+        return;
     }
-    glActiveTexture(GL_TEXTURE0);
 
-    // draw the mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, nullptr);
-    glBindVertexArray(0);
+    if (useTints)
+        glEnableVertexAttribArray(INSTANCE_TINT_LOCATION);
+    else
+        glDisableVertexAttribArray(INSTANCE_TINT_LOCATION); // falls back to the generic value
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indexCount, indexType, indexOffset, instanceCount,
+                                      geometry.baseVertex());
 }
 
-void Mesh::setupMesh()
+void Mesh::attachInstanceBuffers(unsigned int transformBuffer, unsigned int tintBuffer) const
 {
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-    glGenVertexArrays(1, &VAO);
+    geometry.attachInstanceBuffers(transformBuffer, tintBuffer);
+}
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+void Mesh::bindTextures(const Shader &shader) const
+{
+    const Shader::Builtins &builtins = shader.builtins();
+    for (unsigned int i = 0; i < textures.size(); i++)
+    {
+        const MaterialSampler &sampler = samplers[i];
+        if (sampler.index < Shader::MATERIAL_SAMPLERS)
+        {
+            const auto &slots = sampler.specular ? builtins.specularSamplers : builtins.diffuseSamplers;
+            shader.set(slots[sampler.index], (int)i);
+        }
+        GLState::bindTexture(i, GL_TEXTURE_2D, textures[i]->id());
+    }
+    if (!hasSpecular)
+    {
+        unsigned int unit = textures.size();
+        GLState::bindTexture(unit, GL_TEXTURE_2D, Texture::black());
+        shader.set(builtins.specularSamplers[0], (int)unit);
+    }
+}
 
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+void Mesh::releaseCpuData()
+{
+    std::vector<Vertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+void Mesh::setupMesh(std::span<const GpuVertex> vertexData, CookedIndices indexData, GeometryArena &arena,
+                     UploadStreamer *streamer, std::shared_ptr<const void> keepAlive)
+{
+    if (indexData.lods.empty())
+        lods = { { 0, (std::uint32_t)indexData.count(), 0.0f } };
+    else
+        lods.assign(indexData.lods.begin(), indexData.lods.end());
+    indexType = indexData.indexSize == sizeof(std::uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    geometry = arena.allocate(vertexData.size(), indexData.bytes.size());
+    if (!geometry.valid())
+        return;
 
-    float stride = sizeof(Vertex);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*) 0);                         // position
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, normal));   // normal
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, texCoords));   // tex coords
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
+    if (streamer != nullptr)
+    {
+        streamer->queueBuffer(streamHandle, geometry.vertexBuffer(), geometry.vertexByteOffset(),
+                              std::as_bytes(vertexData), keepAlive);
+        streamer->queueBuffer(streamHandle, geometry.indexBuffer(), geometry.indexByteOffset(), indexData.bytes,
+                              std::move(keepAlive));
+        return;
+    }
 
-    glBindVertexArray(0);
+    // through the copy target, so the element buffer binding of whatever VAO is bound stays put
+    glBindBuffer(GL_COPY_WRITE_BUFFER, geometry.vertexBuffer());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)geometry.vertexByteOffset(), (GLsizeiptr)vertexData.size_bytes(),
+                    vertexData.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, geometry.indexBuffer());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)geometry.indexByteOffset(), (GLsizeiptr)indexData.bytes.size(),
+                    indexData.bytes.data());
 }
@@ -1,8 +1,16 @@
 #pragma once
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string>
 #include <vector>
 
+#include "bounds.h"
+#include "geometry_arena.h"
+#include "mesh_cache.h"
 #include "shader.h"
 #include "texture.h"
+#include "upload_streamer.h"
 #include "vertex.h"
 
 class Mesh
@@ -10,12 +18,78 @@ class Mesh
 public:
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    std::vector<const Texture *> textures; // owned by the Model's texture cache
+
+    // Geometry lives in ranges of the arena, which must outlive the mesh.
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<const Texture *> textures,
+         GeometryArena &arena);
+    // Uploads straight from borrowed memory (e.g. a mapped mesh cache) and keeps no CPU copy.
+    Mesh(std::span<const GpuVertex> vertices, CookedIndices indices, std::vector<const Texture *> textures,
+         const AABB &bounds, GeometryArena &arena);
+    // Allocates the ranges and queues their contents on the streamer; the mesh draws nothing
+    // until they are resident. keepAlive must own the spans' memory.
+    Mesh(std::span<const GpuVertex> vertices, CookedIndices indices, std::vector<const Texture *> textures,
+         const AABB &bounds, GeometryArena &arena, UploadStreamer &streamer, std::shared_ptr<const void> keepAlive);
+
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+    Mesh(Mesh &&) noexcept = default;
+    Mesh &operator=(Mesh &&) noexcept = default;
 
-    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& textures);
     void draw(const Shader &shader) const;
+    void drawInstanced(const Shader &shader, int instanceCount, bool useTints) const;
+
+    // Points the instance attributes of this mesh's VAO at the given buffers. The VAO is shared
+    // with the rest of its arena block, so attach again before drawing another model's instances.
+    void attachInstanceBuffers(unsigned int transformBuffer, unsigned int tintBuffer) const;
+
+    // Building blocks for callers that track bound state themselves (see RenderQueue).
+    void bindTextures(const Shader &shader) const;
+    void bindVertexArray() const;
+    // Sets the dequantization builtins for quantized vertex formats; a no-op otherwise.
+    void bindPositionTransform(const Shader &shader) const;
+    // Issues a base-vertex draw against the bound VAO; instanceCount 0 is a plain, non-instanced draw.
+    // Levels past the coarsest draw the coarsest.
+    void drawElements(int instanceCount = 0, bool useTints = false, std::size_t level = 0) const;
+
+    // Level 0 is the full mesh; coarser levels follow, each over the same vertices.
+    std::size_t lodCount() const { return lods.size(); }
+    const MeshLod &lod(std::size_t level) const { return lods[std::min(level, lods.size() - 1)]; }
+    unsigned int triangleCount(std::size_t level = 0) const { return lod(level).indexCount / 3; }
+
+    unsigned int vertexArray() const { return geometry.vertexArray(); }
+    // Identifies the bound texture set, so draws sharing it can be grouped.
+    std::uint16_t materialKey() const { return material; }
+    bool sharesMaterialWith(const Mesh &other) const { return textures == other.textures; }
+    // Object-space bounds, computed once at load so they survive releaseCpuData().
+    const AABB &getBounds() const { return bounds; }
+    // False while streamed vertex or index data is still queued.
+    bool resident() const { return streamHandle == nullptr || streamHandle->resident(); }
+
+    // Drops the CPU-side vertex/index copies; the GPU buffers keep drawing.
+    void releaseCpuData();
 
 private:
-    unsigned int VAO, VBO, EBO;
-    void setupMesh();
+    GeometryArena::Allocation geometry;
+    std::vector<MeshLod> lods;
+    GLenum indexType = GL_UNSIGNED_INT;
+    AABB bounds;
+    PositionTransform positionTransform;
+    std::shared_ptr<StreamHandle> streamHandle; // set when built through the streaming constructor
+
+    // which material sampler each texture binds to: texture_diffuse<index> or texture_specular<index>;
+    // an index past Shader::MATERIAL_SAMPLERS (or another texture type) binds to none
+    struct MaterialSampler
+    {
+        bool specular = false;
+        unsigned int index = Shader::MATERIAL_SAMPLERS;
+    };
+    std::vector<MaterialSampler> samplers;
+    bool hasSpecular = false;
+    std::uint16_t material = 0;
+
+    void setupMaterial();
+    // With a streamer the ranges are only allocated here and filled in later frames.
+    void setupMesh(std::span<const GpuVertex> vertexData, CookedIndices indexData, GeometryArena &arena,
+                   UploadStreamer *streamer = nullptr, std::shared_ptr<const void> keepAlive = nullptr);
 };
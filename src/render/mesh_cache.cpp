@@ -0,0 +1,282 @@
+#include "mesh_cache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+namespace
+{
+    constexpr char CACHE_DIRECTORY[] = "cache/meshes/";
+    constexpr char MAGIC[4] = { 'L', 'O', 'M', 'C' };
+    constexpr std::uint32_t VERSION = 4;
+    constexpr std::uint64_t BLOB_ALIGNMENT = 16;
+
+    // File layout: header, entries, texture refs, LOD ranges, string bytes, then the aligned vertex/index blobs.
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t sourceHash;
+        std::uint32_t importFlags;
+        std::uint32_t meshCount;
+        std::uint32_t textureCount;
+        std::uint32_t lodCount;
+        std::uint64_t lodSettingsHash;
+        std::uint32_t stringsSize;
+        std::uint32_t vertexFormat; // VertexFormat<GpuVertex>::id of the build that cooked it
+        std::uint32_t vertexSize;
+        std::uint64_t fileSize;
+    };
+
+    struct Entry
+    {
+        std::uint64_t vertexOffset;
+        std::uint64_t indexOffset;
+        std::uint32_t vertexCount;
+        std::uint32_t indexCount;
+        std::uint32_t firstTexture;
+        std::uint32_t textureCount;
+        std::uint32_t indexSize; // 2 or 4 bytes
+        std::uint32_t firstLod;
+        std::uint32_t lodCount;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    struct TextureRef
+    {
+        std::uint32_t typeOffset;
+        std::uint32_t typeLength;
+        std::uint32_t pathOffset;
+        std::uint32_t pathLength;
+    };
+
+    static_assert(std::is_trivially_copyable_v<GpuVertex>, "cooked vertices are uploaded as raw bytes");
+    static_assert(std::is_trivially_copyable_v<MeshLod> && alignof(MeshLod) <= alignof(TextureRef),
+                  "LOD ranges are read in place, right after the texture refs");
+
+    std::uint64_t alignUp(std::uint64_t offset)
+    {
+        return (offset + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+    }
+
+    std::uint64_t tableSize(std::uint64_t meshCount, std::uint64_t textureCount, std::uint64_t lodCount)
+    {
+        return sizeof(Header) + meshCount * sizeof(Entry) + textureCount * sizeof(TextureRef) + lodCount * sizeof(MeshLod);
+    }
+}
+
+MeshCache::MeshCache(const std::string &cachePath, std::uint64_t sourceHash, unsigned int importFlags,
+                     std::uint64_t lodSettingsHash)
+    : file(cachePath)
+{
+    isValid = sourceHash != 0 && file.valid() && validate(sourceHash, importFlags, lodSettingsHash);
+}
+
+bool MeshCache::validate(std::uint64_t sourceHash, unsigned int importFlags, std::uint64_t lodSettingsHash) const
+{
+    std::span<const std::byte> bytes = file.bytes();
+    if (bytes.size() < sizeof(Header))
+        return false;
+
+    const auto *header = (const Header *)bytes.data();
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+        || header->sourceHash != sourceHash || header->importFlags != importFlags
+        || header->lodSettingsHash != lodSettingsHash
+        || header->vertexFormat != VertexFormat<GpuVertex>::id || header->vertexSize != sizeof(GpuVertex)
+        || header->fileSize != bytes.size())
+        return false;
+
+    std::uint64_t stringsEnd = tableSize(header->meshCount, header->textureCount, header->lodCount) + header->stringsSize;
+    if (stringsEnd > bytes.size())
+        return false;
+
+    // every offset is checked once here, so mesh() can trust the file
+    const auto *entries = (const Entry *)(header + 1);
+    const auto *textures = (const TextureRef *)(entries + header->meshCount);
+    const auto *lods = (const MeshLod *)(textures + header->textureCount);
+    for (std::uint32_t i = 0; i < header->meshCount; i++)
+    {
+        const Entry &entry = entries[i];
+        if ((entry.indexSize != 2 && entry.indexSize != 4)
+            || entry.vertexOffset % alignof(GpuVertex) != 0 || entry.indexOffset % entry.indexSize != 0
+            || entry.vertexOffset + (std::uint64_t)entry.vertexCount * sizeof(GpuVertex) > bytes.size()
+            || entry.indexOffset + (std::uint64_t)entry.indexCount * entry.indexSize > bytes.size()
+            || (std::uint64_t)entry.firstTexture + entry.textureCount > header->textureCount
+            || (std::uint64_t)entry.firstLod + entry.lodCount > header->lodCount)
+            return false;
+        for (std::uint32_t level = 0; level < entry.lodCount; level++)
+        {
+            const MeshLod &lod = lods[entry.firstLod + level];
+            if ((std::uint64_t)lod.firstIndex + lod.indexCount > entry.indexCount || lod.indexCount % 3 != 0)
+                return false;
+        }
+    }
+    for (std::uint32_t i = 0; i < header->textureCount; i++)
+    {
+        const TextureRef &ref = textures[i];
+        if ((std::uint64_t)ref.typeOffset + ref.typeLength > header->stringsSize
+            || (std::uint64_t)ref.pathOffset + ref.pathLength > header->stringsSize)
+            return false;
+    }
+    return true;
+}
+
+std::size_t MeshCache::meshCount() const
+{
+    return isValid ? ((const Header *)file.bytes().data())->meshCount : 0;
+}
+
+CookedMesh MeshCache::mesh(std::size_t index) const
+{
+    const std::byte *base = file.bytes().data();
+    const auto *header = (const Header *)base;
+    const auto *entries = (const Entry *)(header + 1);
+    const auto *textures = (const TextureRef *)(entries + header->meshCount);
+    const auto *lods = (const MeshLod *)(textures + header->textureCount);
+    const auto *strings = (const char *)(lods + header->lodCount);
+    const Entry &entry = entries[index];
+
+    CookedMesh cooked;
+    cooked.vertices = { (const GpuVertex *)(base + entry.vertexOffset), entry.vertexCount };
+    cooked.indices = { { base + entry.indexOffset, (std::size_t)entry.indexCount * entry.indexSize }, entry.indexSize,
+                       { lods + entry.firstLod, entry.lodCount } };
+    cooked.bounds.min = { entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2] };
+    cooked.bounds.max = { entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2] };
+    cooked.textures.reserve(entry.textureCount);
+    for (std::uint32_t i = 0; i < entry.textureCount; i++)
+    {
+        const TextureRef &ref = textures[entry.firstTexture + i];
+        cooked.textures.push_back({ std::string(strings + ref.typeOffset, ref.typeLength),
+                                    std::string(strings + ref.pathOffset, ref.pathLength) });
+    }
+    return cooked;
+}
+
+std::string MeshCache::cachePath(const std::string &sourcePath)
+{
+    std::string name = sourcePath;
+    for (char &c : name)
+    {
+        if (c == '/' || c == '\\' || c == ':')
+            c = '_';
+    }
+    return CACHE_DIRECTORY + name + ".mesh";
+}
+
+std::uint64_t MeshCache::hashFile(const std::string &path)
+{
+    MappedFile source(path);
+    if (!source.valid())
+        return 0;
+
+    // FNV-1a, eight bytes per step so hashing stays well below the cost of a parse
+    std::span<const std::byte> bytes = source.bytes();
+    std::uint64_t hash = 14695981039346656037ull;
+    std::size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, bytes.data() + i, 8);
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    for (; i < bytes.size(); i++)
+        hash = (hash ^ (std::uint64_t)bytes[i]) * 1099511628211ull;
+    return hash != 0 ? hash : 1;
+}
+
+bool MeshCache::write(const std::string &cachePath, std::uint64_t sourceHash, unsigned int importFlags,
+                      std::uint64_t lodSettingsHash, std::span<const CookedMesh> meshes)
+{
+    std::vector<Entry> entries;
+    std::vector<TextureRef> textures;
+    std::vector<MeshLod> lods;
+    std::string strings;
+    for (const CookedMesh &mesh : meshes)
+    {
+        Entry entry{};
+        entry.vertexCount = (std::uint32_t)mesh.vertices.size();
+        entry.indexCount = (std::uint32_t)mesh.indices.count();
+        entry.indexSize = mesh.indices.indexSize;
+        entry.firstTexture = (std::uint32_t)textures.size();
+        entry.textureCount = (std::uint32_t)mesh.textures.size();
+        entry.firstLod = (std::uint32_t)lods.size();
+        entry.lodCount = (std::uint32_t)mesh.indices.lods.size();
+        lods.insert(lods.end(), mesh.indices.lods.begin(), mesh.indices.lods.end());
+        const AABB &bounds = mesh.bounds;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            entry.boundsMin[axis] = bounds.min[axis];
+            entry.boundsMax[axis] = bounds.max[axis];
+        }
+        entries.push_back(entry);
+
+        for (const CookedTexture &texture : mesh.textures)
+        {
+            TextureRef ref{};
+            ref.typeOffset = (std::uint32_t)strings.size();
+            ref.typeLength = (std::uint32_t)texture.type.size();
+            strings += texture.type;
+            ref.pathOffset = (std::uint32_t)strings.size();
+            ref.pathLength = (std::uint32_t)texture.path.size();
+            strings += texture.path;
+            textures.push_back(ref);
+        }
+    }
+
+    std::uint64_t offset = alignUp(tableSize(entries.size(), textures.size(), lods.size()) + strings.size());
+    for (std::size_t i = 0; i < meshes.size(); i++)
+    {
+        entries[i].vertexOffset = offset;
+        offset = alignUp(offset + meshes[i].vertices.size_bytes());
+        entries[i].indexOffset = offset;
+        offset = alignUp(offset + meshes[i].indices.bytes.size());
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sourceHash = sourceHash;
+    header.importFlags = importFlags;
+    header.meshCount = (std::uint32_t)entries.size();
+    header.textureCount = (std::uint32_t)textures.size();
+    header.lodCount = (std::uint32_t)lods.size();
+    header.lodSettingsHash = lodSettingsHash;
+    header.stringsSize = (std::uint32_t)strings.size();
+    header.vertexFormat = VertexFormat<GpuVertex>::id;
+    header.vertexSize = sizeof(GpuVertex);
+    header.fileSize = offset;
+
+    // write beside the target and rename, so a crash never leaves a half-written cache behind
+    std::error_code error;
+    std::filesystem::create_directories(CACHE_DIRECTORY, error);
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        auto writeAt = [&out](std::uint64_t position, const void *data, std::size_t size) {
+            out.seekp((std::streamoff)position);
+            out.write((const char *)data, (std::streamsize)size);
+        };
+
+        writeAt(0, &header, sizeof(header));
+        out.write((const char *)entries.data(), (std::streamsize)(entries.size() * sizeof(Entry)));
+        out.write((const char *)textures.data(), (std::streamsize)(textures.size() * sizeof(TextureRef)));
+        out.write((const char *)lods.data(), (std::streamsize)(lods.size() * sizeof(MeshLod)));
+        out.write(strings.data(), (std::streamsize)strings.size());
+        for (std::size_t i = 0; i < meshes.size(); i++)
+        {
+            writeAt(entries[i].vertexOffset, meshes[i].vertices.data(), meshes[i].vertices.size_bytes());
+            writeAt(entries[i].indexOffset, meshes[i].indices.bytes.data(), meshes[i].indices.bytes.size());
+        }
+        // pad out to the recorded size; the last blob may end before an alignment boundary
+        auto end = (std::uint64_t)out.tellp();
+        if (end < header.fileSize)
+            out.write(std::string(header.fileSize - end, '\0').data(), (std::streamsize)(header.fileSize - end));
+        if (!out)
+            return false;
+    }
+    std::filesystem::rename(tempPath, cachePath, error);
+    return !error;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "lib/mapped_file.h"
+#include "bounds.h"
+#include "vertex_format.h"
+
+struct CookedTexture
+{
+    std::string type; // "texture_diffuse", ...
+    std::string path;
+};
+
+// One level of detail: a range of the mesh's index blob over the shared vertices.
+struct MeshLod
+{
+    std::uint32_t firstIndex;
+    std::uint32_t indexCount;
+    float error; // object-space distance from the full mesh's surface, 0 for the full mesh
+};
+
+// Index blob of a cooked mesh: 16-bit whenever every vertex is addressable with it. With
+// `lods`, the blob holds every level back to back, finest first; without, it is one level.
+struct CookedIndices
+{
+    std::span<const std::byte> bytes;
+    std::uint32_t indexSize = sizeof(std::uint32_t);
+    std::span<const MeshLod> lods;
+
+    std::size_t count() const { return bytes.size() / indexSize; }
+};
+
+// One mesh ready for upload. The spans point into a cache mapping or into arrays the
+// caller keeps alive, so cached and freshly imported meshes take the same path to the GPU.
+struct CookedMesh
+{
+    std::span<const GpuVertex> vertices;
+    CookedIndices indices;
+    AABB bounds;
+    std::vector<CookedTexture> textures;
+};
+
+// Pre-cooked binary copy of an imported model, so warm starts skip Assimp entirely.
+// A cache file is keyed by a hash of the source file plus the import flags and LOD settings,
+// and holds ready-to-upload vertex/index blobs in the build's GpuVertex format, LOD ranges,
+// texture references and bounds. It is read through a memory mapping and the blobs go to
+// glBufferData without an intermediate copy.
+class MeshCache
+{
+public:
+    // Opens and validates a cache file; valid() is false when it is missing, stale or corrupt.
+    MeshCache(const std::string &cachePath, std::uint64_t sourceHash, unsigned int importFlags,
+              std::uint64_t lodSettingsHash);
+
+    bool valid() const { return isValid; }
+    std::size_t meshCount() const;
+    CookedMesh mesh(std::size_t index) const;
+
+    // Where the cooked copy of a source file lives, e.g. "cache/meshes/assets_models_cube_cube.obj.mesh".
+    static std::string cachePath(const std::string &sourcePath);
+    // 64-bit content hash of a file; 0 when it cannot be read.
+    static std::uint64_t hashFile(const std::string &path);
+    static bool write(const std::string &cachePath, std::uint64_t sourceHash, unsigned int importFlags,
+                      std::uint64_t lodSettingsHash, std::span<const CookedMesh> meshes);
+
+private:
+    MappedFile file;
+    bool isValid = false;
+
+    bool validate(std::uint64_t sourceHash, unsigned int importFlags, std::uint64_t lodSettingsHash) const;
+};
@@ -0,0 +1,270 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <glm/glm.hpp>
+
+namespace
+{
+    constexpr unsigned int UNUSED = ~0u;
+
+    std::uint64_t hashVertex(const Vertex &vertex)
+    {
+        std::uint32_t words[sizeof(Vertex) / 4];
+        std::memcpy(words, &vertex, sizeof(Vertex));
+        std::uint64_t hash = 14695981039346656037ull;
+        for (std::uint32_t word : words)
+            hash = (hash ^ word) * 1099511628211ull;
+        return hash ^ (hash >> 32);
+    }
+
+    struct Cluster
+    {
+        std::uint32_t first;
+        std::uint32_t end;
+        float sortKey;
+    };
+}
+
+void weldVertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    // open addressing over the raw bytes; -0.0 and 0.0 stay distinct, which at worst keeps a duplicate
+    std::size_t tableSize = std::bit_ceil(std::max<std::size_t>(vertices.size() * 2, 16));
+    std::vector<unsigned int> table(tableSize, UNUSED);
+    std::vector<unsigned int> remap(vertices.size(), UNUSED);
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+
+    for (unsigned int &index : indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            const Vertex &vertex = vertices[index];
+            std::size_t slot = hashVertex(vertex) & (tableSize - 1);
+            while (table[slot] != UNUSED && std::memcmp(&welded[table[slot]], &vertex, sizeof(Vertex)) != 0)
+                slot = (slot + 1) & (tableSize - 1);
+            if (table[slot] == UNUSED)
+            {
+                table[slot] = (unsigned int)welded.size();
+                welded.push_back(vertex);
+            }
+            remap[index] = table[slot];
+        }
+        index = remap[index];
+    }
+    vertices.swap(welded);
+}
+
+void optimizeVertexCache(std::vector<unsigned int> &indices, std::size_t vertexCount,
+                         std::vector<std::uint32_t> &clusterStarts)
+{
+    clusterStarts.clear();
+    std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // vertex -> triangles adjacency, packed; live counts the triangles not yet emitted
+    std::vector<std::uint32_t> live(vertexCount, 0);
+    std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+    std::vector<std::uint32_t> adjacency(triangleCount * 3);
+    for (std::size_t i = 0; i < triangleCount * 3; i++)
+        live[indices[i]]++;
+    for (std::size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + live[v];
+    std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < triangleCount * 3; i++)
+        adjacency[fill[indices[i]]++] = (std::uint32_t)(i / 3);
+
+    std::vector<std::uint32_t> timestamps(vertexCount, 0);
+    std::vector<std::uint8_t> emitted(triangleCount, 0);
+    std::vector<unsigned int> deadEnds, candidates, output;
+    output.reserve(triangleCount * 3);
+
+    std::uint32_t time = VERTEX_CACHE_SIZE + 1;
+    std::size_t cursor = 0;
+    long long fan = -1;
+    auto nextUnfinished = [&]() -> long long {
+        for (; cursor < vertexCount; cursor++)
+        {
+            if (live[cursor] > 0)
+                return (long long)cursor;
+        }
+        return -1;
+    };
+
+    fan = nextUnfinished();
+    clusterStarts.push_back(0);
+    while (fan >= 0)
+    {
+        candidates.clear();
+        for (std::uint32_t k = offsets[fan]; k < offsets[fan + 1]; k++)
+        {
+            std::uint32_t triangle = adjacency[k];
+            if (emitted[triangle])
+                continue;
+            for (int corner = 0; corner < 3; corner++)
+            {
+                unsigned int v = indices[triangle * 3 + corner];
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - timestamps[v] > VERTEX_CACHE_SIZE)
+                    timestamps[v] = time++;
+            }
+            emitted[triangle] = 1;
+        }
+
+        // prefer the oldest cached vertex whose remaining fan still fits in the cache
+        fan = -1;
+        long long bestPriority = -1;
+        for (unsigned int v : candidates)
+        {
+            if (live[v] == 0)
+                continue;
+            long long priority = 0;
+            if (time - timestamps[v] + 2 * live[v] <= VERTEX_CACHE_SIZE)
+                priority = time - timestamps[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fan = v;
+            }
+        }
+        if (fan >= 0)
+            continue;
+
+        // dead end: back up to a recent vertex with work left, else jump to the next unfinished one
+        while (!deadEnds.empty() && fan < 0)
+        {
+            unsigned int v = deadEnds.back();
+            deadEnds.pop_back();
+            if (live[v] > 0)
+                fan = v;
+        }
+        if (fan < 0 || time - timestamps[fan] > VERTEX_CACHE_SIZE)
+        {
+            if (fan < 0)
+                fan = nextUnfinished();
+            if (fan >= 0)
+                clusterStarts.push_back((std::uint32_t)(output.size() / 3));
+        }
+    }
+    indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<unsigned int> &indices, std::span<const Vertex> vertices,
+                      std::span<const std::uint32_t> clusterStarts)
+{
+    auto triangleCount = (std::uint32_t)(indices.size() / 3);
+    if (clusterStarts.size() < 2)
+        return;
+
+    // area-weighted centroids and normals; the cross product's length is twice the area
+    std::vector<Cluster> clusters;
+    std::vector<glm::vec3> centroids, normals;
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (std::size_t c = 0; c < clusterStarts.size(); c++)
+    {
+        std::uint32_t first = clusterStarts[c];
+        std::uint32_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (std::uint32_t t = first; t < end; t++)
+        {
+            const glm::vec3 &a = vertices[indices[t * 3]].position;
+            const glm::vec3 &b = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 &p = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 cross = glm::cross(b - a, p - a);
+            float triangleArea = glm::length(cross);
+            centroid += (a + b + p) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+        clusters.push_back({ first, end, 0.0f });
+        centroids.push_back(area > 0.0f ? centroid / area : vertices[indices[first * 3]].position);
+        normals.push_back(glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f));
+        meshCentroid += centroid;
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // clusters facing away from the centre sit on the outside and tend to hide the rest
+    for (std::size_t c = 0; c < clusters.size(); c++)
+        clusters[c].sortKey = glm::dot(centroids[c] - meshCentroid, normals[c]);
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(indices.size());
+    for (const Cluster &cluster : clusters)
+        sorted.insert(sorted.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.end * 3);
+    indices.swap(sorted);
+}
+
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    std::vector<unsigned int> remap(vertices.size(), UNUSED);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for (unsigned int &index : indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = (unsigned int)ordered.size();
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
+
+VertexCacheStats analyzeVertexCache(std::span<const unsigned int> indices, std::size_t vertexCount,
+                                    unsigned int cacheSize)
+{
+    // FIFO: a vertex is cached while fewer than cacheSize misses happened since its own
+    std::vector<std::uint32_t> insertedAt(vertexCount, 0);
+    std::uint32_t clock = cacheSize;
+    std::size_t referenced = 0;
+    for (unsigned int index : indices)
+    {
+        if (insertedAt[index] == 0)
+            referenced++;
+        if (insertedAt[index] == 0 || clock - insertedAt[index] >= cacheSize)
+            insertedAt[index] = clock++;
+    }
+
+    std::size_t misses = clock - cacheSize;
+    VertexCacheStats stats;
+    if (indices.size() >= 3)
+        stats.acmr = (float)misses / (float)(indices.size() / 3);
+    if (referenced > 0)
+        stats.atvr = (float)misses / (float)referenced;
+    return stats;
+}
+
+MeshOptimizerReport optimizeMesh(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    MeshOptimizerReport report;
+    report.verticesBefore = vertices.size();
+    report.before = analyzeVertexCache(indices, vertices.size());
+
+    std::vector<std::uint32_t> clusterStarts;
+    weldVertices(vertices, indices);
+    optimizeVertexCache(indices, vertices.size(), clusterStarts);
+    optimizeOverdraw(indices, vertices, clusterStarts);
+    optimizeVertexFetch(vertices, indices);
+
+    report.verticesAfter = vertices.size();
+    report.after = analyzeVertexCache(indices, vertices.size());
+    report.shortIndices = vertices.size() <= 65536; // primitive restart is off, so 0xFFFF is an ordinary index
+    return report;
+}
+
+std::vector<std::uint16_t> narrowIndices(std::span<const unsigned int> indices)
+{
+    return { indices.begin(), indices.end() };
+}
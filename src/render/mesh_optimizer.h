@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vertex.h"
+
+// Post-transform cache efficiency of an index buffer, simulated with a FIFO cache.
+struct VertexCacheStats
+{
+    float acmr = 0.0f; // transformed vertices per triangle; 0.5 is ideal for a regular grid, 3 is worst
+    float atvr = 0.0f; // transformed vertices per referenced vertex; 1 is ideal
+};
+
+struct MeshOptimizerReport
+{
+    std::size_t verticesBefore = 0;
+    std::size_t verticesAfter = 0;
+    VertexCacheStats before;
+    VertexCacheStats after;
+    bool shortIndices = false;
+};
+
+// Size of the FIFO post-transform cache the reordering targets and the stats simulate.
+constexpr unsigned int VERTEX_CACHE_SIZE = 16;
+
+// Merges bit-identical vertices and drops unreferenced ones, rewriting the indices.
+void weldVertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+
+// Tipsify (Sander et al. 2007): fans around recently used vertices so they are still cached.
+// Fills clusterStarts with the first triangle of each run that began after a cache flush.
+void optimizeVertexCache(std::vector<unsigned int> &indices, std::size_t vertexCount,
+                         std::vector<std::uint32_t> &clusterStarts);
+
+// Orders the clusters from optimizeVertexCache outward-facing first, so that on average
+// the triangles most likely to occlude the rest are drawn before it.
+void optimizeOverdraw(std::vector<unsigned int> &indices, std::span<const Vertex> vertices,
+                      std::span<const std::uint32_t> clusterStarts);
+
+// Renumbers vertices in first-use order, so fetches walk the vertex buffer front to back.
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+
+VertexCacheStats analyzeVertexCache(std::span<const unsigned int> indices, std::size_t vertexCount,
+                                    unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Every step above, in order. shortIndices is set when all vertices fit 16-bit indices.
+MeshOptimizerReport optimizeMesh(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices);
+
+std::vector<std::uint16_t> narrowIndices(std::span<const unsigned int> indices);
@@ -0,0 +1,433 @@
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "mesh_optimizer.h"
+
+namespace
+{
+    constexpr unsigned int UNUSED = ~0u;
+    // a collapse may turn a surviving triangle by at most ~75 degrees
+    constexpr float MIN_NORMAL_COSINE = 0.25f;
+    // a level has to drop at least this share of the previous level's triangles to be kept
+    constexpr float MIN_LEVEL_REDUCTION = 0.1f;
+
+    // Area-weighted sum of squared distances to a set of planes, as a symmetric 4x4 matrix.
+    struct Quadric
+    {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c = 0.0;
+        double weight = 0.0;
+
+        void addPlane(const glm::dvec3 &n, double d, double w)
+        {
+            a00 += w * n.x * n.x;
+            a01 += w * n.x * n.y;
+            a02 += w * n.x * n.z;
+            a11 += w * n.y * n.y;
+            a12 += w * n.y * n.z;
+            a22 += w * n.z * n.z;
+            b0 += w * n.x * d;
+            b1 += w * n.y * d;
+            b2 += w * n.z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        void add(const Quadric &other)
+        {
+            a00 += other.a00;
+            a01 += other.a01;
+            a02 += other.a02;
+            a11 += other.a11;
+            a12 += other.a12;
+            a22 += other.a22;
+            b0 += other.b0;
+            b1 += other.b1;
+            b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+        }
+
+        // root mean square distance of p from the planes
+        float error(const glm::vec3 &p) const
+        {
+            if (weight <= 0.0)
+                return 0.0f;
+            double x = p.x, y = p.y, z = p.z;
+            double sum = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return (float)std::sqrt(std::max(sum, 0.0) / weight);
+        }
+    };
+
+    // moves every vertex at one position onto the matching vertices at another
+    struct Collapse
+    {
+        unsigned int from; // position ids
+        unsigned int to;
+        float error;
+    };
+
+    // triangles around each vertex, packed
+    struct Adjacency
+    {
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> triangles;
+
+        void build(std::span<const unsigned int> indices, std::size_t vertexCount)
+        {
+            offsets.assign(vertexCount + 1, 0);
+            for (unsigned int index : indices)
+                offsets[index + 1]++;
+            for (std::size_t v = 0; v < vertexCount; v++)
+                offsets[v + 1] += offsets[v];
+            triangles.resize(indices.size());
+            std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (std::size_t i = 0; i < indices.size(); i++)
+                triangles[fill[indices[i]]++] = (std::uint32_t)(i / 3);
+        }
+    };
+
+    std::uint64_t hashPosition(const glm::vec3 &position)
+    {
+        std::uint32_t words[3];
+        std::memcpy(words, &position, sizeof(words));
+        std::uint64_t hash = 14695981039346656037ull;
+        for (std::uint32_t word : words)
+            hash = (hash ^ word) * 1099511628211ull;
+        return hash ^ (hash >> 32);
+    }
+
+    // positionOf maps each vertex to the first one at its position; nextWedge links every
+    // vertex sharing a position (an attribute seam) into a ring
+    void buildPositionRings(std::span<const Vertex> vertices, std::vector<unsigned int> &positionOf,
+                            std::vector<unsigned int> &nextWedge)
+    {
+        std::size_t tableSize = std::bit_ceil(std::max<std::size_t>(vertices.size() * 2, 16));
+        std::vector<unsigned int> table(tableSize, UNUSED);
+        positionOf.resize(vertices.size());
+        nextWedge.resize(vertices.size());
+        for (unsigned int v = 0; v < vertices.size(); v++)
+        {
+            const glm::vec3 &position = vertices[v].position;
+            std::size_t slot = hashPosition(position) & (tableSize - 1);
+            while (table[slot] != UNUSED
+                   && std::memcmp(&vertices[table[slot]].position, &position, sizeof(glm::vec3)) != 0)
+                slot = (slot + 1) & (tableSize - 1);
+
+            if (table[slot] == UNUSED)
+            {
+                table[slot] = v;
+                positionOf[v] = v;
+                nextWedge[v] = v;
+            }
+            else
+            {
+                unsigned int first = table[slot];
+                positionOf[v] = first;
+                nextWedge[v] = nextWedge[first];
+                nextWedge[first] = v;
+            }
+        }
+    }
+
+    // positions on open or non-manifold edges; moving them would pull the outline in
+    std::vector<std::uint8_t> findLockedPositions(std::span<const unsigned int> indices,
+                                                  std::span<const unsigned int> positionOf)
+    {
+        std::vector<std::uint64_t> edges;
+        edges.reserve(indices.size());
+        auto edgeAt = [&](std::size_t i, int corner) {
+            std::uint64_t a = positionOf[indices[i + corner]];
+            std::uint64_t b = positionOf[indices[i + (corner + 1) % 3]];
+            return std::pair(a, b);
+        };
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            for (int corner = 0; corner < 3; corner++)
+            {
+                auto [a, b] = edgeAt(i, corner);
+                if (a != b)
+                    edges.push_back(a << 32 | b);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        auto count = [&](std::uint64_t a, std::uint64_t b) {
+            auto range = std::equal_range(edges.begin(), edges.end(), a << 32 | b);
+            return range.second - range.first;
+        };
+
+        std::vector<std::uint8_t> locked(positionOf.size(), 0);
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            for (int corner = 0; corner < 3; corner++)
+            {
+                auto [a, b] = edgeAt(i, corner);
+                if (a != b && (count(a, b) != 1 || count(b, a) != 1))
+                    locked[a] = locked[b] = 1;
+            }
+        }
+        return locked;
+    }
+
+    class EdgeCollapser
+    {
+    public:
+        EdgeCollapser(std::span<const Vertex> vertices, std::vector<unsigned int> &indices)
+            : vertices(vertices), indices(indices), remap(vertices.size())
+        {
+            buildPositionRings(vertices, positionOf, nextWedge);
+            locked = findLockedPositions(indices, positionOf);
+            std::iota(remap.begin(), remap.end(), 0u);
+
+            quadrics.resize(vertices.size());
+            for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+            {
+                glm::dvec3 p0(vertices[indices[i]].position);
+                glm::dvec3 p1(vertices[indices[i + 1]].position);
+                glm::dvec3 p2(vertices[indices[i + 2]].position);
+                glm::dvec3 cross = glm::cross(p1 - p0, p2 - p0);
+                double length = glm::length(cross);
+                if (length == 0.0)
+                    continue;
+                glm::dvec3 normal = cross / length;
+                for (int corner = 0; corner < 3; corner++)
+                    quadrics[positionOf[indices[i + corner]]].addPlane(normal, -glm::dot(normal, p0), length * 0.5);
+            }
+        }
+
+        // One pass of independent collapses, cheapest first; returns how many were applied.
+        std::size_t runPass(std::size_t targetIndexCount, float maxError, float &largestError)
+        {
+            adjacency.build(indices, vertices.size());
+            collectCandidates(maxError);
+
+            touched.assign(vertices.size(), 0);
+            std::size_t goal = (indices.size() - targetIndexCount + 2) / 3;
+            std::size_t removed = 0, applied = 0;
+            for (const Collapse &collapse : candidates)
+            {
+                // neighbours may have moved earlier in this pass, so the checks see their current positions
+                if (touched[collapse.from] || touched[collapse.to])
+                    continue;
+                std::size_t collapsedTriangles = 0;
+                if (!matchWedges(collapse.from, collapse.to, collapsedTriangles) || flips(collapse.from, collapse.to))
+                    continue;
+
+                for (auto [wedge, target] : wedgeTargets)
+                    remap[wedge] = target;
+                quadrics[collapse.to].add(quadrics[collapse.from]);
+                touched[collapse.from] = touched[collapse.to] = 1;
+                largestError = std::max(largestError, collapse.error);
+                applied++;
+                removed += collapsedTriangles;
+                if (removed >= goal)
+                    break;
+            }
+            if (applied > 0)
+                compact();
+            return applied;
+        }
+
+    private:
+        std::span<const Vertex> vertices;
+        std::vector<unsigned int> &indices;
+        std::vector<unsigned int> positionOf;
+        std::vector<unsigned int> nextWedge;
+        std::vector<unsigned int> remap; // vertex -> vertex it collapsed onto
+        std::vector<std::uint8_t> locked;
+        std::vector<std::uint8_t> touched; // positions already part of a collapse this pass
+        std::vector<Quadric> quadrics;     // by position id
+        Adjacency adjacency;
+        std::vector<Collapse> candidates;
+        std::vector<std::pair<unsigned int, unsigned int>> wedgeTargets;
+
+        void collectCandidates(float maxError)
+        {
+            candidates.clear();
+            for (std::size_t i = 0; i < indices.size(); i += 3)
+            {
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    unsigned int a = positionOf[indices[i + corner]];
+                    unsigned int b = positionOf[indices[i + (corner + 1) % 3]];
+                    if (a >= b) // every manifold edge runs upwards in exactly one of its triangles
+                        continue;
+
+                    Quadric merged = quadrics[a];
+                    merged.add(quadrics[b]);
+                    Collapse best{ UNUSED, UNUSED, std::numeric_limits<float>::max() };
+                    std::size_t unused = 0;
+                    if (!locked[a] && matchWedges(a, b, unused))
+                        best = { a, b, merged.error(vertices[b].position) };
+                    if (!locked[b] && matchWedges(b, a, unused))
+                    {
+                        float error = merged.error(vertices[a].position);
+                        if (error < best.error)
+                            best = { b, a, error };
+                    }
+                    if (best.from != UNUSED && best.error <= maxError)
+                        candidates.push_back(best);
+                }
+            }
+            std::sort(candidates.begin(), candidates.end(),
+                      [](const Collapse &x, const Collapse &y) { return x.error < y.error; });
+        }
+
+        // Pairs each vertex at `from` with the one vertex at `to` it shares triangles with. Fails
+        // when a vertex has none (it would lose its attributes) or several (a seam would tear).
+        bool matchWedges(unsigned int from, unsigned int to, std::size_t &collapsedTriangles)
+        {
+            wedgeTargets.clear();
+            collapsedTriangles = 0;
+            unsigned int wedge = from;
+            do
+            {
+                unsigned int target = UNUSED;
+                bool referenced = false;
+                for (std::uint32_t k = adjacency.offsets[wedge]; k < adjacency.offsets[wedge + 1]; k++)
+                {
+                    std::uint32_t triangle = adjacency.triangles[k];
+                    referenced = true;
+                    for (int corner = 0; corner < 3; corner++)
+                    {
+                        unsigned int v = remap[indices[triangle * 3 + corner]];
+                        if (positionOf[v] != to)
+                            continue;
+                        if (target != UNUSED && target != v)
+                            return false;
+                        target = v;
+                        collapsedTriangles++;
+                    }
+                }
+                if (referenced)
+                {
+                    if (target == UNUSED)
+                        return false;
+                    wedgeTargets.emplace_back(wedge, target);
+                }
+                wedge = nextWedge[wedge];
+            } while (wedge != from);
+            return true;
+        }
+
+        // whether moving `from` onto `to` would fold over or degenerate a triangle that survives
+        bool flips(unsigned int from, unsigned int to) const
+        {
+            const glm::vec3 &destination = vertices[to].position;
+            unsigned int wedge = from;
+            do
+            {
+                for (std::uint32_t k = adjacency.offsets[wedge]; k < adjacency.offsets[wedge + 1]; k++)
+                {
+                    std::uint32_t triangle = adjacency.triangles[k];
+                    glm::vec3 before[3], after[3];
+                    bool collapses = false;
+                    for (int corner = 0; corner < 3; corner++)
+                    {
+                        unsigned int v = remap[indices[triangle * 3 + corner]];
+                        collapses |= positionOf[v] == to;
+                        before[corner] = vertices[v].position;
+                        after[corner] = positionOf[v] == from ? destination : before[corner];
+                    }
+                    if (collapses)
+                        continue;
+
+                    glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    float lengths = glm::length(normalBefore) * glm::length(normalAfter);
+                    if (lengths == 0.0f || glm::dot(normalBefore, normalAfter) < MIN_NORMAL_COSINE * lengths)
+                        return true;
+                }
+                wedge = nextWedge[wedge];
+            } while (wedge != from);
+            return false;
+        }
+
+        // applies the pass's collapses and drops the triangles they flattened
+        void compact()
+        {
+            std::size_t write = 0;
+            for (std::size_t i = 0; i < indices.size(); i += 3)
+            {
+                unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+                if (positionOf[a] == positionOf[b] || positionOf[b] == positionOf[c] || positionOf[a] == positionOf[c])
+                    continue;
+                indices[write++] = a;
+                indices[write++] = b;
+                indices[write++] = c;
+            }
+            indices.resize(write);
+        }
+    };
+}
+
+std::uint64_t LodSettings::hash() const
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](float value) {
+        hash = (hash ^ std::bit_cast<std::uint32_t>(value)) * 1099511628211ull;
+    };
+    for (float ratio : targetRatios)
+        mix(ratio);
+    mix(maxError);
+    return hash;
+}
+
+std::vector<unsigned int> simplifyMesh(std::span<const Vertex> vertices, std::span<const unsigned int> indices,
+                                       std::size_t targetIndexCount, float maxError, float *resultError)
+{
+    std::vector<unsigned int> result(indices.begin(), indices.end());
+    float largestError = 0.0f;
+    if (result.size() > targetIndexCount && !vertices.empty())
+    {
+        EdgeCollapser collapser(vertices, result);
+        while (result.size() > targetIndexCount && collapser.runPass(targetIndexCount, maxError, largestError) > 0)
+        {
+        }
+    }
+    if (resultError != nullptr)
+        *resultError = largestError;
+    return result;
+}
+
+std::vector<LodLevel> generateLods(std::span<const Vertex> vertices, std::span<const unsigned int> indices,
+                                   const LodSettings &settings)
+{
+    AABB bounds;
+    for (const Vertex &vertex : vertices)
+        bounds.expand(vertex.position);
+    if (bounds.empty())
+        return {};
+    float errorLimit = settings.maxError * glm::length(bounds.extent());
+
+    // every level starts from the full mesh, so its error is measured against the original surface
+    std::vector<LodLevel> levels;
+    std::vector<std::uint32_t> clusterStarts;
+    std::size_t previousCount = indices.size();
+    float previousError = 0.0f;
+    for (float ratio : settings.targetRatios)
+    {
+        auto targetCount = (std::size_t)((float)(indices.size() / 3) * ratio) * 3;
+        float error = 0.0f;
+        std::vector<unsigned int> simplified = simplifyMesh(vertices, indices, targetCount, errorLimit, &error);
+        if (simplified.empty() || (float)simplified.size() > (1.0f - MIN_LEVEL_REDUCTION) * (float)previousCount)
+            break;
+
+        optimizeVertexCache(simplified, vertices.size(), clusterStarts);
+        previousCount = simplified.size();
+        previousError = std::max(previousError, error);
+        levels.push_back({ std::move(simplified), previousError });
+    }
+    return levels;
+}
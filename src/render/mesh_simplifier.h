@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vertex.h"
+
+// Import-time LOD chain parameters. Changing them invalidates cooked mesh caches.
+struct LodSettings
+{
+    // one level per ratio of the full triangle count, coarsest last
+    std::vector<float> targetRatios = { 0.5f, 0.25f, 0.125f };
+    // largest allowed deviation from the full mesh, relative to its bounding radius; the chain
+    // ends at the first level that cannot reach its ratio within it
+    float maxError = 0.02f;
+
+    std::uint64_t hash() const;
+};
+
+struct LodLevel
+{
+    std::vector<unsigned int> indices; // over the full mesh's vertices
+    float error;                       // object-space distance from the full mesh's surface
+};
+
+// Quadric-error-metric edge collapse (Garland-Heckbert). Collapses only move vertices onto
+// existing ones, so the result indexes the same vertex array. Vertices on open borders stay
+// put, and attribute seams collapse only along themselves, so UVs and normals never tear.
+// Stops at targetIndexCount or before any collapse would exceed maxError, which is in
+// object-space units; resultError receives the largest error actually introduced.
+std::vector<unsigned int> simplifyMesh(std::span<const Vertex> vertices, std::span<const unsigned int> indices,
+                                       std::size_t targetIndexCount, float maxError, float *resultError = nullptr);
+
+// Simplifies the full mesh once per target ratio, each level in vertex cache order. Levels
+// that would barely shrink the previous one are dropped, and so is everything after them.
+std::vector<LodLevel> generateLods(std::span<const Vertex> vertices, std::span<const unsigned int> indices,
+                                   const LodSettings &settings);
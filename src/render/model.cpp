@@ -1,44 +1,82 @@
 #include "model.h"
 
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <utility>
 #include <assimp/postprocess.h>
-#include <stb_image.h>
 
-Model::Model(const std::string &path, GLenum wrapMode)
-    : wrapMode(wrapMode)
+#include "mesh_optimizer.h"
+
+namespace
 {
-    loadModel(path);
+    constexpr unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs;
 }
 
-void Model::draw(const Shader &shader) const
+ModelData ModelData::parse(const std::string &path, GLenum wrapMode, const LodSettings &lodSettings)
 {
-    for (Mesh mesh : meshes)
+    ModelData data;
+    data.path = path;
+    data.wrapMode = wrapMode;
+    data.lodSettings = lodSettings;
+    data.directory = path.substr(0, path.find_last_of('/'));
+
+    std::uint64_t sourceHash = MeshCache::hashFile(path);
+    std::string cachePath = MeshCache::cachePath(path);
+    MeshCache cache(cachePath, sourceHash, IMPORT_FLAGS, lodSettings.hash());
+    if (cache.valid())
     {
-        mesh.draw(shader);
+        data.meshes.reserve(cache.meshCount());
+        for (std::size_t i = 0; i < cache.meshCount(); i++)
+        {
+            data.meshes.push_back(cache.mesh(i));
+            for (const CookedTexture &texture : data.meshes.back().textures)
+                data.images.try_emplace(texture.path);
+        }
+        data.cache.emplace(std::move(cache));
+        data.fromCache = true;
+        return data;
     }
-}
 
-void Model::loadModel(const std::string &path)
-{
     Assimp::Importer import;
-    const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    const aiScene *scene = import.ReadFile(path, IMPORT_FLAGS);
 
     if (scene == nullptr || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
         std::cout << "ERROR:ASSIMP::" << import.GetErrorString() << std::endl;
-        return;
+        return data;
     }
 
-    directory = path.substr(0, path.find_last_of('/'));
-    processNode(scene->mRootNode, scene);
+    data.processNode(scene->mRootNode, scene);
+
+    if (!MeshCache::write(cachePath, sourceHash, IMPORT_FLAGS, lodSettings.hash(), data.meshes))
+        std::cout << "WARNING::MESH_CACHE::WRITE_FAILED " << cachePath << std::endl;
+    return data;
+}
+
+ModelData ModelData::load(const std::string &path, GLenum wrapMode, const LodSettings &lodSettings)
+{
+    ModelData data = parse(path, wrapMode, lodSettings);
+    data.decodeImages();
+    return data;
+}
+
+void ModelData::decodeImages()
+{
+    for (auto &[imagePath, image] : images)
+    {
+        if (!image.valid())
+            image = Texture::decode(imagePath);
+    }
 }
 
-void Model::processNode(const aiNode *node, const aiScene *scene)
+void ModelData::processNode(const aiNode *node, const aiScene *scene)
 {
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
         aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
+        processMesh(mesh, scene);
     }
 
     for (unsigned int i = 0; i < node->mNumChildren; i++)
@@ -47,12 +85,14 @@ void Model::processNode(const aiNode *node, const aiScene *scene)
     }
 }
 
-Mesh Model::processMesh(const aiMesh *mesh, const aiScene *scene)
+void ModelData::processMesh(const aiMesh *mesh, const aiScene *scene)
 {
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    std::vector<CookedTexture> textures;
 
+    vertices.reserve(mesh->mNumVertices);
+    indices.reserve(mesh->mNumFaces * 3);
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
         auto v = mesh->mVertices[i];
@@ -75,34 +115,217 @@ Mesh Model::processMesh(const aiMesh *mesh, const aiScene *scene)
     }
 
     aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
-    std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-    std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+    listMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", textures);
+    listMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", textures);
+
+    addMesh(std::move(vertices), std::move(indices), std::move(textures));
+}
+
+void ModelData::addMesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices,
+                        std::vector<CookedTexture> textures, bool report)
+{
+    CookedMesh cooked;
+    cooked.textures = std::move(textures);
+    for (const Vertex &vertex : vertices)
+        cooked.bounds.expand(vertex.position);
+
+    // only runs on a cold import; the cache keeps the optimized arrays
+    MeshOptimizerReport optimized = optimizeMesh(vertices, indices);
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(3) << "mesh optimizer: " << path << " #" << meshes.size() << " "
+        << optimized.verticesBefore << " -> " << optimized.verticesAfter << " vertices, ACMR "
+        << optimized.before.acmr << " -> " << optimized.after.acmr << ", ATVR " << optimized.before.atvr << " -> "
+        << optimized.after.atvr << (optimized.shortIndices ? ", 16-bit indices" : "") << '\n';
+
+    // every level indexes the same vertices, so they all share one index blob
+    std::vector<LodLevel> levels = generateLods(vertices, indices, lodSettings);
+    std::vector<MeshLod> &lods = lodStorage.emplace_back();
+    lods.push_back({ 0, (std::uint32_t)indices.size(), 0.0f });
+    line << "mesh lods: " << path << " #" << meshes.size() << " " << indices.size() / 3;
+    for (LodLevel &level : levels)
+    {
+        lods.push_back({ (std::uint32_t)indices.size(), (std::uint32_t)level.indices.size(), level.error });
+        indices.insert(indices.end(), level.indices.begin(), level.indices.end());
+        line << " -> " << level.indices.size() / 3 << " (error " << level.error << ")";
+    }
+    line << " triangles\n";
+    if (report)
+        std::cout << line.str() << std::flush;
 
-    return Mesh(vertices, indices, textures);
+    // stored vectors are only ever moved, which keeps their buffers, so the spans stay valid
+    cooked.vertices = vertexStorage.emplace_back(encodeVertices<GpuVertex>(vertices, cooked.bounds));
+    if (optimized.shortIndices)
+    {
+        std::vector<std::uint16_t> &shortIndices = shortIndexStorage.emplace_back(narrowIndices(indices));
+        cooked.indices = { std::as_bytes(std::span(shortIndices)), sizeof(std::uint16_t), lods };
+    }
+    else
+    {
+        std::vector<unsigned int> &storedIndices = indexStorage.emplace_back(std::move(indices));
+        cooked.indices = { std::as_bytes(std::span(storedIndices)), sizeof(unsigned int), lods };
+    }
+    meshes.push_back(std::move(cooked));
 }
 
-std::vector<Texture> Model::loadMaterialTextures(const aiMaterial *mat, aiTextureType type, const std::string &typeName)
+void ModelData::listMaterialTextures(const aiMaterial *mat, aiTextureType type, const std::string &typeName,
+                                     std::vector<CookedTexture> &textures)
 {
-    std::vector<Texture> textures;
     for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
     {
         aiString str;
         mat->GetTexture(type, i, &str);
         std::string filepath = directory + '/' + str.C_Str();
 
-        auto it = textureCache.find(filepath);
-        if (it != textureCache.end())
-        {
-            textures.push_back(it->second);
-        }
+        images.try_emplace(filepath);
+        textures.push_back({ typeName, std::move(filepath) });
+    }
+}
+
+Model::Model(const std::string &path, GeometryArena &arena, GLenum wrapMode)
+    : Model(ModelData::load(path, wrapMode), arena)
+{
+}
+
+Model::Model(ModelData loaded, GeometryArena &arena, UploadStreamer *streamer)
+    : fromCache(loaded.fromCache)
+{
+    // streamed uploads read from the loaded arrays and images over later frames, so they share ownership
+    std::shared_ptr<const ModelData> shared;
+    if (streamer != nullptr)
+        shared = std::make_shared<const ModelData>(std::move(loaded));
+    const ModelData &data = shared ? *shared : loaded;
+
+    meshes.reserve(data.meshes.size());
+    for (const CookedMesh &cooked : data.meshes)
+    {
+        std::vector<const Texture *> textures;
+        textures.reserve(cooked.textures.size());
+        for (const CookedTexture &texture : cooked.textures)
+            textures.push_back(uploadTexture(texture, data, streamer, shared));
+
+        if (streamer != nullptr)
+            meshes.emplace_back(cooked.vertices, cooked.indices, std::move(textures), cooked.bounds, arena, *streamer,
+                                shared);
         else
-        {
-            Texture tex { Texture::load(filepath, wrapMode), typeName, filepath };
-            textureCache[filepath] = tex;
-            textures.push_back(tex);
-        }
+            meshes.emplace_back(cooked.vertices, cooked.indices, std::move(textures), cooked.bounds, arena);
+        bounds.expand(cooked.bounds);
+    }
+    if (!bounds.empty())
+        boundingSphere = { bounds.center(), glm::length(bounds.extent()) };
+
+    // a model level is as coarse as its coarsest mesh at that level
+    for (const Mesh &mesh : meshes)
+    {
+        if (mesh.lodCount() > lodErrors.size())
+            lodErrors.resize(mesh.lodCount(), 0.0f);
+    }
+    for (std::size_t level = 0; level < lodErrors.size(); level++)
+    {
+        for (const Mesh &mesh : meshes)
+            lodErrors[level] = std::max(lodErrors[level], mesh.lod(level).error);
+    }
+
+    instanceTransforms = GLBuffer::create();
+    instanceTints = GLBuffer::create();
+    reserveInstances(1); // instance attributes must always point at valid storage
+}
+
+void Model::draw(const Shader &shader) const
+{
+    for (const Mesh &mesh : meshes)
+    {
+        mesh.draw(shader);
+    }
+}
+
+void Model::drawInstanced(const Shader &shader, std::span<const glm::mat4> transforms,
+                          std::span<const glm::vec4> tints)
+{
+    if (transforms.empty())
+        return;
+
+    bool useTints = uploadInstances(transforms, tints);
+
+    shader.set(shader.builtins().instanced, true);
+    for (const Mesh &mesh : meshes)
+    {
+        // the VAO is shared across the arena block, so it may still point at another model's instances
+        mesh.attachInstanceBuffers(instanceTransforms.get(), instanceTints.get());
+        mesh.drawInstanced(shader, (int)transforms.size(), useTints);
+    }
+    shader.set(shader.builtins().instanced, false);
+}
+
+bool Model::uploadInstances(std::span<const glm::mat4> transforms, std::span<const glm::vec4> tints)
+{
+    bool useTints = !tints.empty() && tints.size() == transforms.size();
+    reserveInstances(transforms.size());
+
+    // orphan and refill, so this frame's write never waits on last frame's draws
+    glBindBuffer(GL_ARRAY_BUFFER, instanceTransforms.get());
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, transforms.size_bytes(), transforms.data());
+    if (useTints)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceTints.get());
+        glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, tints.size_bytes(), tints.data());
+    }
+    else
+    {
+        glVertexAttrib4f(INSTANCE_TINT_LOCATION, 1.0f, 1.0f, 1.0f, 1.0f);
+    }
+    return useTints;
+}
+
+void Model::reserveInstances(std::size_t count)
+{
+    if (count <= instanceCapacity)
+        return;
+
+    instanceCapacity = std::max(count, instanceCapacity * 2);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceTransforms.get());
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceTints.get());
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+}
+
+bool Model::geometryResident() const
+{
+    return std::all_of(meshes.begin(), meshes.end(), [](const Mesh &mesh) { return mesh.resident(); });
+}
+
+bool Model::resident() const
+{
+    return geometryResident() && std::all_of(textureCache.begin(), textureCache.end(),
+                                             [](const auto &entry) { return entry.second.resident(); });
+}
+
+void Model::releaseCpuData()
+{
+    for (Mesh &mesh : meshes)
+    {
+        mesh.releaseCpuData();
+    }
+}
+
+const Texture *Model::uploadTexture(const CookedTexture &texture, const ModelData &data, UploadStreamer *streamer,
+                                    const std::shared_ptr<const ModelData> &keepAlive)
+{
+    auto it = textureCache.find(texture.path);
+    if (it != textureCache.end())
+        return &it->second;
+
+    auto image = data.images.find(texture.path);
+    if (streamer != nullptr && image != data.images.end())
+    {
+        auto [inserted, _] = textureCache.emplace(texture.path, Texture::stream(image->second, data.wrapMode,
+            texture.type, texture.path, *streamer, keepAlive));
+        return &inserted->second;
     }
-    return textures;
+
+    GLTexture handle = image != data.images.end() ? Texture::upload(image->second, data.wrapMode)
+                                                  : Texture::load(texture.path, data.wrapMode);
+    auto [inserted, _] = textureCache.emplace(texture.path, Texture{ std::move(handle), texture.type, texture.path });
+    return &inserted->second;
 }
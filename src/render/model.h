@@ -1,26 +1,129 @@
 #pragma once
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
+#include <glm/glm.hpp>
 
 #include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_simplifier.h"
 #include "shader.h"
+#include "texture.h"
+#include "upload_streamer.h"
+#include "systems/profiler.h"
+
+// CPU-side result of loading a model file: mesh arrays (from the mesh cache or Assimp) and
+// decoded textures. Building it makes no GL calls, so it can run on a worker thread and
+// leave only the uploads to the Model constructor on the GL thread.
+class ModelData
+{
+public:
+    std::string path;
+    GLenum wrapMode = GL_REPEAT;
+    bool fromCache = false;
+    std::vector<CookedMesh> meshes;
+    std::unordered_map<std::string, TextureImage> images; // by path, one per distinct texture
+
+    // parse() followed by decodeImages(), all on the calling thread.
+    static ModelData load(const std::string &path, GLenum wrapMode = GL_REPEAT, const LodSettings &lodSettings = {});
+    // Parses the meshes and lists their textures in `images`, without decoding them yet. A cold
+    // import also builds each mesh's LOD chain with lodSettings.
+    static ModelData parse(const std::string &path, GLenum wrapMode = GL_REPEAT, const LodSettings &lodSettings = {});
+    // Decodes every listed image in turn; AssetLoader decodes them in parallel instead.
+    void decodeImages();
+
+    // Optimizes, builds the LOD chain for and encodes one mesh, as an import does for each of
+    // its meshes; lets generated geometry take the same path. report prints the results.
+    void addMesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<CookedTexture> textures,
+                 bool report = true);
+
+private:
+    // storage behind the mesh spans: a mapped cache file or the arrays Assimp was read into
+    std::optional<MeshCache> cache;
+    std::vector<std::vector<GpuVertex>> vertexStorage;
+    std::vector<std::vector<unsigned int>> indexStorage;
+    std::vector<std::vector<std::uint16_t>> shortIndexStorage;
+    std::vector<std::vector<MeshLod>> lodStorage;
+    std::string directory;
+    LodSettings lodSettings;
+
+    void processNode(const aiNode *node, const aiScene *scene);
+    void processMesh(const aiMesh *mesh, const aiScene *scene);
+    void listMaterialTextures(const aiMaterial *mat, aiTextureType type, const std::string &typeName,
+                              std::vector<CookedTexture> &textures);
+};
 
 class Model
 {
 public:
-    explicit Model(const std::string &path, GLenum wrapMode = GL_REPEAT);
+    // Mesh geometry is placed in the arena, which must outlive the model.
+    Model(const std::string &path, GeometryArena &arena, GLenum wrapMode = GL_REPEAT);
+    // Uploads already loaded data; GL thread only. With a streamer only the storage is
+    // allocated here, and meshes and textures become resident as the streamer fills them.
+    Model(ModelData data, GeometryArena &arena, UploadStreamer *streamer = nullptr);
+
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+    Model(Model &&) noexcept = default;
+    Model &operator=(Model &&) noexcept = default;
+
     void draw(const Shader &shader) const;
 
+    // Draws one copy per transform in a single base-vertex call per mesh. Tints, when given, must
+    // match the transform count; otherwise every instance is drawn untinted.
+    void drawInstanced(const Shader &shader, std::span<const glm::mat4> transforms,
+                       std::span<const glm::vec4> tints = {});
+
+    // Streams per-instance data into the instance buffers without drawing; returns whether
+    // tints were uploaded. The buffers hold one batch, so upload once per model per frame.
+    bool uploadInstances(std::span<const glm::mat4> transforms, std::span<const glm::vec4> tints = {});
+
+    const std::vector<Mesh> &getMeshes() const { return meshes; }
+    // Sources of the per-instance attributes, for attaching to a mesh before an instanced draw.
+    unsigned int instanceTransformBuffer() const { return instanceTransforms.get(); }
+    unsigned int instanceTintBuffer() const { return instanceTints.get(); }
+    // Levels of detail: level i draws each mesh's level i, or its coarsest if it has fewer.
+    std::size_t lodCount() const { return lodErrors.size(); }
+    // Largest object-space error any mesh shows at the level; grows with the level.
+    float lodError(std::size_t level) const { return lodErrors[std::min(level, lodErrors.size() - 1)]; }
+
+    // Object-space bounds over every mesh.
+    const AABB &getBounds() const { return bounds; }
+    const BoundingSphere &getBoundingSphere() const { return boundingSphere; }
+
+    // Streaming progress: every mesh can draw once geometryResident(), and resident() adds the
+    // textures, until which the meshes sample placeholders.
+    bool geometryResident() const;
+    bool resident() const;
+
+    // Drops every mesh's CPU-side vertex/index copies once they are on the GPU.
+    void releaseCpuData();
+
+    // Whether the meshes came from the cooked mesh cache rather than an Assimp import.
+    bool loadedFromCache() const { return fromCache; }
+
+    // Profiler zone the render queue times this model's draws under.
+    void setProfileZone(ProfileZoneId zone) { profileZone = zone; }
+    ProfileZoneId getProfileZone() const { return profileZone; }
+
 private:
     std::vector<Mesh> meshes;
-    std::string directory;
-    std::unordered_map<std::string, Texture> textureCache;
-    GLenum wrapMode;
+    std::unordered_map<std::string, Texture> textureCache; // node-based, so meshes can point into it
+    AABB bounds;
+    BoundingSphere boundingSphere;
+    bool fromCache = false;
+    std::vector<float> lodErrors{ 0.0f };
+    ProfileZoneId profileZone = NO_PROFILE_ZONE;
 
-    void loadModel(const std::string &path);
-    void processNode(const aiNode *node, const aiScene *scene);
-    Mesh processMesh(const aiMesh *mesh, const aiScene *scene);
-    std::vector<Texture> loadMaterialTextures(const aiMaterial *mat, aiTextureType type, const std::string &typeName);
+    GLBuffer instanceTransforms;
+    GLBuffer instanceTints;
+    std::size_t instanceCapacity = 0;
+
+    void reserveInstances(std::size_t count);
+    const Texture *uploadTexture(const CookedTexture &texture, const ModelData &data, UploadStreamer *streamer,
+                                 const std::shared_ptr<const ModelData> &keepAlive);
 };
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// Feature defines of fragmentShaderPhong.glsl, as ShaderVariants masks. PHONG_UBER_SHADER
+// evaluates every LightData light whether it contributes or not.
+enum PhongFeature : std::uint32_t
+{
+    PHONG_DIRECTIONAL_LIGHT = 1 << 0,
+    PHONG_POINT_LIGHTS = 1 << 1, // the first LightData::pointLightCount point lights
+    PHONG_SPOT_LIGHT = 1 << 2,
+    PHONG_CLUSTERED_LIGHTS = 1 << 3, // the lights LightClusters binned
+    PHONG_SHADOWS = 1 << 4,          // ShadowMaps' cascades for dirLight and cube map for pointLights[0]
+    PHONG_ALL_FEATURES = (1 << 5) - 1,
+    PHONG_UBER_SHADER = PHONG_DIRECTIONAL_LIGHT | PHONG_POINT_LIGHTS | PHONG_SPOT_LIGHT,
+};
+
+constexpr std::array<std::string_view, 5> PHONG_FEATURE_DEFINES = {
+    "DIRECTIONAL_LIGHT", "POINT_LIGHTS", "SPOT_LIGHT", "CLUSTERED_LIGHTS", "SHADOWS",
+};
@@ -0,0 +1,138 @@
+#include "program_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <glad/glad.h>
+
+#include "lib/mapped_file.h"
+
+namespace
+{
+    constexpr char CACHE_DIRECTORY[] = "cache/programs/";
+    constexpr char MAGIC[4] = { 'L', 'O', 'P', 'B' };
+    constexpr std::uint32_t VERSION = 1;
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint32_t binaryFormat; // driver-defined, handed back to glProgramBinary as is
+        std::uint32_t binarySize;
+    };
+
+    // FNV-1a, continued across calls
+    std::uint64_t hashBytes(std::uint64_t hash, std::string_view bytes)
+    {
+        for (char c : bytes)
+            hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+        // a separator, so "ab" + "c" and "a" + "bc" differ
+        return (hash ^ 0xffu) * 1099511628211ull;
+    }
+
+    std::string_view glString(GLenum name)
+    {
+        const auto *value = (const char *)glGetString(name);
+        return value != nullptr ? value : "";
+    }
+}
+
+void ProgramCache::detectSupport()
+{
+    GLint major = 0, minor = 0, extensionCount = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool available = major > 4 || (major == 4 && minor >= 1);
+
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount && !available; i++)
+    {
+        const auto *name = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        available = std::strcmp(name, "GL_ARB_get_program_binary") == 0;
+    }
+
+    // some drivers expose the entry points but no format to save in
+    GLint formatCount = 0;
+    if (available)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    isSupported = formatCount > 0;
+
+    driverHash = 14695981039346656037ull;
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+        driverHash = hashBytes(driverHash, glString(name));
+}
+
+std::uint64_t ProgramCache::key(std::span<const std::string_view> sources)
+{
+    std::uint64_t hash = driverHash;
+    for (std::string_view source : sources)
+        hash = hashBytes(hash, source);
+    return hash != 0 ? hash : 1;
+}
+
+bool ProgramCache::load(unsigned int program, std::uint64_t key)
+{
+    if (!isSupported)
+        return false;
+    MappedFile file(cachePath(key));
+    std::span<const std::byte> bytes = file.bytes();
+    if (!file.valid() || bytes.size() < sizeof(Header))
+        return false;
+
+    Header header;
+    std::memcpy(&header, bytes.data(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.key != key
+        || header.binarySize != bytes.size() - sizeof(Header))
+        return false;
+
+    glProgramBinary(program, header.binaryFormat, bytes.data() + sizeof(Header), (GLsizei)header.binarySize);
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked != 0;
+}
+
+bool ProgramCache::store(unsigned int program, std::uint64_t key)
+{
+    if (!isSupported)
+        return false;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.key = key;
+    std::vector<char> binary((std::size_t)length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    header.binaryFormat = format;
+    header.binarySize = (std::uint32_t)written;
+
+    // write beside the target and rename, so a crash never leaves a half-written entry behind
+    std::string path = cachePath(key);
+    std::error_code error;
+    std::filesystem::create_directories(CACHE_DIRECTORY, error);
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write((const char *)&header, sizeof(header));
+        out.write(binary.data(), written);
+        if (!out)
+            return false;
+    }
+    std::filesystem::rename(tempPath, path, error);
+    return !error;
+}
+
+std::string ProgramCache::cachePath(std::uint64_t key)
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return CACHE_DIRECTORY + std::string(name) + ".bin";
+}
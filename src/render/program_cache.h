@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Linked program binaries kept on disk, so warm starts skip GLSL compilation entirely.
+// A binary only suits the driver that produced it, so entries are keyed by a hash of the
+// sources together with the driver's vendor, renderer and version strings. A driver that
+// rejects a binary anyway (an update with the same version string) just costs a recompile.
+class ProgramCache
+{
+public:
+    // Needs GL 4.1 or ARB_get_program_binary, and a driver offering at least one binary format.
+    // Call once with a current context; until then (or without support) nothing is cached.
+    static void detectSupport();
+    static bool supported() { return isSupported; }
+
+    // Hash of everything that decides the linked program: every stage's source and the driver.
+    static std::uint64_t key(std::span<const std::string_view> sources);
+
+    // Loads a cached binary into the program, which is then linked; false when the entry is
+    // missing, corrupt or rejected by the driver.
+    static bool load(unsigned int program, std::uint64_t key);
+    // The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+    static bool store(unsigned int program, std::uint64_t key);
+
+    // Where an entry lives, e.g. "cache/programs/3f2a9c0d11e4b7a5.bin".
+    static std::string cachePath(std::uint64_t key);
+
+private:
+    static inline bool isSupported = false;
+    static inline std::uint64_t driverHash = 0;
+};
@@ -0,0 +1,261 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include <array>
+
+void RenderQueue::begin(const glm::vec3 &viewPos, float farPlane, const Frustum &frustum)
+{
+    this->viewPos = viewPos;
+    this->farPlane = farPlane;
+    this->frustum = frustum;
+    frameStats = {};
+    commands.clear();
+    drawData.clear();
+    entries.clear();
+    sorted = false;
+}
+
+void RenderQueue::submit(const Model &model, const Shader &shader, const glm::mat4 &transform,
+                         RenderPass pass, const glm::vec4 &tint, std::uint8_t lod)
+{
+    auto dataIndex = (std::uint32_t)drawData.size();
+    drawData.push_back({ transform, tint });
+
+    float depth = normalizedDepth(transform);
+    for (const Mesh &mesh : model.getMeshes())
+    {
+        if (!mesh.resident())
+            continue;
+        if (!frustum.intersects(mesh.getBounds().transformed(transform)))
+        {
+            frameStats.culledMeshes++;
+            continue;
+        }
+        entries.push_back({ makeKey(pass, shader.sortId(), mesh.materialKey(), mesh.vertexArray(), depth),
+                            (std::uint32_t)commands.size() });
+        commands.push_back({ &mesh, &shader, dataIndex, 0, false, lod, 0, 0, model.getProfileZone() });
+        frameStats.triangles += mesh.triangleCount(lod);
+        frameStats.fullDetailTriangles += mesh.triangleCount();
+    }
+}
+
+void RenderQueue::submitInstanced(Model &model, const Shader &shader, std::span<const glm::mat4> transforms,
+                                  std::span<const glm::vec4> tints, RenderPass pass, std::uint8_t lod)
+{
+    // spheres are cheap to move with each instance; the per-mesh boxes are not worth it here
+    bool hasTints = !tints.empty() && tints.size() == transforms.size();
+    visibleTransforms.clear();
+    visibleTints.clear();
+    for (std::size_t i = 0; i < transforms.size(); i++)
+    {
+        if (!frustum.intersects(model.getBoundingSphere().transformed(transforms[i])))
+        {
+            frameStats.culledInstances++;
+            continue;
+        }
+        visibleTransforms.push_back(transforms[i]);
+        if (hasTints)
+            visibleTints.push_back(tints[i]);
+    }
+    if (visibleTransforms.empty())
+        return;
+
+    bool useTints = model.uploadInstances(visibleTransforms, visibleTints);
+    float depth = normalizedDepth(visibleTransforms.front());
+    for (const Mesh &mesh : model.getMeshes())
+    {
+        if (!mesh.resident())
+            continue;
+        entries.push_back({ makeKey(pass, shader.sortId(), mesh.materialKey(), mesh.vertexArray(), depth),
+                            (std::uint32_t)commands.size() });
+        commands.push_back({ &mesh, &shader, 0, (std::uint32_t)visibleTransforms.size(), useTints, lod,
+                             model.instanceTransformBuffer(), model.instanceTintBuffer(), model.getProfileZone() });
+        frameStats.triangles += (std::uint64_t)mesh.triangleCount(lod) * visibleTransforms.size();
+        frameStats.fullDetailTriangles += (std::uint64_t)mesh.triangleCount() * visibleTransforms.size();
+    }
+}
+
+void RenderQueue::execute(Profiler *profiler, const Shader *overrideShader)
+{
+    sort();
+    frameStats.draws = (unsigned int)entries.size();
+    draw(overrideShader, false, profiler);
+}
+
+void RenderQueue::executeDepthOnly(const Shader &depthShader, Profiler *profiler)
+{
+    sort();
+    draw(&depthShader, true, profiler);
+}
+
+void RenderQueue::sort()
+{
+    if (sorted)
+        return;
+    countUnsortedChanges();
+    radixSort();
+    sorted = true;
+}
+
+void RenderQueue::draw(const Shader *overrideShader, bool depthOnly, Profiler *profiler)
+{
+    // the depth pass changes state too, but only the shading pass is compared with submission order
+    RenderQueueStats discarded;
+    RenderQueueStats &counted = depthOnly ? discarded : frameStats;
+
+    const Shader *currentShader = nullptr;
+    const Mesh *currentMaterial = nullptr;
+    unsigned int currentVertexArray = 0;
+    unsigned int attachedTransforms = 0; // instance buffers attached to the current VAO
+    unsigned int attachedTints = 0;
+    bool instanced = false;
+    ProfileZoneId currentZone = NO_PROFILE_ZONE;
+
+    for (const SortEntry &entry : entries)
+    {
+        // blended draws sort last, so the depth pass is a prefix of the queue
+        if (depthOnly && (entry.key >> 62) == PASS_TRANSPARENT)
+            break;
+        const DrawCommand &command = commands[entry.command];
+        const Mesh &mesh = *command.mesh;
+        const Shader &shader = overrideShader != nullptr ? *overrideShader : *command.shader;
+        if (depthOnly)
+            frameStats.depthOnlyDraws++;
+
+        // sorting interleaves models, so a zone covers each run of one model's draws
+        if (profiler != nullptr && command.zone != currentZone)
+        {
+            if (currentZone != NO_PROFILE_ZONE)
+                profiler->end();
+            if (command.zone != NO_PROFILE_ZONE)
+                profiler->begin(command.zone);
+            currentZone = command.zone;
+        }
+        if (&shader != currentShader)
+        {
+            if (currentShader != nullptr && instanced)
+                currentShader->set(currentShader->builtins().instanced, false);
+            shader.use();
+            currentShader = &shader;
+            currentMaterial = nullptr; // sampler units are per-program state
+            instanced = false;
+            counted.programChanges++;
+        }
+        if (currentMaterial == nullptr || !mesh.sharesMaterialWith(*currentMaterial))
+        {
+            mesh.bindTextures(shader);
+            currentMaterial = &mesh;
+            counted.textureChanges++;
+        }
+        if (mesh.vertexArray() != currentVertexArray)
+        {
+            mesh.bindVertexArray();
+            currentVertexArray = mesh.vertexArray();
+            attachedTransforms = attachedTints = 0;
+            counted.vertexArrayChanges++;
+        }
+
+        bool wantInstanced = command.instanceCount > 0;
+        if (wantInstanced != instanced)
+        {
+            shader.set(shader.builtins().instanced, wantInstanced);
+            instanced = wantInstanced;
+        }
+        // arena blocks share one VAO between models, so their instance buffers are swapped in per command
+        if (wantInstanced
+            && (command.instanceTransforms != attachedTransforms || command.instanceTints != attachedTints))
+        {
+            mesh.attachInstanceBuffers(command.instanceTransforms, command.instanceTints);
+            attachedTransforms = command.instanceTransforms;
+            attachedTints = command.instanceTints;
+        }
+        if (!wantInstanced)
+        {
+            const DrawData &data = drawData[command.drawDataIndex];
+            shader.set(shader.builtins().modelMatrix, data.modelMatrix);
+            shader.set(shader.builtins().tint, data.tint);
+        }
+        mesh.bindPositionTransform(shader);
+        mesh.drawElements((int)command.instanceCount, command.useTints, command.lod);
+    }
+
+    if (currentShader != nullptr && instanced)
+        currentShader->set(currentShader->builtins().instanced, false);
+    if (profiler != nullptr && currentZone != NO_PROFILE_ZONE)
+        profiler->end();
+}
+
+std::uint64_t RenderQueue::makeKey(RenderPass pass, unsigned int program, std::uint16_t material,
+                                   unsigned int vertexArray, float depth)
+{
+    constexpr std::uint64_t DEPTH_MAX = (1u << 24) - 1;
+    auto quantized = (std::uint64_t)(std::clamp(depth, 0.0f, 1.0f) * (float)DEPTH_MAX);
+    std::uint64_t state = ((std::uint64_t)(program & 0xFF) << 30)
+                        | ((std::uint64_t)material << 14)
+                        | (std::uint64_t)(vertexArray & 0x3FFF);
+
+    std::uint64_t key = (std::uint64_t)(pass & 0x3) << 62;
+    if (pass == PASS_TRANSPARENT)
+        return key | ((DEPTH_MAX - quantized) << 38) | state;
+    return key | (state << 24) | quantized;
+}
+
+float RenderQueue::normalizedDepth(const glm::mat4 &transform) const
+{
+    return glm::length(glm::vec3(transform[3]) - viewPos) / farPlane;
+}
+
+void RenderQueue::radixSort()
+{
+    // LSD radix sort on the key, one byte per pass; stable, so equal keys keep submission order
+    scratch.resize(entries.size());
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        std::array<std::uint32_t, 256> counts{};
+        for (const SortEntry &entry : entries)
+            counts[(entry.key >> shift) & 0xFF]++;
+
+        // every key shares this byte, nothing to reorder
+        if (std::find(counts.begin(), counts.end(), (std::uint32_t)entries.size()) != counts.end())
+            continue;
+
+        std::uint32_t offset = 0;
+        for (std::uint32_t &count : counts)
+        {
+            std::uint32_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+        for (const SortEntry &entry : entries)
+            scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+        entries.swap(scratch);
+    }
+}
+
+void RenderQueue::countUnsortedChanges()
+{
+    const Shader *currentShader = nullptr;
+    const Mesh *currentMaterial = nullptr;
+    unsigned int currentVertexArray = 0;
+
+    for (const SortEntry &entry : entries)
+    {
+        const DrawCommand &command = commands[entry.command];
+        if (command.shader != currentShader)
+        {
+            currentShader = command.shader;
+            currentMaterial = nullptr;
+            frameStats.unsortedProgramChanges++;
+        }
+        if (currentMaterial == nullptr || !command.mesh->sharesMaterialWith(*currentMaterial))
+        {
+            currentMaterial = command.mesh;
+            frameStats.unsortedTextureChanges++;
+        }
+        if (command.mesh->vertexArray() != currentVertexArray)
+        {
+            currentVertexArray = command.mesh->vertexArray();
+            frameStats.unsortedVertexArrayChanges++;
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "frustum.h"
+#include "mesh.h"
+#include "model.h"
+#include "shader.h"
+#include "systems/profiler.h"
+
+enum RenderPass
+{
+    PASS_OPAQUE = 0,
+    PASS_CUTOUT = 1,      // alpha-tested; after opaque so soft edges blend over it
+    PASS_TRANSPARENT = 2, // sorted back to front
+};
+
+struct RenderQueueStats
+{
+    unsigned int draws = 0;
+    unsigned int programChanges = 0;
+    unsigned int textureChanges = 0;
+    unsigned int vertexArrayChanges = 0;
+
+    // drawn again by executeDepthOnly(), not counted above
+    unsigned int depthOnlyDraws = 0;
+
+    // the same counts had the draws been issued in submission order
+    unsigned int unsortedProgramChanges = 0;
+    unsigned int unsortedTextureChanges = 0;
+    unsigned int unsortedVertexArrayChanges = 0;
+
+    // rejected by the frustum before they reached the queue
+    unsigned int culledMeshes = 0;
+    unsigned int culledInstances = 0;
+
+    // triangles submitted at the chosen levels of detail, and had every draw used level 0
+    std::uint64_t triangles = 0;
+    std::uint64_t fullDetailTriangles = 0;
+};
+
+// Collects a frame's draws as compact commands, radix-sorts them by a packed 64-bit key
+// and issues them in an order that keeps program, texture and VAO switches to a minimum.
+//
+// Key layout, most significant bits first:
+//   opaque/cutout: pass(2) program(8) material(16) vao(14) depth(24, front to back)
+//   transparent:   pass(2) depth(24, back to front) program(8) material(16) vao(14)
+class RenderQueue
+{
+public:
+    void begin(const glm::vec3 &viewPos, float farPlane, const Frustum &frustum);
+
+    // Meshes and instances outside the frustum are dropped here, before they cost a draw.
+    // lod picks the model's level of detail (see LodSelector).
+    void submit(const Model &model, const Shader &shader, const glm::mat4 &transform,
+                RenderPass pass = PASS_OPAQUE, const glm::vec4 &tint = glm::vec4(1.0f), std::uint8_t lod = 0);
+
+    // Uploads the instances right away; see Model::uploadInstances for the one-batch limit.
+    // Every instance draws at the same level of detail.
+    void submitInstanced(Model &model, const Shader &shader, std::span<const glm::mat4> transforms,
+                         std::span<const glm::vec4> tints = {}, RenderPass pass = PASS_OPAQUE, std::uint8_t lod = 0);
+
+    // With a profiler, each submitting model's draws are timed under its profile zone.
+    // An override shader draws every command in place of the one it was submitted with.
+    void execute(Profiler *profiler = nullptr, const Shader *overrideShader = nullptr);
+    // Draws the opaque and cutout commands with depthShader, in the same order, ahead of
+    // execute() for a depth pre-pass. Material textures are still bound for alpha tests.
+    void executeDepthOnly(const Shader &depthShader, Profiler *profiler = nullptr);
+
+    const RenderQueueStats &stats() const { return frameStats; }
+
+    static std::uint64_t makeKey(RenderPass pass, unsigned int program, std::uint16_t material,
+                                 unsigned int vertexArray, float depth);
+
+private:
+    struct DrawCommand
+    {
+        const Mesh *mesh;
+        const Shader *shader;
+        std::uint32_t drawDataIndex; // per-draw uniforms, unused by instanced draws
+        std::uint32_t instanceCount; // 0 for a plain draw
+        bool useTints;
+        std::uint8_t lod;
+        unsigned int instanceTransforms; // the submitting Model's instance buffers
+        unsigned int instanceTints;
+        ProfileZoneId zone;
+    };
+
+    struct DrawData
+    {
+        glm::mat4 modelMatrix;
+        glm::vec4 tint;
+    };
+
+    struct SortEntry
+    {
+        std::uint64_t key;
+        std::uint32_t command;
+    };
+
+    // all cleared, never shrunk, so a steady scene stops allocating after the first frames
+    std::vector<DrawCommand> commands;
+    std::vector<DrawData> drawData;
+    std::vector<SortEntry> entries;
+    std::vector<SortEntry> scratch;
+    std::vector<glm::mat4> visibleTransforms;
+    std::vector<glm::vec4> visibleTints;
+
+    glm::vec3 viewPos{0.0f};
+    float farPlane = 100.0f;
+    Frustum frustum{};
+    RenderQueueStats frameStats;
+    bool sorted = false;
+
+    float normalizedDepth(const glm::mat4 &transform) const;
+    void sort();
+    void radixSort();
+    void draw(const Shader *overrideShader, bool depthOnly, Profiler *profiler);
+    void countUnsortedChanges();
+};
@@ -0,0 +1,273 @@
+#include "scene_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+    constexpr float OBJECT_SPACING = 3.0f;
+    constexpr unsigned int CAMERA_KEYS = 8;
+
+    struct Shape
+    {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+    };
+
+    // Two triangles over a (columns + 1)-wide grid of vertices starting at first, wound
+    // counter-clockwise when the grid's u runs right and v runs up.
+    void addGrid(Shape &shape, unsigned int first, unsigned int columns, unsigned int rows)
+    {
+        for (unsigned int row = 0; row < rows; row++)
+        {
+            for (unsigned int column = 0; column < columns; column++)
+            {
+                unsigned int a = first + row * (columns + 1) + column;
+                unsigned int b = a + columns + 1;
+                shape.indices.insert(shape.indices.end(), { a, a + 1, b, b, a + 1, b + 1 });
+            }
+        }
+    }
+
+    Shape sphere(unsigned int segments)
+    {
+        Shape shape;
+        unsigned int rings = segments / 2;
+        for (unsigned int ring = 0; ring <= rings; ring++)
+        {
+            float theta = glm::pi<float>() * (1.0f - (float)ring / (float)rings); // from the bottom pole up
+            for (unsigned int segment = 0; segment <= segments; segment++)
+            {
+                float phi = glm::two_pi<float>() * (float)segment / (float)segments;
+                glm::vec3 normal{ std::sin(theta) * std::cos(phi), std::cos(theta), -std::sin(theta) * std::sin(phi) };
+                shape.vertices.push_back({ normal * 0.5f, normal,
+                                           { (float)segment / (float)segments, (float)ring / (float)rings } });
+            }
+        }
+        // the first and last rings sit on the poles, where one triangle of each quad has no area
+        for (unsigned int ring = 0; ring < rings; ring++)
+        {
+            for (unsigned int segment = 0; segment < segments; segment++)
+            {
+                unsigned int a = ring * (segments + 1) + segment;
+                unsigned int b = a + segments + 1;
+                if (ring > 0)
+                    shape.indices.insert(shape.indices.end(), { a, a + 1, b });
+                if (ring < rings - 1)
+                    shape.indices.insert(shape.indices.end(), { b, a + 1, b + 1 });
+            }
+        }
+        return shape;
+    }
+
+    Shape torus(unsigned int segments)
+    {
+        constexpr float MAJOR = 0.35f;
+        constexpr float MINOR = 0.15f;
+        Shape shape;
+        unsigned int sides = std::max(segments / 2, 3u);
+        for (unsigned int side = 0; side <= sides; side++)
+        {
+            float v = glm::two_pi<float>() * (float)side / (float)sides;
+            for (unsigned int segment = 0; segment <= segments; segment++)
+            {
+                float u = glm::two_pi<float>() * (float)segment / (float)segments;
+                glm::vec3 normal{ std::cos(v) * std::cos(u), std::sin(v), -std::cos(v) * std::sin(u) };
+                glm::vec3 ring{ std::cos(u), 0.0f, -std::sin(u) };
+                shape.vertices.push_back({ ring * MAJOR + normal * MINOR, normal,
+                                           { (float)segment / (float)segments, (float)side / (float)sides } });
+            }
+        }
+        addGrid(shape, 0, segments, sides);
+        return shape;
+    }
+
+    Shape cylinder(unsigned int segments)
+    {
+        constexpr float RADIUS = 0.4f;
+        Shape shape;
+        for (unsigned int row = 0; row <= 1; row++)
+        {
+            for (unsigned int segment = 0; segment <= segments; segment++)
+            {
+                float phi = glm::two_pi<float>() * (float)segment / (float)segments;
+                glm::vec3 normal{ std::cos(phi), 0.0f, -std::sin(phi) };
+                shape.vertices.push_back({ normal * RADIUS + glm::vec3(0.0f, (float)row - 0.5f, 0.0f), normal,
+                                           { (float)segment / (float)segments, (float)row } });
+            }
+        }
+        addGrid(shape, 0, segments, 1);
+
+        // flat caps, fanned around a centre vertex
+        for (float y : { -0.5f, 0.5f })
+        {
+            auto centre = (unsigned int)shape.vertices.size();
+            glm::vec3 normal{ 0.0f, y > 0.0f ? 1.0f : -1.0f, 0.0f };
+            shape.vertices.push_back({ { 0.0f, y, 0.0f }, normal, { 0.5f, 0.5f } });
+            for (unsigned int segment = 0; segment < segments; segment++)
+            {
+                float phi = glm::two_pi<float>() * (float)segment / (float)segments;
+                glm::vec2 direction{ std::cos(phi), -std::sin(phi) };
+                shape.vertices.push_back({ { direction.x * RADIUS, y, direction.y * RADIUS }, normal,
+                                           direction * 0.5f + 0.5f });
+            }
+            for (unsigned int segment = 0; segment < segments; segment++)
+            {
+                unsigned int current = centre + 1 + segment;
+                unsigned int next = centre + 1 + (segment + 1) % segments;
+                if (y > 0.0f)
+                    shape.indices.insert(shape.indices.end(), { centre, current, next });
+                else
+                    shape.indices.insert(shape.indices.end(), { centre, next, current });
+            }
+        }
+        return shape;
+    }
+
+    // Shapes cycle sphere, torus, cylinder, getting finer every third mesh.
+    Shape makeShape(unsigned int index)
+    {
+        unsigned int segments = 12 + 12 * (index / 3 % 4);
+        switch (index % 3)
+        {
+            case 0: return sphere(segments);
+            case 1: return torus(segments * 2);
+            default: return cylinder(segments * 2);
+        }
+    }
+
+    std::uint32_t hash(std::uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    glm::vec3 hueToRgb(float hue)
+    {
+        return glm::clamp(glm::abs(glm::mod(hue * 6.0f + glm::vec3(0.0f, 4.0f, 2.0f), 6.0f) - 3.0f) - 1.0f, 0.0f, 1.0f);
+    }
+
+    // Pixels freed with std::free, which fits TextureImage's deleter type.
+    TextureImage allocateImage(unsigned int size, GLenum format, int channels)
+    {
+        TextureImage image;
+        image.width = (int)size;
+        image.height = (int)size;
+        image.format = format;
+        image.pixels = { (unsigned char *)std::malloc((std::size_t)size * size * channels), std::free };
+        return image;
+    }
+
+    // A checkerboard in two shades of the texture's own hue, with per-texel grain.
+    TextureImage diffuseImage(unsigned int index, unsigned int size)
+    {
+        TextureImage image = allocateImage(size, GL_RGB, 3);
+        glm::vec3 base = hueToRgb(std::fmod((float)index * 0.618034f, 1.0f));
+        unsigned int cell = std::max(size / 8, 1u);
+        unsigned char *pixel = image.pixels.get();
+        for (unsigned int y = 0; y < size; y++)
+        {
+            for (unsigned int x = 0; x < size; x++)
+            {
+                bool dark = ((x / cell) + (y / cell)) % 2 != 0;
+                float grain = (float)(hash(index * 0x9e3779b9u ^ (y * size + x)) & 0xFF) / 255.0f;
+                glm::vec3 color = base * (dark ? 0.45f : 0.9f) + glm::vec3(grain * 0.1f);
+                for (int channel = 0; channel < 3; channel++)
+                    *pixel++ = (unsigned char)(glm::clamp(color[channel], 0.0f, 1.0f) * 255.0f);
+            }
+        }
+        return image;
+    }
+
+    TextureImage specularImage(unsigned int index, unsigned int size)
+    {
+        TextureImage image = allocateImage(size, GL_RED, 1);
+        unsigned int stripe = std::max(size / (4 + index % 5), 1u);
+        unsigned char *pixel = image.pixels.get();
+        for (unsigned int y = 0; y < size; y++)
+        {
+            for (unsigned int x = 0; x < size; x++)
+                *pixel++ = (x + y) / stripe % 2 == 0 ? 200 : 40;
+        }
+        return image;
+    }
+}
+
+GeneratedScene generateScene(const SceneSettings &settings)
+{
+    GeneratedScene scene;
+    std::mt19937 random(settings.seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    unsigned int meshCount = std::max(settings.meshes, 1u);
+    unsigned int textureCount = std::max(settings.textures, 1u);
+    unsigned int modelCount = std::max(meshCount, textureCount);
+    std::vector<Shape> shapes;
+    shapes.reserve(meshCount);
+    for (unsigned int i = 0; i < meshCount; i++)
+        shapes.push_back(makeShape(i));
+
+    scene.models.reserve(modelCount);
+    for (unsigned int i = 0; i < modelCount; i++)
+    {
+        ModelData &model = scene.models.emplace_back();
+        model.path = "generated/model" + std::to_string(i);
+
+        unsigned int texture = i % textureCount;
+        std::string diffusePath = "generated/texture" + std::to_string(texture) + "_diffuse";
+        std::string specularPath = "generated/texture" + std::to_string(texture) + "_specular";
+        model.images.emplace(diffusePath, diffuseImage(texture, settings.textureSize));
+        model.images.emplace(specularPath, specularImage(texture, settings.textureSize));
+
+        const Shape &shape = shapes[i % meshCount];
+        model.addMesh(shape.vertices, shape.indices,
+                      { { "texture_diffuse", diffusePath }, { "texture_specular", specularPath } }, false);
+    }
+
+    scene.extent = OBJECT_SPACING * std::sqrt((float)settings.objects) * 0.5f;
+    scene.objects.reserve(settings.objects);
+    for (unsigned int i = 0; i < settings.objects; i++)
+    {
+        glm::vec3 position{ (unit(random) * 2.0f - 1.0f) * scene.extent, unit(random) * 2.0f,
+                            (unit(random) * 2.0f - 1.0f) * scene.extent };
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+        transform = glm::rotate(transform, unit(random) * glm::two_pi<float>(), glm::vec3(0.0f, 1.0f, 0.0f));
+        transform = glm::rotate(transform, (unit(random) - 0.5f) * 0.5f, glm::vec3(1.0f, 0.0f, 0.0f));
+        transform = glm::scale(transform, glm::vec3(0.5f + unit(random)));
+        scene.objects.push_back({ i % modelCount, transform });
+    }
+
+    scene.lights.reserve(settings.lights);
+    for (unsigned int i = 0; i < settings.lights; i++)
+    {
+        glm::vec3 position{ (unit(random) * 2.0f - 1.0f) * scene.extent, 1.0f + unit(random) * 3.0f,
+                            (unit(random) * 2.0f - 1.0f) * scene.extent };
+        glm::vec3 color = glm::mix(glm::vec3(1.0f), hueToRgb(unit(random)), 0.7f);
+        scene.lights.push_back({ position, color, 2.5f + 2.5f * unit(random) });
+    }
+
+    // even keys look down on the whole field from outside it, odd keys skim through it
+    std::vector<CameraPath::Key> keys;
+    float overview = std::max(scene.extent * 1.3f, 6.0f);
+    for (unsigned int i = 0; i < CAMERA_KEYS; i++)
+    {
+        float angle = glm::two_pi<float>() * (float)i / (float)CAMERA_KEYS;
+        glm::vec3 around{ std::cos(angle), 0.0f, std::sin(angle) };
+        if (i % 2 == 0)
+            keys.push_back({ around * overview + glm::vec3(0.0f, overview * 0.5f, 0.0f), glm::vec3(0.0f) });
+        else
+            keys.push_back({ around * scene.extent * 0.4f + glm::vec3(0.0f, 1.5f, 0.0f),
+                             -around * scene.extent + glm::vec3(0.0f, 1.0f, 0.0f) });
+    }
+    scene.cameraPath = CameraPath(std::move(keys));
+    return scene;
+}
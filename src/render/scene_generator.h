@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "camera_path.h"
+#include "model.h"
+
+// Size of a synthetic stress scene. Each count scales on its own, so a run can isolate
+// draw submission, vertex work, light cost or texture memory.
+struct SceneSettings
+{
+    unsigned int objects = 2000;    // placed copies, spread over a square that grows with the count
+    unsigned int meshes = 16;       // distinct generated shapes, from about a hundred to ten thousand triangles
+    unsigned int lights = 8;        // point lights, clustered on top of the application's movable one
+    unsigned int textures = 8;      // distinct diffuse maps, each with a specular map
+    unsigned int textureSize = 256; // texels per side
+    std::uint32_t seed = 1;
+};
+
+struct SceneLight
+{
+    glm::vec3 position;
+    glm::vec3 color;
+    float radius; // reaches nothing beyond it
+};
+
+struct SceneObjectPlacement
+{
+    std::uint32_t model; // index into GeneratedScene::models
+    glm::mat4 transform;
+};
+
+// Built without GL calls; hand each ModelData to the Model constructor on the GL thread.
+// There is one model per pairing of shape i % meshes with texture i % textures, so
+// max(meshes, textures) in all, and the objects cycle through them.
+struct GeneratedScene
+{
+    std::vector<ModelData> models;
+    std::vector<SceneObjectPlacement> objects;
+    std::vector<SceneLight> lights;
+    CameraPath cameraPath; // a loop alternating overviews with low passes through the objects
+    float extent = 0.0f;   // half the side of the square the objects cover
+};
+
+// The same settings always produce the same scene.
+GeneratedScene generateScene(const SceneSettings &settings);
@@ -1,122 +1,354 @@
-#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <string>
 
 #include "shader.h"
+#include "program_cache.h"
+#include "shader_preprocessor.h"
+#include "uniform_blocks.h"
 #include <glad/glad.h>
 #include <iostream>
 
 #include <glm/fwd.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath)
+Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath, std::span<const std::string> defines)
 {
-    const std::string vertexShaderSource = _readFromFile(vertexPath);
-    const std::string fragmentShaderSource = _readFromFile(fragmentPath);
+    auto submitBegin = std::chrono::steady_clock::now();
+    static unsigned int nextSortIndex = 0;
+    sortIndex = nextSortIndex++;
 
-    unsigned int vertexShader =
-        _compileShader(vertexShaderSource.c_str(), GL_VERTEX_SHADER);
-    unsigned int fragmentShader =
-        _compileShader(fragmentShaderSource.c_str(), GL_FRAGMENT_SHADER);
+    PreprocessedShader vertexShader = preprocessShader(vertexPath, defines);
+    PreprocessedShader fragmentShader = preprocessShader(fragmentPath, defines);
 
-    ID = glCreateProgram();
-    _linkShaderToProgram(vertexShader, ID, GL_VERTEX_SHADER);
-    _linkShaderToProgram(fragmentShader, ID, GL_FRAGMENT_SHADER);
+    program = GLProgram::create();
+    // a stage whose includes did not resolve is neither looked up nor compiled; the program stays unlinked
+    if (!vertexShader.ok)
+        std::cout << "ERROR::SHADER::PREPROCESS_FAILED " << vertexPath << std::endl;
+    if (!fragmentShader.ok)
+        std::cout << "ERROR::SHADER::PREPROCESS_FAILED " << fragmentPath << std::endl;
+    if (!vertexShader.ok || !fragmentShader.ok)
+    {
+        linkPending = false;
+        return;
+    }
+
+    // the defines are part of the sources by now, so each variant gets its own cache entry
+    std::string_view sources[] = { vertexShader.source, fragmentShader.source };
+    cacheKey = ProgramCache::key(sources);
+    loadedFromCache = ProgramCache::load(program.get(), cacheKey);
+    if (!loadedFromCache)
+    {
+        stages.push_back({ _compileShader(vertexShader.source.c_str(), GL_VERTEX_SHADER), std::move(vertexShader.files) });
+        stages.push_back({ _compileShader(fragmentShader.source.c_str(), GL_FRAGMENT_SHADER),
+                           std::move(fragmentShader.files) });
+        for (const Stage &stage : stages)
+            glAttachShader(program.get(), stage.object.get());
+        if (ProgramCache::supported())
+            glProgramParameteri(program.get(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program.get());
+    }
+
+    stats.programs++;
+    (loadedFromCache ? stats.cacheHits : stats.cacheMisses)++;
+    std::chrono::duration<double, std::milli> submitTime = std::chrono::steady_clock::now() - submitBegin;
+    stats.submitMilliseconds += submitTime.count();
+}
+
+void Shader::detectCompileSupport()
+{
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    bool khr = false, arb = false;
+    for (GLint i = 0; i < extensionCount; i++)
+    {
+        const auto *name = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0)
+            khr = true;
+        else if (std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0)
+            arb = true;
+    }
 
-    glLinkProgram(ID);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // as many compiler threads as the driver sees fit
+    if (khr)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    else if (arb)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    parallelCompileSupported = khr || arb;
+
+    ProgramCache::detectSupport();
 }
 
 void Shader::use() const
 {
-    glUseProgram(ID);
+    if (linkPending)
+        _awaitLink();
+    GLState::useProgram(program.get());
 }
 
-void Shader::setBool(const std::string &name, bool value) const
+bool Shader::ready() const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    if (!linkPending || !parallelCompileSupported)
+        return true;
+    int complete = 0;
+    glGetProgramiv(program.get(), GL_COMPLETION_STATUS_KHR, &complete);
+    return complete != 0;
 }
 
-void Shader::setInt(const std::string &name, int value) const
+void Shader::_awaitLink() const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    linkPending = false;
+    auto waitBegin = std::chrono::steady_clock::now();
+
+    bool compiled = true;
+    for (const Stage &stage : stages)
+        compiled = _checkCompiled(stage) && compiled;
+
+    int success;
+    glGetProgramiv(program.get(), GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        constexpr unsigned int INFO_LOG_SIZE = 512;
+        char infoLog[INFO_LOG_SIZE];
+        glGetProgramInfoLog(program.get(), INFO_LOG_SIZE, nullptr, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+    else if (!loadedFromCache && compiled)
+        ProgramCache::store(program.get(), cacheKey);
+    // the shader objects are freed here; the program keeps what it linked
+    stages.clear();
+
+    std::chrono::duration<double, std::milli> waitTime = std::chrono::steady_clock::now() - waitBegin;
+    stats.waitMilliseconds += waitTime.count();
+
+    _reflectUniforms();
+    _bindUniformBlocks();
 }
 
-void Shader::setFloat(const std::string &name, float value) const
+void Shader::set(Uniform<bool> uniform, bool value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(uniform.location, (int)value);
 }
 
-void Shader::setMat4(const std::string &name, glm::mat4 value, int count, int transpose) const
+void Shader::set(Uniform<int> uniform, int value) const
 {
-    unsigned int modelLoc = glGetUniformLocation(ID, name.c_str());
-    glUniformMatrix4fv((int)modelLoc, count, transpose, glm::value_ptr(value));
+    glUniform1i(uniform.location, value);
 }
 
-void Shader::setVec3(const std::string &name, glm::vec3 value) const
+void Shader::set(Uniform<float> uniform, float value) const
 {
-    setVec3(name, value.x, value.y, value.z);
+    glUniform1f(uniform.location, value);
 }
 
-void Shader::setVec3(const std::string &name, float x, float y, float z) const
+void Shader::set(Uniform<glm::vec3> uniform, const glm::vec3 &value) const
 {
-    unsigned int modelLoc = glGetUniformLocation(ID, name.c_str());
-    glUniform3f((int)modelLoc, x, y, z);
+    glUniform3f(uniform.location, value.x, value.y, value.z);
 }
 
-std::string Shader::_readFromFile(const std::string& filename)
+void Shader::set(Uniform<glm::vec4> uniform, const glm::vec4 &value) const
 {
-    std::string result;
+    glUniform4f(uniform.location, value.x, value.y, value.z, value.w);
+}
 
-    std::ifstream myFile(filename.c_str());
+void Shader::set(Uniform<glm::mat4> uniform, const glm::mat4 &value) const
+{
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setBool(const char *name, bool value) const
+{
+    set(uniform<bool>(name), value);
+}
 
-    if (myFile.is_open())
+void Shader::setInt(const char *name, int value) const
+{
+    set(uniform<int>(name), value);
+}
+
+void Shader::setFloat(const char *name, float value) const
+{
+    set(uniform<float>(name), value);
+}
+
+void Shader::setMat4(const char *name, const glm::mat4 &value, int count, int transpose) const
+{
+    glUniformMatrix4fv(uniform<glm::mat4>(name).location, count, transpose, glm::value_ptr(value));
+}
+
+void Shader::setVec3(const char *name, glm::vec3 value) const
+{
+    set(uniform<glm::vec3>(name), value);
+}
+
+void Shader::setVec3(const char *name, float x, float y, float z) const
+{
+    set(uniform<glm::vec3>(name), glm::vec3(x, y, z));
+}
+
+void Shader::setSampler(const char *name, int unit) const
+{
+    if (const UniformInfo *info = _find(name))
+        glUniform1i(info->location, unit);
+}
+
+void Shader::_reflectUniforms() const
+{
+    int count = 0, maxNameLength = 0;
+    glGetProgramiv(program.get(), GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program.get(), GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::string name(maxNameLength, '\0');
+    for (int i = 0; i < count; i++)
     {
-        std::string line;
-        while (std::getline(myFile, line))
+        int length = 0, size = 0;
+        unsigned int type = 0;
+        glGetActiveUniform(program.get(), i, maxNameLength, &length, &size, &type, name.data());
+        std::string uniformName = name.substr(0, length);
+        int location = glGetUniformLocation(program.get(), uniformName.c_str());
+        if (location < 0)
+            continue; // members of uniform blocks have no location
+
+        // plain arrays are reported as "name[0]"; register the bare name and every element
+        if (uniformName.ends_with("[0]"))
         {
-            result += line + '\n';
+            std::string base = uniformName.substr(0, uniformName.size() - 3);
+            uniforms.push_back({ base, location, type });
+            for (int element = 1; element < size; element++)
+            {
+                std::string elementName = base + '[' + std::to_string(element) + ']';
+                uniforms.push_back({ elementName, glGetUniformLocation(program.get(), elementName.c_str()), type });
+            }
         }
-        myFile.close();
+        uniforms.push_back({ std::move(uniformName), location, type });
+    }
+
+    std::sort(uniforms.begin(), uniforms.end(),
+              [](const UniformInfo &a, const UniformInfo &b) { return a.name < b.name; });
+
+    if (const UniformInfo *info = _find("instanced"))
+        builtinUniforms.instanced.location = info->location;
+    if (const UniformInfo *info = _find("modelMatrix"))
+        builtinUniforms.modelMatrix.location = info->location;
+    if (const UniformInfo *info = _find("tint"))
+    {
+        builtinUniforms.tint.location = info->location;
+        GLState::useProgram(program.get());
+        glUniform4f(info->location, 1.0f, 1.0f, 1.0f, 1.0f);
+    }
+    if (const UniformInfo *info = _find("positionScale"))
+    {
+        builtinUniforms.positionScale.location = info->location;
+        GLState::useProgram(program.get());
+        glUniform3f(info->location, 1.0f, 1.0f, 1.0f);
+    }
+    if (const UniformInfo *info = _find("positionOffset"))
+        builtinUniforms.positionOffset.location = info->location;
+    for (unsigned int i = 0; i < MATERIAL_SAMPLERS; i++)
+    {
+        if (const UniformInfo *info = _find(("texture_diffuse" + std::to_string(i)).c_str()))
+            builtinUniforms.diffuseSamplers[i].location = info->location;
+        if (const UniformInfo *info = _find(("texture_specular" + std::to_string(i)).c_str()))
+            builtinUniforms.specularSamplers[i].location = info->location;
     }
-    return result;
 }
 
-unsigned int Shader::_compileShader(const char* shaderSource,
-                                    int shaderType)
+void Shader::_bindUniformBlocks() const
 {
-    unsigned int shader = glCreateShader(shaderType);
-    glShaderSource(shader, 1, &shaderSource, nullptr);
-    glCompileShader(shader);
+    int count = 0;
+    glGetProgramiv(program.get(), GL_ACTIVE_UNIFORM_BLOCKS, &count);
 
-    constexpr unsigned int INFO_LOG_SIZE = 512;
-    int success;
-    char infoLog[INFO_LOG_SIZE];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    constexpr unsigned int NAME_SIZE = 64;
+    char name[NAME_SIZE];
+    for (int i = 0; i < count; i++)
+    {
+        glGetActiveUniformBlockName(program.get(), i, NAME_SIZE, nullptr, name);
+        auto it = std::find_if(UNIFORM_BLOCK_BINDINGS.begin(), UNIFORM_BLOCK_BINDINGS.end(),
+                               [&](const auto &entry) { return entry.first == name; });
+        if (it == UNIFORM_BLOCK_BINDINGS.end())
+        {
+            std::cout << "WARNING::SHADER::" << program.get() << "::UNKNOWN_UNIFORM_BLOCK " << name << std::endl;
+            continue;
+        }
+        glUniformBlockBinding(program.get(), i, it->second);
+    }
+}
 
-    if (!success)
+const Shader::UniformInfo *Shader::_find(const char *name) const
+{
+    if (linkPending)
+        _awaitLink();
+    auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name,
+                               [](const UniformInfo &info, const char *key) { return std::strcmp(info.name.c_str(), key) < 0; });
+    if (it == uniforms.end() || std::strcmp(it->name.c_str(), name) != 0)
+        return nullptr;
+    return &*it;
+}
+
+int Shader::_resolve(const char *name, unsigned int expectedType) const
+{
+    const UniformInfo *info = _find(name);
+    if (info != nullptr && _typeMatches(expectedType, info->type))
+        return info->location;
+
+    if (std::find(reportedMissing.begin(), reportedMissing.end(), name) == reportedMissing.end())
     {
-        glGetShaderInfoLog(shader, INFO_LOG_SIZE, nullptr, infoLog);
-        std::cout << "ERROR::SHADER::" << std::to_string(shaderType)
-            << "::COMPILATION_FAILED\n"
-            << infoLog << std::endl;
+        reportedMissing.emplace_back(name);
+        std::cout << "WARNING::SHADER::" << program.get()
+            << (info ? "::UNIFORM_TYPE_MISMATCH " : "::UNIFORM_NOT_FOUND ") << name << std::endl;
     }
+    return -1;
+}
+
+bool Shader::_typeMatches(unsigned int expectedType, unsigned int actualType)
+{
+    if (expectedType == actualType)
+        return true;
+
+    // glUniform1i drives bools and samplers as well as ints
+    if (expectedType == GL_INT || expectedType == GL_BOOL)
+    {
+        switch (actualType)
+        {
+            case GL_INT:
+            case GL_BOOL:
+            case GL_SAMPLER_2D:
+            case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_2D_ARRAY:
+                return true;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+GLShaderObject Shader::_compileShader(const char* shaderSource,
+                                      int shaderType)
+{
+    // the status is read by _awaitLink, so the driver can keep compiling in the meantime
+    GLShaderObject shader(glCreateShader(shaderType));
+    glShaderSource(shader.get(), 1, &shaderSource, nullptr);
+    glCompileShader(shader.get());
     return shader;
 }
 
-void Shader::_linkShaderToProgram(unsigned int shader, unsigned int program, int shaderType)
+bool Shader::_checkCompiled(const Stage &stage)
 {
     constexpr unsigned int INFO_LOG_SIZE = 512;
-    int success;
+    int success, shaderType;
     char infoLog[INFO_LOG_SIZE];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-
-    glAttachShader(program, shader);
+    glGetShaderiv(stage.object.get(), GL_COMPILE_STATUS, &success);
     if (!success)
     {
-        glGetShaderInfoLog(shader, INFO_LOG_SIZE, nullptr, infoLog);
+        glGetShaderiv(stage.object.get(), GL_SHADER_TYPE, &shaderType);
+        glGetShaderInfoLog(stage.object.get(), INFO_LOG_SIZE, nullptr, infoLog);
         std::cout << "ERROR::SHADER::" << std::to_string(shaderType)
-            << "::ATTACH_FAILED\n"
-            << infoLog << std::endl;
+            << "::COMPILATION_FAILED\n"
+            << infoLog;
+        for (std::size_t i = 0; i < stage.files.size(); i++)
+            std::cout << "  source " << i << ": " << stage.files[i] << "\n";
+        std::cout << std::endl;
     }
+    return success != 0;
 }
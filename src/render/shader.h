@@ -1,26 +1,158 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <span>
 #include <string>
+#include <vector>
 
 #include <glm/fwd.hpp>
 
+#include "gl_handle.h"
+
+// A uniform location resolved once against a linked program. The type picks the
+// matching glUniform* overload in Shader::set, so per-frame updates skip the name lookup.
+template <typename T>
+struct Uniform
+{
+    int location = -1;
+
+    bool valid() const { return location >= 0; }
+};
+
+template <typename T> struct UniformGLType;
+template <> struct UniformGLType<bool> { static constexpr unsigned int value = GL_BOOL; };
+template <> struct UniformGLType<int> { static constexpr unsigned int value = GL_INT; };
+template <> struct UniformGLType<float> { static constexpr unsigned int value = GL_FLOAT; };
+template <> struct UniformGLType<glm::vec3> { static constexpr unsigned int value = GL_FLOAT_VEC3; };
+template <> struct UniformGLType<glm::vec4> { static constexpr unsigned int value = GL_FLOAT_VEC4; };
+template <> struct UniformGLType<glm::mat4> { static constexpr unsigned int value = GL_FLOAT_MAT4; };
+
+// Program build counters since startup; see Shader's constructor for what each phase covers.
+struct ShaderCompileStats
+{
+    unsigned int programs = 0;
+    unsigned int cacheHits = 0;   // loaded from the program binary cache
+    unsigned int cacheMisses = 0; // compiled from source; stored for next time when binaries are supported
+    double submitMilliseconds = 0.0; // reading sources and issuing compile and link
+    double waitMilliseconds = 0.0;   // blocked on the driver when a program was first needed
+};
+
+// Sources go through preprocessShader, so they may #include shared files and test the
+// given defines (see ShaderVariants). Construction only submits the work: a cached binary is handed to the driver, or both
+// stages are compiled and linked without asking for the result. Link status, reflection and
+// uniform block bindings are resolved on first use, so constructing several shaders back to
+// back lets a driver with parallel compilation build them all at once.
 class Shader
 {
 public:
-    unsigned int ID;
+    Shader(const std::string& vertexPath, const std::string &fragmentPath, std::span<const std::string> defines = {});
+
+    // Turns on the driver's parallel compiler threads and the program binary cache where
+    // available. Call once with a current context, before the first shader is built.
+    static void detectCompileSupport();
+    static const ShaderCompileStats &compileStats() { return stats; }
+
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+    Shader(Shader &&) noexcept = default;
+    Shader &operator=(Shader &&) noexcept = default;
 
-    Shader(const std::string& vertexPath, const std::string &fragmentPath);
+    // "texture_diffuse0".. and "texture_specular0".. slots resolved into Builtins
+    static constexpr unsigned int MATERIAL_SAMPLERS = 4;
+
+    // Uniforms the engine's draw helpers drive themselves; resolved quietly at link time,
+    // so they stay invalid (and setting them is a no-op) in programs that lack them.
+    struct Builtins
+    {
+        Uniform<bool> instanced;
+        Uniform<glm::mat4> modelMatrix;
+        Uniform<glm::vec4> tint; // initialised to white at link time
+        // dequantize 16-bit positions (see QuantizedVertex); identity at link time
+        Uniform<glm::vec3> positionScale;
+        Uniform<glm::vec3> positionOffset;
+        // material textures, bound by Mesh::bindTextures
+        std::array<Uniform<int>, MATERIAL_SAMPLERS> diffuseSamplers;
+        std::array<Uniform<int>, MATERIAL_SAMPLERS> specularSamplers;
+    };
+
+    unsigned int id() const { return program.get(); }
+    unsigned int sortId() const { return sortIndex; } // small per-program index for render queue keys
+    const Builtins &builtins() const
+    {
+        if (linkPending)
+            _awaitLink();
+        return builtinUniforms;
+    }
     void use() const;
 
-    void setBool(const std::string &name, bool value) const;
-    void setInt(const std::string &name, int value) const;
-    void setFloat(const std::string &name, float value) const;
-    void setVec3(const std::string &name, glm::vec3 value) const;
-    void setVec3(const std::string &name, float x, float y, float z) const;
-    void setMat4(const std::string &name, glm::mat4 value, int count, int transpose) const;
+    // False while the driver is still compiling; checking never blocks. Without parallel
+    // compilation every program reports ready, and the first use just waits for it.
+    bool ready() const;
+    bool fromCache() const { return loadedFromCache; }
+
+    // Resolves a typed handle; unknown names and type mismatches are reported here, once.
+    template <typename T>
+    Uniform<T> uniform(const char *name) const
+    {
+        return Uniform<T>{ _resolve(name, UniformGLType<T>::value) };
+    }
+
+    void set(Uniform<bool> uniform, bool value) const;
+    void set(Uniform<int> uniform, int value) const;
+    void set(Uniform<float> uniform, float value) const;
+    void set(Uniform<glm::vec3> uniform, const glm::vec3 &value) const;
+    void set(Uniform<glm::vec4> uniform, const glm::vec4 &value) const;
+    void set(Uniform<glm::mat4> uniform, const glm::mat4 &value) const;
+
+    // Name-based setters go through the reflected table (no driver round-trip);
+    // prefer handles on hot paths.
+    void setBool(const char *name, bool value) const;
+    void setInt(const char *name, int value) const;
+    void setFloat(const char *name, float value) const;
+    void setVec3(const char *name, glm::vec3 value) const;
+    void setVec3(const char *name, float x, float y, float z) const;
+    void setMat4(const char *name, const glm::mat4 &value, int count, int transpose) const;
+
+    // Samplers are optional per program (e.g. the light source shader has none), so a
+    // missing sampler is skipped silently instead of being reported.
+    void setSampler(const char *name, int unit) const;
 
 private:
-    static std::string _readFromFile(const std::string &filename);
-    static unsigned int _compileShader(const char *shaderSource, int shaderType);
-    static void _linkShaderToProgram(unsigned int shader, unsigned int program, int shaderType);
+    struct UniformInfo
+    {
+        std::string name;
+        int location;
+        unsigned int type;
+    };
+
+    GLProgram program;
+    unsigned int sortIndex = 0;
+    std::uint64_t cacheKey = 0;
+    bool loadedFromCache = false;
+    mutable std::vector<std::string> reportedMissing;
+
+    // resolved by the first use after the link, see _awaitLink
+    mutable bool linkPending = true;
+    struct Stage
+    {
+        GLShaderObject object;
+        std::vector<std::string> files; // what the source string numbers in its log refer to
+    };
+    mutable std::vector<Stage> stages; // kept until then for their compile logs
+    mutable std::vector<UniformInfo> uniforms;  // active uniforms, sorted by name
+    mutable Builtins builtinUniforms;
+
+    static inline bool parallelCompileSupported = false;
+    static inline ShaderCompileStats stats;
+
+    void _awaitLink() const;
+    void _reflectUniforms() const;
+    void _bindUniformBlocks() const;
+    const UniformInfo *_find(const char *name) const;
+    int _resolve(const char *name, unsigned int expectedType) const;
+
+    static bool _typeMatches(unsigned int expectedType, unsigned int actualType);
+    static GLShaderObject _compileShader(const char *shaderSource, int shaderType);
+    static bool _checkCompiled(const Stage &stage);
 };
@@ -0,0 +1,118 @@
+#include "shader_preprocessor.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+#include "uniform_blocks.h"
+
+namespace
+{
+    constexpr int MAX_INCLUDE_DEPTH = 16;
+
+    bool readFile(const std::string &path, std::string &contents)
+    {
+        // one read of the whole file rather than line by line
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return false;
+        contents.assign((std::size_t)file.tellg(), '\0');
+        file.seekg(0);
+        file.read(contents.data(), (std::streamsize)contents.size());
+        return (bool)file;
+    }
+
+    std::string_view trimLeft(std::string_view text)
+    {
+        std::size_t start = text.find_first_not_of(" \t");
+        return start == std::string_view::npos ? std::string_view{} : text.substr(start);
+    }
+
+    // The quoted path of an `#include "path"` line, or empty for any other line.
+    std::string_view includePath(std::string_view line)
+    {
+        line = trimLeft(line);
+        if (!line.starts_with('#'))
+            return {};
+        line = trimLeft(line.substr(1));
+        if (!line.starts_with("include"))
+            return {};
+        line = trimLeft(line.substr(7));
+        std::size_t close = line.find('"', 1);
+        if (!line.starts_with('"') || close == std::string_view::npos)
+            return {};
+        return line.substr(1, close - 1);
+    }
+
+    class Expander
+    {
+    public:
+        explicit Expander(PreprocessedShader &result) : result(result) {}
+
+        bool expand(const std::string &path, std::span<const std::string> defines, int depth)
+        {
+            std::string contents;
+            if (!readFile(path, contents))
+            {
+                std::cout << "ERROR::SHADER::FILE_NOT_FOUND " << path << std::endl;
+                return false;
+            }
+            auto fileIndex = (int)result.files.size();
+            result.files.push_back(path);
+            std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+            int lineNumber = 0;
+            std::string_view rest = contents;
+            while (!rest.empty())
+            {
+                std::size_t end = rest.find('\n');
+                std::string_view line = rest.substr(0, end);
+                rest = end == std::string_view::npos ? std::string_view{} : rest.substr(end + 1);
+                lineNumber++;
+
+                std::string_view include = includePath(line);
+                if (!include.empty())
+                {
+                    std::string includedPath = (directory / include).lexically_normal().generic_string();
+                    if (std::find(result.files.begin(), result.files.end(), includedPath) != result.files.end())
+                        continue; // already in this stage
+                    if (depth == MAX_INCLUDE_DEPTH)
+                    {
+                        std::cout << "ERROR::SHADER::INCLUDE_TOO_DEEP " << path << ":" << lineNumber << std::endl;
+                        return false;
+                    }
+                    result.source += "#line 1 " + std::to_string(result.files.size()) + "\n";
+                    if (!expand(includedPath, {}, depth + 1))
+                        return false;
+                    result.source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+                    continue;
+                }
+
+                result.source += line;
+                result.source += '\n';
+                if (depth == 0 && trimLeft(line).starts_with("#version"))
+                {
+                    result.source += "#define MAX_POINT_LIGHTS " + std::to_string(MAX_POINT_LIGHTS) + "\n";
+                    result.source += "#define SHADOW_CASCADES " + std::to_string(SHADOW_CASCADES) + "\n";
+                    for (const std::string &define : defines)
+                        result.source += "#define " + define + "\n";
+                    result.source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+                }
+            }
+            return true;
+        }
+
+    private:
+        PreprocessedShader &result;
+    };
+}
+
+PreprocessedShader preprocessShader(const std::string &path, std::span<const std::string> defines)
+{
+    PreprocessedShader result;
+    std::string rootPath = std::filesystem::path(path).lexically_normal().generic_string();
+    result.ok = Expander(result).expand(rootPath, defines, 0);
+    return result;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+
+struct PreprocessedShader
+{
+    std::string source;
+    // every file that went into the source; "0(12)" in a driver log is line 12 of files[0]
+    std::vector<std::string> files;
+    bool ok = false;
+};
+
+// Expands `#include "path"` lines (relative to the including file, each file once per
+// stage) and adds `#define` lines right after `#version`: first the engine constants every
+// stage may size its blocks with (MAX_POINT_LIGHTS, SHADOW_CASCADES), then `defines`, each either a bare
+// name or "NAME value". #line directives keep driver messages pointing at the right file.
+PreprocessedShader preprocessShader(const std::string &path, std::span<const std::string> defines = {});
@@ -0,0 +1,49 @@
+#include "shader_variants.h"
+
+#include <iostream>
+
+ShaderVariants::ShaderVariants(std::string vertexPath, std::string fragmentPath,
+                               std::span<const std::string_view> features)
+    : vertexPath(std::move(vertexPath)), fragmentPath(std::move(fragmentPath))
+{
+    if (features.size() > MAX_FEATURES)
+    {
+        std::cout << "ERROR::SHADER_VARIANTS::TOO_MANY_FEATURES " << features.size() << ", keeping " << MAX_FEATURES
+            << std::endl;
+        features = features.first(MAX_FEATURES);
+    }
+    featureNames.assign(features.begin(), features.end());
+    variants.resize(std::size_t{1} << featureNames.size());
+}
+
+Shader &ShaderVariants::get(std::uint32_t features)
+{
+    features &= allFeatures();
+    std::optional<Shader> &variant = variants[features];
+    if (!variant)
+    {
+        std::vector<std::string> defines;
+        for (std::size_t i = 0; i < featureNames.size(); i++)
+        {
+            if (features & (1u << i))
+                defines.push_back(featureNames[i]);
+        }
+        variant.emplace(vertexPath, fragmentPath, defines);
+        builtVariants++;
+    }
+    return *variant;
+}
+
+std::string ShaderVariants::describe(std::uint32_t features) const
+{
+    std::string description;
+    for (std::size_t i = 0; i < featureNames.size(); i++)
+    {
+        if (!(features & (1u << i)))
+            continue;
+        if (!description.empty())
+            description += '+';
+        description += featureNames[i];
+    }
+    return description.empty() ? "none" : description;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "shader.h"
+
+// Specialized builds of one vertex/fragment pair, one per combination of feature defines.
+// Bit i of a feature mask defines features[i]; a variant is built the first time its mask
+// is asked for and kept for the lifetime of the set, so the Shader references stay valid.
+class ShaderVariants
+{
+public:
+    static constexpr unsigned int MAX_FEATURES = 8;
+
+    ShaderVariants(std::string vertexPath, std::string fragmentPath, std::span<const std::string_view> features);
+
+    // Submits the variant's build on first request; see Shader for when it is waited on.
+    Shader &get(std::uint32_t features);
+    bool contains(std::uint32_t features) const { return variants[features & allFeatures()].has_value(); }
+
+    std::uint32_t allFeatures() const { return (1u << featureNames.size()) - 1; }
+    unsigned int builtCount() const { return builtVariants; }
+    // e.g. "DIRECTIONAL_LIGHT+SPOT_LIGHT", or "none"
+    std::string describe(std::uint32_t features) const;
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> featureNames;
+    std::vector<std::optional<Shader>> variants; // indexed by mask, never resized
+    unsigned int builtVariants = 0;
+};
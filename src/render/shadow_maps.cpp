@@ -0,0 +1,306 @@
+#include "shadow_maps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "gl_state.h"
+
+namespace
+{
+    const std::string LIGHT_DISTANCE_DEFINES[] = { "LIGHT_DISTANCE" };
+
+    // between logarithmic (1) and even (0) cascade splits
+    constexpr float SPLIT_BLEND = 0.75f;
+    constexpr float CUBE_NEAR_PLANE = 0.05f;
+
+    // GL's cube map face order, with the up vectors its face orientation implies
+    const glm::vec3 CUBE_DIRECTIONS[] = {
+        { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+        { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+    };
+    const glm::vec3 CUBE_UPS[] = {
+        { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f },
+        { 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+    };
+}
+
+ShadowMaps::ShadowMaps()
+    : cascadePass("shaders/vertexShaderShadow.glsl", "shaders/fragmentShaderDepthOnly.glsl"),
+      cubePass("shaders/vertexShaderShadow.glsl", "shaders/fragmentShaderDepthOnly.glsl", LIGHT_DISTANCE_DEFINES),
+      uniforms(SHADOW_DATA_BINDING, sizeof(ShadowData))
+{
+    passes.reserve(MAP_COUNT);
+    uniforms.update(ShadowData{});
+    if (!allocate())
+        enabled = false;
+}
+
+void ShadowMaps::linkShaders()
+{
+    cascadeLightMatrix = cascadePass.uniform<glm::mat4>("lightMatrix");
+    cubeLightMatrix = cubePass.uniform<glm::mat4>("lightMatrix");
+    cubeLightPositionRange = cubePass.uniform<glm::vec4>("lightPositionRange");
+}
+
+void ShadowMaps::setSamplers(const Shader &shader)
+{
+    shader.use();
+    shader.setSampler("cascadeShadowMap", FIRST_TEXTURE_UNIT);
+    shader.setSampler("pointShadowMap", FIRST_TEXTURE_UNIT + 1);
+}
+
+void ShadowMaps::setCasterBounds(const AABB &bounds)
+{
+    if (bounds.min == casterBounds.min && bounds.max == casterBounds.max)
+        return;
+    casterBounds = bounds;
+    invalidateAll();
+}
+
+void ShadowMaps::invalidate(const AABB &bounds)
+{
+    for (MapState &map : maps)
+        if (map.valid && map.frustum.intersects(bounds))
+            map.dirty = true;
+}
+
+void ShadowMaps::invalidateAll()
+{
+    for (MapState &map : maps)
+        map.valid = false;
+}
+
+void ShadowMaps::update(const glm::mat4 &viewMatrix, float fovY, float aspect, float nearPlane,
+                        const glm::vec3 &lightDirection, const glm::vec3 &pointLightPosition)
+{
+    passes.clear();
+    if (!enabled)
+    {
+        if (wasEnabled)
+            uniforms.update(ShadowData{});
+        wasEnabled = false;
+        frameStats.rendered = frameStats.skipped = 0;
+        return;
+    }
+    // nothing followed the scene while disabled
+    if (!wasEnabled)
+        invalidateAll();
+    wasEnabled = true;
+
+    updateCascades(viewMatrix, fovY, aspect, nearPlane, lightDirection);
+    updateCube(pointLightPosition);
+
+    frameStats.rendered = (unsigned int)passes.size();
+    frameStats.skipped = MAP_COUNT - frameStats.rendered;
+    frameStats.totalRendered += frameStats.rendered;
+    frameStats.totalSkipped += frameStats.skipped;
+
+    // a kept map keeps the matrix it was drawn with
+    ShadowData data{};
+    for (unsigned int i = 0; i < SHADOW_CASCADES; i++)
+    {
+        data.cascadeMatrices[i] = maps[i].matrix;
+        data.cascadeSplits[i] = splits[i];
+        data.cascadeTexelSizes[i] = maps[i].texelSize;
+    }
+    data.pointShadow = glm::vec4(cubePosition, POINT_SHADOW_RANGE);
+    uniforms.update(data);
+}
+
+void ShadowMaps::updateCascades(const glm::mat4 &viewMatrix, float fovY, float aspect, float nearPlane,
+                                const glm::vec3 &lightDirection)
+{
+    glm::vec3 direction = glm::normalize(lightDirection);
+    if (direction != cascadeDirection)
+    {
+        cascadeDirection = direction;
+        glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        lightRotation = glm::lookAt(glm::vec3(0.0f), direction, up);
+        for (unsigned int i = 0; i < SHADOW_CASCADES; i++)
+            maps[i].valid = false;
+    }
+
+    // how far the casters reach along the light; light space looks down -z
+    float casterBack = std::numeric_limits<float>::max(), casterFront = -std::numeric_limits<float>::max();
+    if (!casterBounds.empty())
+    {
+        AABB lightBounds = casterBounds.transformed(lightRotation);
+        casterBack = lightBounds.min.z;
+        casterFront = lightBounds.max.z;
+    }
+
+    glm::mat4 viewToWorld = glm::inverse(viewMatrix);
+    glm::mat4 lightToWorld = glm::transpose(lightRotation); // a rotation alone
+    float tanY = std::tan(fovY * 0.5f);
+    float tanX = tanY * aspect;
+    float sliceBegin = nearPlane;
+    for (unsigned int i = 0; i < SHADOW_CASCADES; i++)
+    {
+        float t = (float)(i + 1) / SHADOW_CASCADES;
+        float sliceEnd = SPLIT_BLEND * nearPlane * std::pow(SHADOW_DISTANCE / nearPlane, t)
+                       + (1.0f - SPLIT_BLEND) * (nearPlane + (SHADOW_DISTANCE - nearPlane) * t);
+        splits[i] = sliceEnd;
+
+        // the slice's bounding sphere keeps its radius however the camera turns, and so the
+        // cascade its size
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int corner = 0; corner < 8; corner++)
+        {
+            float distance = corner < 4 ? sliceBegin : sliceEnd;
+            glm::vec4 viewCorner((corner & 1 ? 1.0f : -1.0f) * tanX * distance,
+                                 (corner & 2 ? 1.0f : -1.0f) * tanY * distance, -distance, 1.0f);
+            corners[corner] = glm::vec3(viewToWorld * viewCorner);
+            center += corners[corner] / 8.0f;
+        }
+        float radius = 0.0f;
+        for (const glm::vec3 &corner : corners)
+            radius = std::max(radius, glm::length(corner - center));
+        sliceBegin = sliceEnd;
+
+        MapState &map = maps[i];
+        glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+        bool covered = map.valid
+            && glm::all(glm::lessThanEqual(glm::abs(glm::vec2(lightCenter) - map.center) + radius,
+                                           glm::vec2(map.halfSize)))
+            && radius * (1.0f + CASCADE_MARGIN) > map.halfSize * 0.8f; // zoomed in, so resolution is wasted
+        if (covered && !map.dirty && caching)
+            continue;
+
+        // snapped to whole texels, so the shadows don't crawl when the cascade moves
+        map.halfSize = radius * (1.0f + CASCADE_MARGIN);
+        map.texelSize = 2.0f * map.halfSize / CASCADE_SIZE;
+        map.center = glm::floor(glm::vec2(lightCenter) / map.texelSize) * map.texelSize;
+        // zFront is the side facing the light
+        float zBack = std::min(lightCenter.z - radius, casterBack) - 1.0f;
+        float zFront = std::max(lightCenter.z + radius, casterFront) + 1.0f;
+        glm::mat4 projection = glm::ortho(map.center.x - map.halfSize, map.center.x + map.halfSize,
+                                          map.center.y - map.halfSize, map.center.y + map.halfSize, -zFront, -zBack);
+        map.matrix = projection * lightRotation;
+        map.frustum = Frustum::fromMatrix(map.matrix);
+        map.valid = true;
+        map.dirty = false;
+
+        glm::vec3 origin = glm::vec3(lightToWorld * glm::vec4(map.center, zFront, 1.0f));
+        passes.push_back({ map.frustum, origin, zFront - zBack, (std::uint8_t)i, i });
+    }
+}
+
+void ShadowMaps::updateCube(const glm::vec3 &position)
+{
+    if (position != cubePosition)
+    {
+        cubePosition = position;
+        for (unsigned int face = 0; face < CUBE_FACES; face++)
+            maps[SHADOW_CASCADES + face].valid = false;
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, CUBE_NEAR_PLANE, POINT_SHADOW_RANGE);
+    for (unsigned int face = 0; face < CUBE_FACES; face++)
+    {
+        MapState &map = maps[SHADOW_CASCADES + face];
+        if (map.valid && !map.dirty && caching)
+            continue;
+        map.matrix = projection * glm::lookAt(position, position + CUBE_DIRECTIONS[face], CUBE_UPS[face]);
+        map.frustum = Frustum::fromMatrix(map.matrix);
+        map.valid = true;
+        map.dirty = false;
+        passes.push_back({ map.frustum, position, POINT_SHADOW_RANGE, 0, SHADOW_CASCADES + face });
+    }
+}
+
+const Shader &ShadowMaps::beginPass(const ShadowPass &pass)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+    GLState::setPolygonMode(GL_FILL);
+    GLState::setDepthTest(true);
+    GLState::setDepthMask(true);
+    GLState::setDepthFunc(GL_LESS);
+
+    const Shader *shader;
+    if (pass.map < SHADOW_CASCADES)
+    {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascadeTexture.get(), 0, (GLint)pass.map);
+        glViewport(0, 0, CASCADE_SIZE, CASCADE_SIZE);
+        // slope-scaled, against acne on surfaces at a grazing angle to the light
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(2.0f, 4.0f);
+        shader = &cascadePass;
+        shader->use();
+        shader->set(cascadeLightMatrix, maps[pass.map].matrix);
+    }
+    else
+    {
+        unsigned int face = pass.map - SHADOW_CASCADES;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+                               cubeTexture.get(), 0);
+        glViewport(0, 0, CUBE_SIZE, CUBE_SIZE);
+        glDisable(GL_POLYGON_OFFSET_FILL); // the shader writes its own depth, see PointShadow()
+        shader = &cubePass;
+        shader->use();
+        shader->set(cubeLightMatrix, maps[pass.map].matrix);
+        shader->set(cubeLightPositionRange, glm::vec4(cubePosition, POINT_SHADOW_RANGE));
+    }
+    glClear(GL_DEPTH_BUFFER_BIT);
+    return *shader;
+}
+
+void ShadowMaps::endPasses(int width, int height)
+{
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glViewport(0, 0, width, height);
+}
+
+void ShadowMaps::bind() const
+{
+    GLState::bindTexture(FIRST_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, cascadeTexture.get());
+    GLState::bindTexture(FIRST_TEXTURE_UNIT + 1, GL_TEXTURE_CUBE_MAP, cubeTexture.get());
+}
+
+bool ShadowMaps::allocate()
+{
+    // sampled with depth comparison, so the hardware filters the 2x2 comparison results
+    auto setParameters = [](GLenum target, GLint wrap) {
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+        glTexParameteri(target, GL_TEXTURE_WRAP_R, wrap);
+        glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    };
+
+    cascadeTexture = GLTexture::create();
+    GLState::bindTexture(FIRST_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, cascadeTexture.get());
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, CASCADE_SIZE, CASCADE_SIZE, SHADOW_CASCADES, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    setParameters(GL_TEXTURE_2D_ARRAY, GL_CLAMP_TO_BORDER);
+    const float lit[] = { 1.0f, 1.0f, 1.0f, 1.0f }; // past a cascade's edge nothing is in the way
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, lit);
+
+    cubeTexture = GLTexture::create();
+    GLState::bindTexture(FIRST_TEXTURE_UNIT + 1, GL_TEXTURE_CUBE_MAP, cubeTexture.get());
+    for (unsigned int face = 0; face < CUBE_FACES; face++)
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, CUBE_SIZE, CUBE_SIZE, 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    setParameters(GL_TEXTURE_CUBE_MAP, GL_CLAMP_TO_EDGE);
+
+    // depth only; each pass attaches the layer or face it draws
+    framebuffer = GLFramebuffer::create();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascadeTexture.get(), 0, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X, cubeTexture.get(), 0);
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete)
+        std::cout << "ERROR::SHADOWS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    return complete;
+}
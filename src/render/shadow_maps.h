@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "deferred_renderer.h"
+#include "frustum.h"
+#include "gl_handle.h"
+#include "shader.h"
+#include "uniform_blocks.h"
+#include "uniform_buffer.h"
+
+struct ShadowStats
+{
+    // cascades and cube faces, this frame and since startup
+    unsigned int rendered = 0;
+    unsigned int skipped = 0; // still valid from an earlier frame
+    std::uint64_t totalRendered = 0;
+    std::uint64_t totalSkipped = 0;
+};
+
+// A cascade or cube face that has to be drawn again: the casters inside frustum go through
+// a RenderQueue begun at origin and range, at level of detail lod, and are drawn with
+// the program beginPass() returns.
+struct ShadowPass
+{
+    Frustum frustum;
+    glm::vec3 origin;
+    float range;
+    std::uint8_t lod;
+    unsigned int map; // cascade index, or SHADOW_CASCADES + cube face
+};
+
+// Cascaded shadow maps for the directional light and a cube shadow map for the first point
+// light, each kept from frame to frame and drawn again only once it is out of date:
+//   - a cascade covers its slice of the view frustum with a margin, so it only moves, in
+//     whole texels, once the camera has taken the slice past that margin, or the light turns
+//   - the cube faces follow the light, so all six are redrawn when it moves
+//   - invalidate() marks every map whose volume overlaps a caster that changed
+// Further cascades draw coarser levels of detail, which hardly show at their resolution.
+//
+// The application culls the casters of each stale pass itself (see Application), since it
+// owns the scene; ShadowMaps only decides what is stale, where each map looks and which
+// target is bound.
+class ShadowMaps
+{
+public:
+    static constexpr int CASCADE_SIZE = 2048;
+    static constexpr int CUBE_SIZE = 512;
+    static constexpr float SHADOW_DISTANCE = 50.0f;     // where the last cascade ends
+    static constexpr float POINT_SHADOW_RANGE = 25.0f;  // where the point light is faint enough to cast none
+    static constexpr float CASCADE_MARGIN = 0.25f;      // of a slice's radius, added around it
+    static constexpr unsigned int CUBE_FACES = 6;
+    static constexpr unsigned int MAP_COUNT = SHADOW_CASCADES + CUBE_FACES;
+    // the cascade array takes this unit and the cube map the next; 16, the most GL 3.3
+    // promises, is why only one point light casts shadows
+    static constexpr unsigned int FIRST_TEXTURE_UNIT = DeferredRenderer::FIRST_TEXTURE_UNIT + 3;
+
+    bool enabled = true;
+    bool caching = true; // off, every map is drawn every frame, to compare against
+
+    // Submits the programs and allocates the maps; needs a current context.
+    ShadowMaps();
+
+    // Waits for the programs.
+    void linkShaders();
+    // Points a program's shadow samplers at the texture units bind() uses.
+    static void setSamplers(const Shader &shader);
+
+    // Every caster, so the cascades reach far enough toward the light to catch all of them.
+    void setCasterBounds(const AABB &bounds);
+    // Casters inside bounds changed: the maps that could see them are drawn again.
+    void invalidate(const AABB &bounds);
+    void invalidateAll();
+
+    // Works out which maps this frame's camera and lights leave out of date, and uploads
+    // ShadowData (zeroes while disabled).
+    void update(const glm::mat4 &viewMatrix, float fovY, float aspect, float nearPlane,
+                const glm::vec3 &lightDirection, const glm::vec3 &pointLightPosition);
+    std::span<const ShadowPass> stalePasses() const { return passes; }
+
+    // Binds and clears the pass's map; returns the program to draw its casters with.
+    const Shader &beginPass(const ShadowPass &pass);
+    // After the last pass; back to the window's viewport.
+    void endPasses(int width, int height);
+
+    void bind() const;
+
+    const ShadowStats &stats() const { return frameStats; }
+
+private:
+    struct MapState
+    {
+        bool valid = false; // drawn at least once since the last change it cannot follow
+        bool dirty = false; // casters inside changed
+        glm::mat4 matrix{1.0f};
+        Frustum frustum{};
+        // cascades only: the light-space square drawn, and its texel size
+        glm::vec2 center{0.0f};
+        float halfSize = 0.0f;
+        float texelSize = 0.0f;
+    };
+
+    Shader cascadePass;
+    Shader cubePass;
+    Uniform<glm::mat4> cascadeLightMatrix;
+    Uniform<glm::mat4> cubeLightMatrix;
+    Uniform<glm::vec4> cubeLightPositionRange;
+
+    GLTexture cascadeTexture;
+    GLTexture cubeTexture;
+    GLFramebuffer framebuffer;
+    UniformBuffer uniforms;
+
+    std::array<MapState, MAP_COUNT> maps;
+    std::array<float, SHADOW_CASCADES> splits{};
+    AABB casterBounds;
+    glm::vec3 cascadeDirection{0.0f};
+    glm::mat4 lightRotation{1.0f};
+    glm::vec3 cubePosition{0.0f};
+    bool wasEnabled = false;
+
+    std::vector<ShadowPass> passes; // reserved for every map, so update() never allocates
+    ShadowStats frameStats;
+
+    void updateCascades(const glm::mat4 &viewMatrix, float fovY, float aspect, float nearPlane,
+                        const glm::vec3 &lightDirection);
+    void updateCube(const glm::vec3 &position);
+    bool allocate();
+};
@@ -1,47 +1,254 @@
 #include "texture.h"
 
+#include <atomic>
+#include <cstring>
 #include <iostream>
+#include <utility>
 #include <glad/glad.h>
 #include <stb_image.h>
 
-unsigned int Texture::load(const std::string &path, GLenum wrapMode)
+// not part of core 3.3, so not every loader declares them
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+namespace
+{
+    // written on the GL thread, read by loader threads
+    std::atomic<bool> s3tcSupported{ false };
+    std::atomic<bool> bptcSupported{ false };
+    std::size_t textureBytes = 0;
+    GLTexture blackTexture; // released by Texture::releaseBlack() while the context is still current
+
+    bool canSample(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TEXTURE_RGBA8: return true;
+            case TEXTURE_BC1:
+            case TEXTURE_BC3: return s3tcSupported.load(std::memory_order_relaxed);
+            case TEXTURE_BC7: return bptcSupported.load(std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    GLenum compressedFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TEXTURE_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            case TEXTURE_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case TEXTURE_BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+            case TEXTURE_RGBA8: break;
+        }
+        return GL_RGBA8;
+    }
+
+    int channelCount(GLenum format)
+    {
+        return format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB ? 3 : 4;
+    }
+
+    std::size_t storageBytes(const TextureImage &image)
+    {
+        if (image.cooked)
+        {
+            std::size_t bytes = 0;
+            for (std::size_t i = 0; i < image.cooked->levelCount(); i++)
+                bytes += image.cooked->level(i).data.size();
+            return bytes;
+        }
+        if (image.pixels)
+            return (std::size_t)image.width * image.height * channelCount(image.format) * 4 / 3; // with its mip chain
+        return 0;
+    }
+
+    // Creates a texture with the sampling state every loaded texture shares, left bound to unit 0.
+    GLTexture createTexture(GLenum wrapMode)
+    {
+        auto texture = GLTexture::create();
+
+        GLState::bindTexture(0, GL_TEXTURE_2D, texture.get());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return texture;
+    }
+
+    // shaders sample .rgb(a); spread grey and grey+alpha sources accordingly
+    void applySwizzle(GLenum format)
+    {
+        if (format != GL_RED && format != GL_RG)
+            return;
+        GLint alpha = format == GL_RG ? GL_GREEN : GL_ONE;
+        GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, alpha };
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    GLenum formatForChannels(int nChannels)
+    {
+        switch (nChannels)
+        {
+            case 1: return GL_RED;
+            case 2: return GL_RG;
+            case 4: return GL_RGBA;
+            default: return GL_RGB;
+        }
+    }
+}
+
+Texture::Texture(GLTexture handle, std::string type, std::string path)
+    : handle(std::move(handle)), type(std::move(type)), path(std::move(path))
+{
+}
+
+GLTexture Texture::load(const std::string &path, GLenum wrapMode)
+{
+    return upload(decode(path), wrapMode);
+}
+
+TextureImage Texture::decode(const std::string &path)
 {
-    unsigned int textureId;
-    glGenTextures(1, &textureId);
+    TextureImage image;
 
-    glBindTexture(GL_TEXTURE_2D, textureId);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    TextureContainer cooked(TextureContainer::cookedPath(path));
+    if (cooked.valid() && canSample(cooked.format()))
+    {
+        image.width = cooked.level(0).width;
+        image.height = cooked.level(0).height;
+        image.cooked.emplace(std::move(cooked));
+        return image;
+    }
 
-    auto format = path.ends_with(".png") ? GL_RGBA : GL_RGB;
-    int width, height, nChannels;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char *data = stbi_load(path.c_str(), &width, &height, &nChannels, 0);
+    int nChannels;
+    stbi_set_flip_vertically_on_load_thread(true); // the global setting would race between loader threads
+    unsigned char *data = stbi_load(path.c_str(), &image.width, &image.height, &nChannels, 0);
     if (data)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        image.format = formatForChannels(nChannels);
+        image.pixels = { data, stbi_image_free };
     }
     else
     {
         std::cout << "Failed to load texture." << std::endl;
     }
-    stbi_image_free(data);
+    return image;
+}
+
+GLTexture Texture::upload(const TextureImage &image, GLenum wrapMode)
+{
+    auto texture = createTexture(wrapMode);
+
+    if (image.cooked)
+    {
+        // every level is precomputed, so nothing is generated here
+        const TextureContainer &cooked = *image.cooked;
+        for (std::size_t i = 0; i < cooked.levelCount(); i++)
+        {
+            const TextureLevel &level = cooked.level(i);
+            if (cooked.format() == TEXTURE_RGBA8)
+                glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                             level.data.data());
+            else
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, compressedFormat(cooked.format()), level.width,
+                                       level.height, 0, (GLsizei)level.data.size(), level.data.data());
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)cooked.levelCount() - 1);
+    }
+    else if (image.pixels)
+    {
+        // rows of RGB and single-channel images are not 4-byte aligned in general
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, image.format, image.width, image.height, 0, image.format, GL_UNSIGNED_BYTE,
+                     image.pixels.get());
+        glGenerateMipmap(GL_TEXTURE_2D);
+        applySwizzle(image.format);
+    }
+    textureBytes += storageBytes(image);
+
+    return texture;
+}
+
+Texture Texture::stream(const TextureImage &image, GLenum wrapMode, std::string type, std::string path,
+                        UploadStreamer &streamer, std::shared_ptr<const void> keepAlive)
+{
+    Texture texture{ createTexture(wrapMode), std::move(type), std::move(path) };
+    texture.streamHandle = std::make_shared<StreamHandle>();
+    unsigned int name = texture.handle.get();
+
+    // allocate every level now; the streamer fills them in over the next frames
+    if (image.cooked)
+    {
+        const TextureContainer &cooked = *image.cooked;
+        bool compressed = cooked.format() != TEXTURE_RGBA8;
+        for (std::size_t i = 0; i < cooked.levelCount(); i++)
+        {
+            const TextureLevel &level = cooked.level(i);
+            if (compressed)
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, compressedFormat(cooked.format()), level.width,
+                                       level.height, 0, (GLsizei)level.data.size(), nullptr);
+            else
+                glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                             nullptr);
+            streamer.queueTextureLevel(texture.streamHandle, name, (int)i, level.width, level.height,
+                                       compressed ? compressedFormat(cooked.format()) : GL_RGBA, compressed,
+                                       level.data, keepAlive);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)cooked.levelCount() - 1);
+    }
+    else if (image.pixels)
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, image.format, image.width, image.height, 0, image.format, GL_UNSIGNED_BYTE,
+                     nullptr);
+        applySwizzle(image.format);
+        std::size_t size = (std::size_t)image.width * image.height * channelCount(image.format);
+        streamer.queueTextureLevel(texture.streamHandle, name, 0, image.width, image.height, image.format, false,
+                                   { (const std::byte *)image.pixels.get(), size }, keepAlive, true);
+    }
+    textureBytes += storageBytes(image);
 
-    return textureId;
+    return texture;
 }
 
 unsigned int Texture::black()
 {
-    static unsigned int id = 0;
-    if (id == 0)
+    if (!blackTexture)
     {
-        glGenTextures(1, &id);
-        glBindTexture(GL_TEXTURE_2D, id);
+        blackTexture = GLTexture::create();
+        GLState::bindTexture(0, GL_TEXTURE_2D, blackTexture.get());
         unsigned char pixel[3] = {0, 0, 0};
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, pixel);
     }
-    return id;
+    return blackTexture.get();
+}
+
+void Texture::releaseBlack()
+{
+    blackTexture.reset(); // TextureTraits::destroy forgets it in GLState first
+}
+
+void Texture::detectCompressionSupport()
+{
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; i++)
+    {
+        const auto *name = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+            s3tcSupported = true;
+        else if (std::strcmp(name, "GL_ARB_texture_compression_bptc") == 0)
+            bptcSupported = true;
+    }
+}
+
+std::size_t Texture::uploadedBytes()
+{
+    return textureBytes;
 }
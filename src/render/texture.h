@@ -1,15 +1,64 @@
 #pragma once
+#include <cstddef>
+#include <memory>
+#include <optional>
 #include <string>
 #include <glad/glad.h>
 
+#include "gl_handle.h"
+#include "texture_container.h"
+#include "upload_streamer.h"
+
+// Decoded pixels waiting for upload: either a mapped cooked container or an stb_image
+// decode of the source. Decoding touches no GL state, so it can run on any thread.
+struct TextureImage
+{
+    int width = 0;
+    int height = 0;
+    GLenum format = GL_RGB; // from the source's channel count
+    std::unique_ptr<unsigned char, void (*)(void *)> pixels{ nullptr, nullptr };
+    std::optional<TextureContainer> cooked;
+
+    bool valid() const { return pixels != nullptr || cooked.has_value(); }
+};
 
 class Texture
 {
 public:
-    unsigned int id;
+    GLTexture handle;
     std::string type;
     std::string path;
 
-    static unsigned int load(const std::string &path, GLenum wrapMode = GL_REPEAT);
+    Texture(GLTexture handle, std::string type, std::string path);
+
+    Texture(const Texture &) = delete;
+    Texture &operator=(const Texture &) = delete;
+    Texture(Texture &&) noexcept = default;
+    Texture &operator=(Texture &&) noexcept = default;
+
+    // black() stands in while a streamed texture is still on its way to the GPU.
+    unsigned int id() const { return resident() ? handle.get() : black(); }
+    bool resident() const { return streamHandle == nullptr || streamHandle->resident(); }
+
+    static GLTexture load(const std::string &path, GLenum wrapMode = GL_REPEAT);
+    // Prefers the cooked container for path (see TextureContainer::cookedPath) when the
+    // context can sample its format, and falls back to decoding the source image.
+    static TextureImage decode(const std::string &path);
+    // GL thread only. An invalid image still yields a texture object, just without storage.
+    static GLTexture upload(const TextureImage &image, GLenum wrapMode = GL_REPEAT);
+    // Allocates storage now and queues the pixels on the streamer; keepAlive must own image.
+    static Texture stream(const TextureImage &image, GLenum wrapMode, std::string type, std::string path,
+                          UploadStreamer &streamer, std::shared_ptr<const void> keepAlive);
     static unsigned int black();
+    // Before the context goes away, so a later context makes a black() of its own.
+    static void releaseBlack();
+
+    // GL thread, once after the context is current: records which compressed formats the
+    // driver accepts. Until then only uncompressed cooked textures are used.
+    static void detectCompressionSupport();
+    // Bytes of texture storage uploaded so far, mip levels included.
+    static std::size_t uploadedBytes();
+
+private:
+    std::shared_ptr<StreamHandle> streamHandle; // set while created through stream()
 };
@@ -0,0 +1,123 @@
+#include "texture_container.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+    constexpr char MAGIC[4] = { 'L', 'O', 'T', 'X' };
+    constexpr std::uint32_t VERSION = 1;
+    constexpr std::uint32_t MAX_LEVELS = 32;
+
+    // File layout: header, one LevelEntry per mip level, then the level data.
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t format;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t levelCount;
+    };
+
+    struct LevelEntry
+    {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+}
+
+TextureContainer::TextureContainer(const std::string &path)
+    : file(path)
+{
+    std::span<const std::byte> bytes = file.bytes();
+    if (!file.valid() || bytes.size() < sizeof(Header))
+        return;
+
+    Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || header.format > TEXTURE_BC7 || header.width == 0 || header.height == 0
+        || header.levelCount == 0 || header.levelCount > MAX_LEVELS
+        || sizeof(Header) + header.levelCount * sizeof(LevelEntry) > bytes.size())
+        return;
+
+    textureFormat = (TextureFormat)header.format;
+    int width = (int)header.width, height = (int)header.height;
+    for (std::uint32_t i = 0; i < header.levelCount; i++)
+    {
+        LevelEntry entry;
+        std::memcpy(&entry, bytes.data() + sizeof(Header) + i * sizeof(LevelEntry), sizeof(entry));
+        if (entry.offset > bytes.size() || entry.size > bytes.size() - entry.offset
+            || entry.size != levelSize(textureFormat, width, height))
+        {
+            levels.clear();
+            return;
+        }
+        levels.push_back({ width, height, bytes.subspan(entry.offset, entry.size) });
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    isValid = true;
+}
+
+std::string TextureContainer::cookedPath(const std::string &sourcePath)
+{
+    return (std::filesystem::path("cooked") / std::filesystem::path(sourcePath).replace_extension(".tex")).generic_string();
+}
+
+std::size_t TextureContainer::levelSize(TextureFormat format, int width, int height)
+{
+    std::size_t blocks = (std::size_t)((width + 3) / 4) * (std::size_t)((height + 3) / 4);
+    switch (format)
+    {
+        case TEXTURE_RGBA8: return (std::size_t)width * (std::size_t)height * 4;
+        case TEXTURE_BC1: return blocks * 8;
+        case TEXTURE_BC3:
+        case TEXTURE_BC7: return blocks * 16;
+    }
+    return 0;
+}
+
+const char *TextureContainer::formatName(TextureFormat format)
+{
+    switch (format)
+    {
+        case TEXTURE_RGBA8: return "RGBA8";
+        case TEXTURE_BC1: return "BC1";
+        case TEXTURE_BC3: return "BC3";
+        case TEXTURE_BC7: return "BC7";
+    }
+    return "unknown";
+}
+
+bool TextureContainer::write(const std::string &path, TextureFormat format, int width, int height,
+                             const std::vector<std::vector<std::byte>> &levels)
+{
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.format = format;
+    header.width = (std::uint32_t)width;
+    header.height = (std::uint32_t)height;
+    header.levelCount = (std::uint32_t)levels.size();
+
+    std::vector<LevelEntry> entries;
+    std::uint64_t offset = sizeof(Header) + levels.size() * sizeof(LevelEntry);
+    for (const std::vector<std::byte> &level : levels)
+    {
+        entries.push_back({ offset, level.size() });
+        offset += level.size();
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)entries.data(), (std::streamsize)(entries.size() * sizeof(LevelEntry)));
+    for (const std::vector<std::byte> &level : levels)
+        out.write((const char *)level.data(), (std::streamsize)level.size());
+    return (bool)out;
+}
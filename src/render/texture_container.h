@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "lib/mapped_file.h"
+
+enum TextureFormat : std::uint32_t
+{
+    TEXTURE_RGBA8 = 0,
+    TEXTURE_BC1 = 1, // opaque RGB, 4x4 blocks of 8 bytes
+    TEXTURE_BC3 = 2, // RGBA, 4x4 blocks of 16 bytes
+    TEXTURE_BC7 = 3, // RGBA, 4x4 blocks of 16 bytes
+};
+
+struct TextureLevel
+{
+    int width;
+    int height;
+    std::span<const std::byte> data;
+};
+
+// Cooked texture file written by the texture_cooker tool: a full mip chain, optionally
+// block compressed, that uploads level by level with no decoding or mip generation.
+// Read through a memory mapping, so the levels go to GL straight from the file.
+class TextureContainer
+{
+public:
+    // valid() is false when the file is missing or malformed.
+    explicit TextureContainer(const std::string &path);
+
+    bool valid() const { return isValid; }
+    TextureFormat format() const { return textureFormat; }
+    std::size_t levelCount() const { return levels.size(); }
+    const TextureLevel &level(std::size_t index) const { return levels[index]; }
+
+    // Where the cooked copy of a source image lives, e.g.
+    // "assets/models/grass/grass.png" -> "cooked/assets/models/grass/grass.tex".
+    static std::string cookedPath(const std::string &sourcePath);
+    static std::size_t levelSize(TextureFormat format, int width, int height);
+    static const char *formatName(TextureFormat format);
+
+    // levels[0] is the full-size image; each further level halves both sides, down to 1x1.
+    static bool write(const std::string &path, TextureFormat format, int width, int height,
+                      const std::vector<std::vector<std::byte>> &levels);
+
+private:
+    MappedFile file;
+    bool isValid = false;
+    TextureFormat textureFormat = TEXTURE_RGBA8;
+    std::vector<TextureLevel> levels;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <glm/glm.hpp>
+
+// CPU mirrors of the std140 uniform blocks shared by every program. vec3 members are
+// followed by a float so each one fills a full 16-byte std140 slot.
+
+enum UniformBlockBinding : unsigned int
+{
+    FRAME_DATA_BINDING = 0,
+    LIGHT_DATA_BINDING = 1,
+    CLUSTER_DATA_BINDING = 2,
+    SHADOW_DATA_BINDING = 3,
+};
+
+// Shader binds every block it finds by name, so new programs need no per-program setup.
+constexpr std::array<std::pair<std::string_view, unsigned int>, 4> UNIFORM_BLOCK_BINDINGS = {{
+    { "FrameData", FRAME_DATA_BINDING },
+    { "LightData", LIGHT_DATA_BINDING },
+    { "ClusterData", CLUSTER_DATA_BINDING },
+    { "ShadowData", SHADOW_DATA_BINDING },
+}};
+
+// defined for every shader stage by preprocessShader
+constexpr int MAX_POINT_LIGHTS = 16;
+constexpr int SHADOW_CASCADES = 3; // at most 4, see ShadowData::cascadeSplits
+
+struct alignas(16) FrameData
+{
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    glm::vec3 viewPos;
+    float time;
+};
+
+struct alignas(16) DirLightData
+{
+    glm::vec3 direction;
+    float _pad0;
+    glm::vec3 ambientColor;
+    float _pad1;
+    glm::vec3 diffuseColor;
+    float _pad2;
+    glm::vec3 specularColor;
+    float _pad3;
+};
+
+struct alignas(16) PointLightData
+{
+    glm::vec3 position;
+    float constantAttTerm;
+    glm::vec3 ambientColor;
+    float linearAttTerm;
+    glm::vec3 diffuseColor;
+    float quadraticAttTerm;
+    glm::vec3 specularColor;
+    float _pad0;
+};
+
+struct alignas(16) SpotLightData
+{
+    glm::vec3 position;
+    float cutOff;
+    glm::vec3 direction;
+    float outerCutOff;
+    glm::vec3 ambientColor;
+    float constantAttTerm;
+    glm::vec3 diffuseColor;
+    float linearAttTerm;
+    glm::vec3 specularColor;
+    float quadraticAttTerm;
+};
+
+struct alignas(16) LightData
+{
+    DirLightData dirLight;
+    PointLightData pointLights[MAX_POINT_LIGHTS];
+    SpotLightData spotLight;
+    int pointLightCount; // entries of pointLights in use
+};
+
+// How fragments find their cluster, see LightClusters
+struct alignas(16) ClusterData
+{
+    glm::uvec4 grid;  // tiles across and down, depth slices, lights
+    glm::vec4 scale;  // tiles per pixel across and down, then the depth slice scale and bias
+};
+
+// Where the shadow maps of ShadowMaps are in the world. Zero splits and a zero point
+// shadow range leave everything lit.
+struct alignas(16) ShadowData
+{
+    glm::mat4 cascadeMatrices[SHADOW_CASCADES]; // world to cascade map, depth in [-1, 1]
+    glm::vec4 cascadeSplits;     // view distance each cascade reaches
+    glm::vec4 cascadeTexelSizes; // world size of one texel of each cascade
+    glm::vec4 pointShadow;       // position of pointLights[0], then its shadow range
+};
+
+static_assert(sizeof(FrameData) == 144, "FrameData must match the std140 layout");
+static_assert(sizeof(DirLightData) == 64, "DirLight must match the std140 layout");
+static_assert(sizeof(PointLightData) == 64, "PointLight must match the std140 layout");
+static_assert(sizeof(SpotLightData) == 80, "SpotLight must match the std140 layout");
+static_assert(sizeof(ClusterData) == 32, "ClusterData must match the std140 layout");
+static_assert(SHADOW_CASCADES <= 4 && sizeof(ShadowData) == 64 * SHADOW_CASCADES + 48,
+              "ShadowData must match the std140 layout");
+static_assert(offsetof(LightData, pointLightCount) == 64 + 64 * MAX_POINT_LIGHTS + 80,
+              "LightData must match the std140 layout");
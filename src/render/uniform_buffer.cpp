@@ -0,0 +1,18 @@
+#include "uniform_buffer.h"
+
+#include <glad/glad.h>
+
+UniformBuffer::UniformBuffer(unsigned int binding, std::size_t size)
+    : buffer(GLBuffer::create()), size(size)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer.get());
+    glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)size, nullptr, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer.get());
+}
+
+void UniformBuffer::update(const void *data, std::size_t dataSize) const
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer.get());
+    glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)size, nullptr, GL_STREAM_DRAW); // orphan
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr)(dataSize < size ? dataSize : size), data);
+}
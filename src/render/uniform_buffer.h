@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+#include "gl_handle.h"
+
+// A uniform buffer permanently attached to one binding point. Each update orphans the
+// previous storage, so writing it every frame never waits on draws still reading it.
+class UniformBuffer
+{
+public:
+    UniformBuffer(unsigned int binding, std::size_t size);
+
+    void update(const void *data, std::size_t size) const;
+
+    template <typename T>
+    void update(const T &data) const { update(&data, sizeof(T)); }
+
+private:
+    GLBuffer buffer;
+    std::size_t size;
+};
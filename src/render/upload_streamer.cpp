@@ -0,0 +1,233 @@
+#include "upload_streamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include "gl_state.h"
+
+namespace
+{
+    // keeps each step short enough that the budget check stays meaningful
+    constexpr std::size_t MAX_COPY_SIZE = 256 * 1024;
+
+    std::size_t bytesPerPixel(GLenum format)
+    {
+        switch (format)
+        {
+            case GL_RED: return 1;
+            case GL_RG: return 2;
+            case GL_RGB: return 3;
+            default: return 4;
+        }
+    }
+}
+
+std::size_t UploadStreamer::UploadJob::rowBytes() const
+{
+    if (!compressed)
+        return (std::size_t)width * bytesPerPixel(format);
+    // a row of 4x4 blocks; the block size follows from the level's total size
+    std::size_t blockRows = (std::size_t)(height + 3) / 4;
+    return data.size() / blockRows;
+}
+
+UploadStreamer::UploadStreamer()
+{
+    for (GLBuffer &buffer : stagingBuffers)
+    {
+        buffer = GLBuffer::create();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.get());
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, STAGING_BUFFER_SIZE, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+UploadStreamer::~UploadStreamer()
+{
+    for (GLsync fence : stagingFences)
+    {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+    }
+}
+
+void UploadStreamer::queueBuffer(const std::shared_ptr<StreamHandle> &owner, unsigned int buffer, std::size_t offset,
+                                 std::span<const std::byte> data, std::shared_ptr<const void> keepAlive)
+{
+    if (data.empty())
+        return;
+
+    UploadJob &job = jobs.emplace_back();
+    job.kind = UPLOAD_BUFFER;
+    job.owner = owner;
+    job.keepAlive = std::move(keepAlive);
+    job.data = data;
+    job.name = buffer;
+    job.destinationOffset = offset;
+    owner->pendingUploads++;
+    pendingBytes += data.size();
+}
+
+void UploadStreamer::queueTextureLevel(const std::shared_ptr<StreamHandle> &owner, unsigned int texture, int level,
+                                       int width, int height, GLenum format, bool compressed,
+                                       std::span<const std::byte> data, std::shared_ptr<const void> keepAlive,
+                                       bool generateMipmaps)
+{
+    if (data.empty())
+        return;
+
+    UploadJob &job = jobs.emplace_back();
+    job.kind = UPLOAD_TEXTURE;
+    job.owner = owner;
+    job.keepAlive = std::move(keepAlive);
+    job.data = data;
+    job.name = texture;
+    job.level = level;
+    job.width = width;
+    job.height = height;
+    job.format = format;
+    job.compressed = compressed;
+    job.generateMipmaps = generateMipmaps;
+    owner->pendingUploads++;
+    pendingBytes += data.size();
+}
+
+void UploadStreamer::update(double budgetMs)
+{
+    frameStats = {};
+    auto start = std::chrono::steady_clock::now();
+    auto withinBudget = [&] {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() < budgetMs;
+    };
+
+    while (!jobs.empty() && withinBudget())
+    {
+        unsigned int buffer = stagingBuffers[nextStaging].get();
+        GLsync &fence = stagingFences[nextStaging];
+        if (!stagingReady(fence))
+        {
+            frameStats.fenceStalls++;
+            break;
+        }
+
+        // the fence says the GPU is done with the old contents, so skip the driver's own sync
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        auto *mapped = (std::byte *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, STAGING_BUFFER_SIZE,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (mapped == nullptr)
+            break;
+
+        copies.clear();
+        std::size_t used = 0;
+        bool full = false;
+        for (auto job = jobs.begin(); job != jobs.end() && !full && withinBudget(); ++job)
+        {
+            if (job->owner.expired())
+                continue;
+
+            // textures advance in whole rows (of blocks), buffers in bytes
+            std::size_t step = job->kind == UPLOAD_TEXTURE ? std::max(MAX_COPY_SIZE, job->rowBytes()) : MAX_COPY_SIZE;
+            while (job->uploaded < job->data.size())
+            {
+                std::size_t remaining = job->data.size() - job->uploaded;
+                std::size_t size = std::min({ remaining, step, STAGING_BUFFER_SIZE - used });
+                if (job->kind == UPLOAD_TEXTURE && size < remaining)
+                    size -= size % job->rowBytes();
+                if (size == 0 || !withinBudget())
+                {
+                    full = size == 0;
+                    break;
+                }
+
+                std::memcpy(mapped + used, job->data.data() + job->uploaded, size);
+                copies.push_back({ &*job, used, job->uploaded, size });
+                job->uploaded += size;
+                used += size;
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        for (const Copy &copy : copies)
+            issue(copy, buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); // client-memory uploads elsewhere must not read from it
+
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextStaging = (nextStaging + 1) % STAGING_BUFFER_COUNT;
+        frameStats.uploadedBytes += used;
+        pendingBytes -= used;
+
+        finishCompleted();
+        if (copies.empty())
+            break;
+    }
+    finishCompleted();
+    frameStats.pendingBytes = pendingBytes;
+}
+
+bool UploadStreamer::stagingReady(GLsync &fence)
+{
+    if (fence == nullptr)
+        return true;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return false;
+    glDeleteSync(fence);
+    fence = nullptr;
+    return true;
+}
+
+void UploadStreamer::issue(const Copy &copy, unsigned int stagingBuffer)
+{
+    const UploadJob &job = *copy.job;
+    if (job.kind == UPLOAD_BUFFER)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, job.name);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)copy.stagingOffset,
+                            (GLintptr)(job.destinationOffset + copy.sourceOffset), (GLsizeiptr)copy.size);
+        return;
+    }
+
+    // the copy covers whole rows, so it maps onto a full-width strip of the level
+    std::size_t rowBytes = job.rowBytes();
+    int rowsPerStep = job.rowsPerStep();
+    int firstRow = (int)(copy.sourceOffset / rowBytes) * rowsPerStep;
+    int rows = std::min((int)((copy.size + rowBytes - 1) / rowBytes) * rowsPerStep, job.height - firstRow);
+    const auto *offset = (const void *)(std::uintptr_t)copy.stagingOffset;
+
+    GLState::bindTexture(0, GL_TEXTURE_2D, job.name);
+    if (job.compressed)
+    {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, job.level, 0, firstRow, job.width, rows, job.format,
+                                  (GLsizei)copy.size, offset);
+    }
+    else
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, firstRow, job.width, rows, job.format, GL_UNSIGNED_BYTE, offset);
+    }
+
+    if (job.generateMipmaps && copy.sourceOffset + copy.size == job.data.size())
+        glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void UploadStreamer::finishCompleted()
+{
+    while (!jobs.empty())
+    {
+        UploadJob &job = jobs.front();
+        std::shared_ptr<StreamHandle> owner = job.owner.lock();
+        if (owner != nullptr && job.uploaded < job.data.size())
+            break;
+
+        if (owner != nullptr)
+            owner->pendingUploads--;
+        else
+            pendingBytes -= job.data.size() - job.uploaded; // cancelled with its resource
+        jobs.pop_front();
+    }
+}
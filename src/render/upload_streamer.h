@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <span>
+#include <vector>
+#include <glad/glad.h>
+
+#include "gl_handle.h"
+
+// Shared between a resource and its queued uploads. The resource keeps it alive; queued
+// uploads only hold a weak reference, so destroying the resource cancels what is left.
+struct StreamHandle
+{
+    unsigned int pendingUploads = 0;
+
+    bool resident() const { return pendingUploads == 0; }
+};
+
+struct UploadStreamerStats
+{
+    std::size_t pendingBytes = 0;
+    std::size_t uploadedBytes = 0; // during the last update()
+    unsigned int fenceStalls = 0;  // staging buffers still in use by the GPU, last update()
+};
+
+// Streams texture and buffer contents to the GPU through a ring of pixel buffer objects,
+// spending at most a fixed CPU budget per frame. Each staging buffer is fenced after its
+// copies are issued and only refilled once the GPU has consumed it, so the CPU never
+// waits on the driver. Resources stay non-resident, and are drawn with a placeholder,
+// until their last byte has been copied.
+class UploadStreamer
+{
+public:
+    static constexpr std::size_t STAGING_BUFFER_COUNT = 4;
+    static constexpr std::size_t STAGING_BUFFER_SIZE = 4 * 1024 * 1024;
+
+    UploadStreamer();
+    ~UploadStreamer();
+
+    UploadStreamer(const UploadStreamer &) = delete;
+    UploadStreamer &operator=(const UploadStreamer &) = delete;
+
+    // The destination storage must already be allocated. `data` must stay valid for as long
+    // as keepAlive is held; the streamer holds it until the upload has been copied.
+    void queueBuffer(const std::shared_ptr<StreamHandle> &owner, unsigned int buffer, std::size_t offset,
+                     std::span<const std::byte> data, std::shared_ptr<const void> keepAlive);
+
+    // One mip level. Compressed levels are copied in rows of 4x4 blocks; generateMipmaps
+    // fills the rest of the chain once this level is complete.
+    void queueTextureLevel(const std::shared_ptr<StreamHandle> &owner, unsigned int texture, int level,
+                           int width, int height, GLenum format, bool compressed, std::span<const std::byte> data,
+                           std::shared_ptr<const void> keepAlive, bool generateMipmaps = false);
+
+    // Fills and issues staging buffers until the budget is spent or nothing is queued.
+    void update(double budgetMs);
+
+    bool idle() const { return jobs.empty(); }
+    const UploadStreamerStats &stats() const { return frameStats; }
+
+private:
+    enum UploadKind
+    {
+        UPLOAD_BUFFER,
+        UPLOAD_TEXTURE,
+    };
+
+    struct UploadJob
+    {
+        UploadKind kind;
+        std::weak_ptr<StreamHandle> owner;
+        std::shared_ptr<const void> keepAlive;
+        std::span<const std::byte> data;
+        std::size_t uploaded = 0;
+        unsigned int name;
+        std::size_t destinationOffset = 0; // buffers only
+
+        // textures only
+        int level = 0;
+        int width = 0;
+        int height = 0;
+        GLenum format = GL_RGBA;
+        bool compressed = false;
+        bool generateMipmaps = false;
+
+        std::size_t rowBytes() const;
+        int rowsPerStep() const { return compressed ? 4 : 1; }
+    };
+
+    struct Copy
+    {
+        UploadJob *job;
+        std::size_t stagingOffset;
+        std::size_t sourceOffset;
+        std::size_t size;
+    };
+
+    std::deque<UploadJob> jobs;
+    std::vector<Copy> copies; // the current staging buffer's, reused across updates
+    std::array<GLBuffer, STAGING_BUFFER_COUNT> stagingBuffers;
+    std::array<GLsync, STAGING_BUFFER_COUNT> stagingFences{}; // set while the GPU may still read the buffer
+    std::size_t nextStaging = 0;
+    std::size_t pendingBytes = 0;
+    UploadStreamerStats frameStats;
+
+    bool stagingReady(GLsync &fence);
+    void issue(const Copy &copy, unsigned int stagingBuffer);
+    void finishCompleted();
+};
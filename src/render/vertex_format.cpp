@@ -0,0 +1,68 @@
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+static_assert(sizeof(CompactVertex) == 20 && sizeof(QuantizedVertex) == 16, "vertex formats must stay tightly packed");
+
+namespace
+{
+    std::uint32_t packNormal(const glm::vec3 &normal)
+    {
+        return glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+    }
+
+    glm::vec3 unpackNormal(std::uint32_t packed)
+    {
+        return glm::vec3(glm::unpackSnorm3x10_1x2(packed));
+    }
+
+    glm::vec3 boundsExtent(const AABB &bounds)
+    {
+        return bounds.empty() ? glm::vec3(0.0f) : bounds.max - bounds.min;
+    }
+}
+
+CompactVertex VertexFormat<CompactVertex>::encode(const Vertex &vertex, const AABB &)
+{
+    return { vertex.position, packNormal(vertex.normal),
+             { glm::packHalf1x16(vertex.texCoords.x), glm::packHalf1x16(vertex.texCoords.y) } };
+}
+
+Vertex VertexFormat<CompactVertex>::decode(const CompactVertex &vertex, const AABB &)
+{
+    return { vertex.position, unpackNormal(vertex.normal),
+             { glm::unpackHalf1x16(vertex.texCoords[0]), glm::unpackHalf1x16(vertex.texCoords[1]) } };
+}
+
+QuantizedVertex VertexFormat<QuantizedVertex>::encode(const Vertex &vertex, const AABB &bounds)
+{
+    QuantizedVertex encoded{};
+    glm::vec3 extent = boundsExtent(bounds);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        // a flat axis has nothing to quantize; every vertex sits at its minimum
+        float t = extent[axis] > 0.0f ? (vertex.position[axis] - bounds.min[axis]) / extent[axis] : 0.0f;
+        encoded.position[axis] = (std::uint16_t)std::lround(std::clamp(t, 0.0f, 1.0f) * 65535.0f);
+    }
+    encoded.normal = packNormal(vertex.normal);
+    encoded.texCoords[0] = glm::packHalf1x16(vertex.texCoords.x);
+    encoded.texCoords[1] = glm::packHalf1x16(vertex.texCoords.y);
+    return encoded;
+}
+
+Vertex VertexFormat<QuantizedVertex>::decode(const QuantizedVertex &vertex, const AABB &bounds)
+{
+    PositionTransform transform = PositionTransform::forBounds(bounds);
+    glm::vec3 t{ vertex.position[0] / 65535.0f, vertex.position[1] / 65535.0f, vertex.position[2] / 65535.0f };
+    return { transform.offset + t * transform.scale, unpackNormal(vertex.normal),
+             { glm::unpackHalf1x16(vertex.texCoords[0]), glm::unpackHalf1x16(vertex.texCoords[1]) } };
+}
+
+PositionTransform PositionTransform::forBounds(const AABB &bounds)
+{
+    if (bounds.empty())
+        return {};
+    return { boundsExtent(bounds), bounds.min };
+}
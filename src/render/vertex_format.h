@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glad/glad.h>
+
+#include "bounds.h"
+#include "vertex.h"
+
+// Per-instance attributes, sourced from the drawing Model's instance buffers
+constexpr unsigned int INSTANCE_MATRIX_LOCATION = 3; // mat4 takes locations 3..6
+constexpr unsigned int INSTANCE_TINT_LOCATION = 7;
+
+struct VertexAttribute
+{
+    unsigned int location;
+    int components;
+    GLenum type;
+    bool normalized;
+    std::size_t offset;
+};
+
+// 20 bytes: float positions, normals packed to signed 10:10:10:2 and half-float UVs.
+struct CompactVertex
+{
+    glm::vec3 position;
+    std::uint32_t normal;
+    std::uint16_t texCoords[2];
+};
+
+// 16 bytes: positions quantized to 16 bits inside the mesh bounds, otherwise like CompactVertex.
+// The vertex shader maps them back with the positionScale/positionOffset builtins.
+struct QuantizedVertex
+{
+    std::uint16_t position[4]; // w pads the normal to a 4-byte boundary
+    std::uint32_t normal;
+    std::uint16_t texCoords[2];
+};
+
+// Layout of a GPU vertex type and its conversion from the float layout meshes are imported
+// in. `attributes` drives glVertexAttribPointer; `id` tags mesh caches cooked with the type.
+template <typename V> struct VertexFormat;
+
+template <> struct VertexFormat<Vertex>
+{
+    static constexpr std::uint32_t id = 1;
+    static constexpr const char *name = "float";
+    static constexpr bool quantizedPositions = false;
+    static constexpr std::array<VertexAttribute, 3> attributes = { {
+        { 0, 3, GL_FLOAT, false, offsetof(Vertex, position) },
+        { 1, 3, GL_FLOAT, false, offsetof(Vertex, normal) },
+        { 2, 2, GL_FLOAT, false, offsetof(Vertex, texCoords) },
+    } };
+
+    static Vertex encode(const Vertex &vertex, const AABB &) { return vertex; }
+    static Vertex decode(const Vertex &vertex, const AABB &) { return vertex; }
+};
+
+template <> struct VertexFormat<CompactVertex>
+{
+    static constexpr std::uint32_t id = 2;
+    static constexpr const char *name = "compact";
+    static constexpr bool quantizedPositions = false;
+    static constexpr std::array<VertexAttribute, 3> attributes = { {
+        { 0, 3, GL_FLOAT, false, offsetof(CompactVertex, position) },
+        { 1, 4, GL_INT_2_10_10_10_REV, true, offsetof(CompactVertex, normal) },
+        { 2, 2, GL_HALF_FLOAT, false, offsetof(CompactVertex, texCoords) },
+    } };
+
+    static CompactVertex encode(const Vertex &vertex, const AABB &bounds);
+    static Vertex decode(const CompactVertex &vertex, const AABB &bounds);
+};
+
+template <> struct VertexFormat<QuantizedVertex>
+{
+    static constexpr std::uint32_t id = 3;
+    static constexpr const char *name = "quantized";
+    static constexpr bool quantizedPositions = true;
+    static constexpr std::array<VertexAttribute, 3> attributes = { {
+        { 0, 3, GL_UNSIGNED_SHORT, true, offsetof(QuantizedVertex, position) },
+        { 1, 4, GL_INT_2_10_10_10_REV, true, offsetof(QuantizedVertex, normal) },
+        { 2, 2, GL_HALF_FLOAT, false, offsetof(QuantizedVertex, texCoords) },
+    } };
+
+    static QuantizedVertex encode(const Vertex &vertex, const AABB &bounds);
+    static Vertex decode(const QuantizedVertex &vertex, const AABB &bounds);
+};
+
+// Chosen at build time with the LEARN_OPENGL_VERTEX_FORMAT CMake setting.
+#if defined(LEARN_OPENGL_VERTEX_FORMAT_FLOAT)
+using GpuVertex = Vertex;
+#elif defined(LEARN_OPENGL_VERTEX_FORMAT_COMPACT)
+using GpuVertex = CompactVertex;
+#else
+using GpuVertex = QuantizedVertex;
+#endif
+
+template <typename V>
+std::vector<V> encodeVertices(std::span<const Vertex> vertices, const AABB &bounds)
+{
+    std::vector<V> encoded;
+    encoded.reserve(vertices.size());
+    for (const Vertex &vertex : vertices)
+        encoded.push_back(VertexFormat<V>::encode(vertex, bounds));
+    return encoded;
+}
+
+// Maps quantized positions in [0, 1] back into the bounds they were quantized against.
+struct PositionTransform
+{
+    glm::vec3 scale{ 1.0f };
+    glm::vec3 offset{ 0.0f };
+
+    static PositionTransform forBounds(const AABB &bounds);
+};
+
+// Points the attribute locations of the bound VAO at the bound GL_ARRAY_BUFFER.
+template <typename V>
+void setVertexAttributes()
+{
+    for (const VertexAttribute &attribute : VertexFormat<V>::attributes)
+    {
+        glVertexAttribPointer(attribute.location, attribute.components, attribute.type,
+                              attribute.normalized ? GL_TRUE : GL_FALSE, sizeof(V), (void *)attribute.offset);
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
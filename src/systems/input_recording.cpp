@@ -0,0 +1,172 @@
+#include "input_recording.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    constexpr char MAGIC[4] = { 'L', 'O', 'I', 'R' };
+    constexpr std::uint32_t VERSION = 1;
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t frameCount; // written by finish()
+        std::uint16_t keyCount;   // GLFW_KEY_LAST + 1 of the recording build
+        std::uint16_t mouseButtonCount;
+    };
+
+    enum FrameFlags : std::uint8_t
+    {
+        FRAME_KEYS = 1 << 0,          // u16 count, then a u16 code per toggled key
+        FRAME_MOUSE_BUTTONS = 1 << 1, // u8 mask of the held buttons
+        FRAME_MOUSE_MOVED = 1 << 2,   // float dx, dy
+        FRAME_SCROLLED = 1 << 3,      // float dx, dy
+    };
+
+    template <typename T>
+    void write(std::ofstream &out, const T &value)
+    {
+        out.write((const char *)&value, sizeof(T));
+    }
+
+    // Records are packed, so every field is copied out rather than read in place.
+    template <typename T>
+    bool read(std::span<const std::byte> bytes, std::size_t &cursor, T &value)
+    {
+        if (cursor + sizeof(T) > bytes.size())
+            return false;
+        std::memcpy(&value, bytes.data() + cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+
+}
+
+InputRecorder::InputRecorder(const std::string &path)
+    : out(path, std::ios::binary | std::ios::trunc)
+{
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.keyCount = InputSystem::KEY_COUNT;
+    header.mouseButtonCount = InputSystem::MOUSE_BUTTON_COUNT;
+    write(out, header);
+}
+
+void InputRecorder::record(const InputSystem::Snapshot &snapshot, float deltaTime)
+{
+    if (!out.is_open())
+        return;
+
+    InputSystem::KeyBits toggled = snapshot.keys ^ previous.keys;
+    auto toggledKeys = (std::uint16_t)toggled.count();
+
+    std::uint8_t flags = 0;
+    flags |= toggledKeys > 0 ? FRAME_KEYS : 0;
+    flags |= snapshot.mouseButtons != previous.mouseButtons ? FRAME_MOUSE_BUTTONS : 0;
+    flags |= snapshot.mouseDelta != glm::vec2(0.0f) ? FRAME_MOUSE_MOVED : 0;
+    flags |= snapshot.scrollDelta != glm::vec2(0.0f) ? FRAME_SCROLLED : 0;
+
+    write(out, deltaTime);
+    write(out, flags);
+    if (flags & FRAME_KEYS)
+    {
+        write(out, toggledKeys);
+        for (int key = 0; key < InputSystem::KEY_COUNT; key++)
+        {
+            if (toggled[key])
+                write(out, (std::uint16_t)key);
+        }
+    }
+    if (flags & FRAME_MOUSE_BUTTONS)
+        write(out, (std::uint8_t)snapshot.mouseButtons.to_ulong());
+    if (flags & FRAME_MOUSE_MOVED)
+        write(out, snapshot.mouseDelta);
+    if (flags & FRAME_SCROLLED)
+        write(out, snapshot.scrollDelta);
+
+    previous = snapshot;
+    frames++;
+}
+
+bool InputRecorder::finish()
+{
+    if (!out.is_open())
+        return false;
+    out.seekp(offsetof(Header, frameCount));
+    write(out, frames);
+    out.close();
+    return !out.fail();
+}
+
+InputReplay::InputReplay(const std::string &path)
+    : file(path)
+{
+    Header header{};
+    std::span<const std::byte> bytes = file.bytes();
+    if (!file.valid() || !read(bytes, cursor, header))
+        return;
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+    {
+        std::cout << "ERROR::INPUT_REPLAY::NOT_AN_INPUT_LOG " << path << std::endl;
+        return;
+    }
+    // key codes are GLFW's, so a build with a different key range could misread them
+    if (header.keyCount != InputSystem::KEY_COUNT || header.mouseButtonCount != InputSystem::MOUSE_BUTTON_COUNT)
+    {
+        std::cout << "ERROR::INPUT_REPLAY::KEY_RANGE_MISMATCH " << path << std::endl;
+        return;
+    }
+    frames = header.frameCount;
+    isValid = true;
+}
+
+bool InputReplay::next(InputSystem::Snapshot &snapshot, float &deltaTime)
+{
+    std::span<const std::byte> bytes = file.bytes();
+    std::size_t position = cursor;
+    InputSystem::Snapshot frame = current;
+    frame.mouseDelta = frame.scrollDelta = glm::vec2(0.0f);
+
+    std::uint8_t flags = 0;
+    float frameDelta = 0.0f;
+    bool complete = isValid && read(bytes, position, frameDelta) && read(bytes, position, flags);
+    if (complete && (flags & FRAME_KEYS))
+    {
+        std::uint16_t toggledKeys = 0;
+        complete = read(bytes, position, toggledKeys);
+        for (std::uint16_t i = 0; complete && i < toggledKeys; i++)
+        {
+            std::uint16_t key = 0;
+            complete = read(bytes, position, key) && key < InputSystem::KEY_COUNT;
+            if (complete)
+                frame.keys.flip(key);
+        }
+    }
+    if (complete && (flags & FRAME_MOUSE_BUTTONS))
+    {
+        std::uint8_t mask = 0;
+        complete = read(bytes, position, mask);
+        frame.mouseButtons = InputSystem::MouseButtonBits(mask);
+    }
+    if (complete && (flags & FRAME_MOUSE_MOVED))
+        complete = read(bytes, position, frame.mouseDelta);
+    if (complete && (flags & FRAME_SCROLLED))
+        complete = read(bytes, position, frame.scrollDelta);
+
+    if (!complete)
+    {
+        // a truncated last record is dropped as a whole
+        snapshot = current;
+        snapshot.mouseDelta = snapshot.scrollDelta = glm::vec2(0.0f);
+        deltaTime = 0.0f;
+        return false;
+    }
+    cursor = position;
+    current = frame;
+    snapshot = frame;
+    deltaTime = frameDelta;
+    return true;
+}
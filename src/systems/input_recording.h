@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "lib/mapped_file.h"
+#include "input_system.h"
+
+// Input logs: a small header, then one record per frame holding the frame's delta time and
+// only what changed since the previous frame (toggled keys, the mouse button mask, mouse and
+// scroll deltas). A frame without input costs 5 bytes.
+
+// Streams frames to a log as they happen; the stream buffers, so record() does not allocate.
+class InputRecorder
+{
+public:
+    explicit InputRecorder(const std::string &path);
+    ~InputRecorder() { finish(); }
+
+    InputRecorder(const InputRecorder &) = delete;
+    InputRecorder &operator=(const InputRecorder &) = delete;
+
+    bool valid() const { return (bool)out; }
+    std::uint32_t frameCount() const { return frames; }
+
+    void record(const InputSystem::Snapshot &snapshot, float deltaTime);
+    // Writes the frame count and closes the log; later calls do nothing. A log that was never
+    // finished still replays, up to its last complete frame.
+    bool finish();
+
+private:
+    std::ofstream out;
+    InputSystem::Snapshot previous;
+    std::uint32_t frames = 0;
+};
+
+// Reads a log back one frame at a time, from a memory mapping.
+class InputReplay
+{
+public:
+    explicit InputReplay(const std::string &path);
+
+    bool valid() const { return isValid; }
+    // As recorded; 0 if the recording was cut short.
+    std::uint32_t frameCount() const { return frames; }
+
+    // The next frame's input and delta time. At the end of the log it returns false, with the
+    // keys left as they were and no mouse, scroll or time delta.
+    bool next(InputSystem::Snapshot &snapshot, float &deltaTime);
+
+private:
+    MappedFile file;
+    bool isValid = false;
+    std::uint32_t frames = 0;
+    std::size_t cursor = 0;
+    InputSystem::Snapshot current;
+};
@@ -1,9 +1,13 @@
 #include "input_system.h"
 
+#include <iostream>
+
 InputSystem *InputSystem::instance = nullptr;
 
 InputSystem::InputSystem(GLFWwindow *window) : window(window)
 {
+    if (window == nullptr)
+        return;
     instance = this;
 
     // Initialize mouse position from current cursor to avoid first-frame jump
@@ -27,13 +31,7 @@ InputSystem::~InputSystem()
 
 void InputSystem::update()
 {
-    // Snapshot key state
-    previousKeys = currentKeys;
-    currentKeys = liveKeys;
-
-    // Snapshot mouse button state
-    previousMouseButtons = currentMouseButtons;
-    currentMouseButtons = liveMouseButtons;
+    advance(liveKeys, liveMouseButtons);
 
     // Compute mouse delta
     mouseDelta = mousePos - lastMousePos;
@@ -44,38 +42,80 @@ void InputSystem::update()
     scrollAccumulator = {0.0f, 0.0f};
 }
 
-// --- Action mapping ---
-
-void InputSystem::createAction(const std::string &name, std::vector<int> keys)
+void InputSystem::update(const Snapshot &replayed)
 {
-    actions[name] = std::move(keys);
-}
+    advance(replayed.keys, replayed.mouseButtons);
 
-bool InputSystem::isActionPressed(const std::string &name) const
-{
-    auto it = actions.find(name);
-    if (it == actions.end()) return false;
-    for (int key : it->second)
-        if (isKeyPressed(key)) return true;
-    return false;
+    mouseDelta = replayed.mouseDelta;
+    scrollDelta = replayed.scrollDelta;
+    scrollAccumulator = {0.0f, 0.0f};
 }
 
-bool InputSystem::isActionJustPressed(const std::string &name) const
+void InputSystem::advance(const KeyBits &keys, const MouseButtonBits &mouseButtons)
 {
-    auto it = actions.find(name);
-    if (it == actions.end()) return false;
-    for (int key : it->second)
-        if (isKeyJustPressed(key)) return true;
-    return false;
+    justPressedKeys = keys & ~currentKeys;
+    justReleasedKeys = currentKeys & ~keys;
+    currentKeys = keys;
+
+    justPressedMouseButtons = mouseButtons & ~currentMouseButtons;
+    justReleasedMouseButtons = currentMouseButtons & ~mouseButtons;
+    currentMouseButtons = mouseButtons;
+
+    // every query this frame becomes a bit test; with no key edges they are last frame's
+    actionJustPressed = actionJustReleased = 0;
+    if (justPressedKeys.none() && justReleasedKeys.none())
+        return;
+    actionPressed = 0;
+    for (std::size_t i = 0; i < actions.size(); i++)
+    {
+        const KeyBits &mask = actions[i].keys;
+        actionPressed |= (std::uint64_t)(mask & currentKeys).any() << i;
+        actionJustPressed |= (std::uint64_t)(mask & justPressedKeys).any() << i;
+        actionJustReleased |= (std::uint64_t)(mask & justReleasedKeys).any() << i;
+    }
 }
 
-bool InputSystem::isActionJustReleased(const std::string &name) const
-{
-    auto it = actions.find(name);
-    if (it == actions.end()) return false;
-    for (int key : it->second)
-        if (isKeyJustReleased(key)) return true;
-    return false;
+// --- Action mapping ---
+
+ActionId InputSystem::createAction(const std::string &name, const std::vector<int> &keys)
+{
+    ActionId id = findAction(name);
+    if (id == NO_ACTION)
+    {
+        if (actions.size() == MAX_ACTIONS)
+        {
+            std::cout << "ERROR::INPUT::TOO_MANY_ACTIONS " << name << std::endl;
+            return NO_ACTION;
+        }
+        id = (ActionId)actions.size();
+        actions.push_back({ name, {} });
+    }
+
+    KeyBits &mask = actions[id].keys;
+    mask.reset();
+    for (int key : keys)
+    {
+        if (key >= 0 && key < KEY_COUNT)
+            mask.set(key);
+    }
+
+    // advance() only recomputes on key edges, so a key already held must count right away;
+    // a rebind is not an edge, so the just-pressed/released bits stay as they are
+    if ((mask & currentKeys).any())
+        actionPressed |= actionBit(id);
+    else
+        actionPressed &= ~actionBit(id);
+    return id;
+}
+
+ActionId InputSystem::findAction(std::string_view name) const
+{
+    for (std::size_t i = 0; i < actions.size(); i++)
+    {
+        if (actions[i].name == name)
+            return (ActionId)i;
+    }
+    return NO_ACTION;
 }
 
 // --- Raw key queries ---
@@ -89,13 +129,13 @@ bool InputSystem::isKeyPressed(int key) const
 bool InputSystem::isKeyJustPressed(int key) const
 {
     if (key < 0 || key >= KEY_COUNT) return false;
-    return currentKeys[key] && !previousKeys[key];
+    return justPressedKeys[key];
 }
 
 bool InputSystem::isKeyJustReleased(int key) const
 {
     if (key < 0 || key >= KEY_COUNT) return false;
-    return !currentKeys[key] && previousKeys[key];
+    return justReleasedKeys[key];
 }
 
 // --- Mouse button queries ---
@@ -109,13 +149,13 @@ bool InputSystem::isMouseButtonPressed(int button) const
 bool InputSystem::isMouseButtonJustPressed(int button) const
 {
     if (button < 0 || button >= MOUSE_BUTTON_COUNT) return false;
-    return currentMouseButtons[button] && !previousMouseButtons[button];
+    return justPressedMouseButtons[button];
 }
 
 bool InputSystem::isMouseButtonJustReleased(int button) const
 {
     if (button < 0 || button >= MOUSE_BUTTON_COUNT) return false;
-    return !currentMouseButtons[button] && previousMouseButtons[button];
+    return justReleasedMouseButtons[button];
 }
 
 // --- GLFW callbacks (static) ---
@@ -124,18 +164,18 @@ void InputSystem::keyCallback(GLFWwindow *window, int key, int scancode, int act
 {
     if (!instance || key < 0 || key >= KEY_COUNT) return;
     if (action == GLFW_PRESS)
-        instance->liveKeys[key] = true;
+        instance->liveKeys.set(key);
     else if (action == GLFW_RELEASE)
-        instance->liveKeys[key] = false;
+        instance->liveKeys.reset(key);
 }
 
 void InputSystem::mouseButtonCallback(GLFWwindow *window, int button, int action, int mods)
 {
     if (!instance || button < 0 || button >= MOUSE_BUTTON_COUNT) return;
     if (action == GLFW_PRESS)
-        instance->liveMouseButtons[button] = true;
+        instance->liveMouseButtons.set(button);
     else if (action == GLFW_RELEASE)
-        instance->liveMouseButtons[button] = false;
+        instance->liveMouseButtons.reset(button);
 }
 
 void InputSystem::cursorPosCallback(GLFWwindow *window, double xPos, double yPos)
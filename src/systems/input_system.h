@@ -1,16 +1,38 @@
 #pragma once
 
-#include <array>
+#include <bitset>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+// Index of an action, handed out by createAction(); queries with it are a single bit test.
+using ActionId = std::uint8_t;
+
 class InputSystem
 {
 public:
+    static constexpr int KEY_COUNT = GLFW_KEY_LAST + 1;
+    static constexpr int MOUSE_BUTTON_COUNT = 8;
+    static constexpr ActionId MAX_ACTIONS = 64; // one machine word of action state
+    static constexpr ActionId NO_ACTION = MAX_ACTIONS;
+
+    using KeyBits = std::bitset<KEY_COUNT>;
+    using MouseButtonBits = std::bitset<MOUSE_BUTTON_COUNT>;
+
+    // One frame of input as update() snapshots it; what InputRecorder logs and InputReplay feeds back.
+    struct Snapshot
+    {
+        KeyBits keys;
+        MouseButtonBits mouseButtons;
+        glm::vec2 mouseDelta{0.0f};
+        glm::vec2 scrollDelta{0.0f};
+    };
+
+    // Without a window there are no devices; input then only arrives through update(Snapshot).
     explicit InputSystem(GLFWwindow *window);
     ~InputSystem();
 
@@ -20,12 +42,17 @@ public:
     InputSystem &operator=(InputSystem &&) = delete;
 
     void update();
-
-    // Action mapping
-    void createAction(const std::string &name, std::vector<int> keys);
-    bool isActionPressed(const std::string &name) const;
-    bool isActionJustPressed(const std::string &name) const;
-    bool isActionJustReleased(const std::string &name) const;
+    // Advances to a recorded frame instead of the live devices, which are ignored.
+    void update(const Snapshot &replayed);
+    Snapshot snapshot() const { return { currentKeys, currentMouseButtons, mouseDelta, scrollDelta }; }
+
+    // Action mapping. Resolve names to ids once, at registration; registering a name again
+    // rebinds its keys and keeps its id. NO_ACTION once MAX_ACTIONS are taken.
+    ActionId createAction(const std::string &name, const std::vector<int> &keys);
+    ActionId findAction(std::string_view name) const;
+    bool isActionPressed(ActionId action) const { return actionPressed & actionBit(action); }
+    bool isActionJustPressed(ActionId action) const { return actionJustPressed & actionBit(action); }
+    bool isActionJustReleased(ActionId action) const { return actionJustReleased & actionBit(action); }
 
     // Raw key queries
     bool isKeyPressed(int key) const;
@@ -45,20 +72,20 @@ public:
     glm::vec2 getScrollDelta() const { return scrollDelta; }
 
 private:
-    static constexpr int KEY_COUNT = GLFW_KEY_LAST + 1;
-    static constexpr int MOUSE_BUTTON_COUNT = 8;
-
     GLFWwindow *window;
 
-    // Key state: callbacks write to live, update() snapshots to current/previous
-    std::array<bool, KEY_COUNT> liveKeys{};
-    std::array<bool, KEY_COUNT> currentKeys{};
-    std::array<bool, KEY_COUNT> previousKeys{};
+    // Key state: callbacks write to live, update() snapshots to current and derives the edges
+    // a word at a time
+    KeyBits liveKeys;
+    KeyBits currentKeys;
+    KeyBits justPressedKeys;
+    KeyBits justReleasedKeys;
 
     // Mouse button state
-    std::array<bool, MOUSE_BUTTON_COUNT> liveMouseButtons{};
-    std::array<bool, MOUSE_BUTTON_COUNT> currentMouseButtons{};
-    std::array<bool, MOUSE_BUTTON_COUNT> previousMouseButtons{};
+    MouseButtonBits liveMouseButtons;
+    MouseButtonBits currentMouseButtons;
+    MouseButtonBits justPressedMouseButtons;
+    MouseButtonBits justReleasedMouseButtons;
 
     // Mouse position
     glm::vec2 mousePos{0.0f};
@@ -69,12 +96,25 @@ private:
     glm::vec2 scrollAccumulator{0.0f};
     glm::vec2 scrollDelta{0.0f};
 
-    // Action map: action name -> list of GLFW key codes
-    std::unordered_map<std::string, std::vector<int>> actions;
+    // Actions, indexed by id; each one's keys as a mask over the key bits
+    struct Action
+    {
+        std::string name;
+        KeyBits keys;
+    };
+    std::vector<Action> actions;
+
+    // one bit per action, recomputed by update()
+    std::uint64_t actionPressed = 0;
+    std::uint64_t actionJustPressed = 0;
+    std::uint64_t actionJustReleased = 0;
 
     // Static instance for GLFW callbacks
     static InputSystem *instance;
 
+    static std::uint64_t actionBit(ActionId action) { return action < MAX_ACTIONS ? 1ull << action : 0; }
+    void advance(const KeyBits &keys, const MouseButtonBits &mouseButtons);
+
     static void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
     static void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods);
     static void cursorPosCallback(GLFWwindow *window, double xPos, double yPos);
@@ -0,0 +1,274 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+    constexpr std::uint32_t DROPPED = ~0u;
+    constexpr std::size_t INITIAL_CAPTURE_EVENTS = 1 << 16;
+
+    void record(std::vector<float> &history, unsigned int &count, float value)
+    {
+        history[count % Profiler::HISTORY_FRAMES] = value;
+        count++;
+    }
+
+    void percentiles(const std::vector<float> &history, unsigned int count, float &p50, float &p95, float &p99)
+    {
+        std::vector<float> samples(history.begin(), history.begin() + std::min(count, Profiler::HISTORY_FRAMES));
+        if (samples.empty())
+            return;
+        auto at = [&samples](float fraction) {
+            auto rank = (std::size_t)(fraction * (float)(samples.size() - 1) + 0.5f);
+            std::nth_element(samples.begin(), samples.begin() + (std::ptrdiff_t)rank, samples.end());
+            return samples[rank];
+        };
+        p50 = at(0.50f);
+        p95 = at(0.95f);
+        p99 = at(0.99f);
+    }
+
+    void writeEscaped(std::ostream &out, const std::string &text)
+    {
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\';
+            if ((unsigned char)c >= 0x20)
+                out << c;
+        }
+    }
+}
+
+Profiler::Profiler()
+    : epoch(std::chrono::steady_clock::now())
+{
+    for (FrameSlot &slot : slots)
+    {
+        slot.events.reserve(MAX_EVENTS_PER_FRAME);
+        slot.queries.reserve(MAX_QUERIES_PER_FRAME);
+        for (unsigned int i = 0; i < MAX_QUERIES_PER_FRAME; i++)
+            slot.queries.push_back(GLQuery::create());
+    }
+    zone("frame");
+}
+
+ProfileZoneId Profiler::zone(std::string name, bool gpu)
+{
+    Zone &zone = zones.emplace_back();
+    zone.name = std::move(name);
+    zone.gpu = gpu;
+    zone.cpuHistory.resize(HISTORY_FRAMES);
+    zone.gpuHistory.resize(HISTORY_FRAMES);
+    return (ProfileZoneId)(zones.size() - 1);
+}
+
+void Profiler::beginFrame()
+{
+    if (current != nullptr)
+        endFrame();
+
+    // this slot was last used FRAME_LATENCY frames ago, so its queries have had time to land
+    FrameSlot &slot = slots[frameIndex % FRAME_LATENCY];
+    if (slot.pending)
+        resolve(slot);
+    slot.events.clear();
+    slot.queriesUsed = 0;
+    current = &slot;
+    depth = 0;
+    overflowDepth = 0;
+    gpuQueryOpen = false;
+    begin(FRAME_ZONE);
+}
+
+void Profiler::endFrame()
+{
+    if (current == nullptr)
+        return;
+    while (depth > 0) // closes anything left open along with the frame zone
+        end();
+    current->pending = true;
+    current = nullptr;
+    frameIndex++;
+}
+
+void Profiler::begin(ProfileZoneId zone)
+{
+    if (current == nullptr)
+        return;
+    if (depth == MAX_DEPTH)
+    {
+        overflowDepth++;
+        return;
+    }
+    if (current->events.size() == MAX_EVENTS_PER_FRAME)
+    {
+        openEvents[depth++] = DROPPED;
+        return;
+    }
+
+    Event event{ now(), 0, zone, (std::uint16_t)depth, -1 };
+    if (zones[zone].gpu && !gpuQueryOpen && current->queriesUsed < MAX_QUERIES_PER_FRAME)
+    {
+        event.query = (std::int32_t)current->queriesUsed++;
+        glBeginQuery(GL_TIME_ELAPSED, current->queries[event.query].get());
+        gpuQueryOpen = true;
+    }
+    openEvents[depth++] = (std::uint32_t)current->events.size();
+    current->events.push_back(event);
+}
+
+void Profiler::end()
+{
+    if (current == nullptr || depth == 0)
+        return;
+    if (overflowDepth > 0)
+    {
+        overflowDepth--;
+        return;
+    }
+
+    std::uint32_t index = openEvents[--depth];
+    if (index == DROPPED)
+        return;
+    Event &event = current->events[index];
+    if (event.query >= 0)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        gpuQueryOpen = false;
+    }
+    event.cpuEnd = now();
+}
+
+ProfileZoneStats Profiler::stats(ProfileZoneId zone) const
+{
+    const Zone &data = zones[zone];
+    ProfileZoneStats stats;
+    stats.samples = std::min(data.cpuCount, HISTORY_FRAMES);
+    stats.gpuSamples = std::min(data.gpuCount, HISTORY_FRAMES);
+    percentiles(data.cpuHistory, data.cpuCount, stats.cpuP50, stats.cpuP95, stats.cpuP99);
+    percentiles(data.gpuHistory, data.gpuCount, stats.gpuP50, stats.gpuP95, stats.gpuP99);
+    return stats;
+}
+
+void Profiler::printSummary() const
+{
+    std::cout << "profiler: ms per frame p50/p95/p99 over the last " << HISTORY_FRAMES << " frames, " << lateFrames
+        << " frames with late GPU results" << std::fixed << std::setprecision(2) << std::endl;
+    for (ProfileZoneId id = 0; id < zones.size(); id++)
+    {
+        ProfileZoneStats zone = stats(id);
+        if (zone.samples == 0)
+            continue;
+        std::cout << "  " << std::left << std::setw(24) << zones[id].name << std::right << "cpu " << zone.cpuP50 << "/"
+            << zone.cpuP95 << "/" << zone.cpuP99;
+        if (zone.gpuSamples > 0)
+            std::cout << "  gpu " << zone.gpuP50 << "/" << zone.gpuP95 << "/" << zone.gpuP99;
+        std::cout << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+void Profiler::startCapture()
+{
+    capture.clear();
+    capture.reserve(INITIAL_CAPTURE_EVENTS);
+    isCapturing = true;
+}
+
+bool Profiler::stopCapture(const std::string &path)
+{
+    // pull in the frames still waiting on their GPU results, oldest first
+    for (std::uint64_t frame = frameIndex - std::min<std::uint64_t>(frameIndex, FRAME_LATENCY); frame < frameIndex;
+         frame++)
+    {
+        FrameSlot &slot = slots[frame % FRAME_LATENCY];
+        if (slot.pending && &slot != current)
+            resolve(slot);
+    }
+    isCapturing = false;
+
+    std::error_code error;
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty())
+        std::filesystem::create_directories(parent, error);
+
+    std::ofstream out(path, std::ios::trunc);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    out << std::fixed << std::setprecision(3);
+    for (const TraceEvent &event : capture)
+    {
+        out << ",\n{\"name\":\"";
+        writeEscaped(out, zones[event.zone].name);
+        out << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"ts\":" << event.begin / 1000.0
+            << ",\"dur\":" << event.duration / 1000.0 << ",\"pid\":1,\"tid\":" << (event.gpu ? 2 : 1) << "}";
+    }
+    out << "\n]}\n";
+    std::vector<TraceEvent>().swap(capture);
+    return (bool)out;
+}
+
+std::uint64_t Profiler::now() const
+{
+    return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::resolve(FrameSlot &slot)
+{
+    // queries finish in order, so the last one being available means they all are
+    bool gpuReady = true;
+    if (slot.queriesUsed > 0)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(slot.queries[slot.queriesUsed - 1].get(), GL_QUERY_RESULT_AVAILABLE, &available);
+        gpuReady = available != 0;
+        if (!gpuReady)
+            lateFrames++;
+    }
+
+    for (Zone &zone : zones)
+    {
+        zone.cpuFrame = zone.gpuFrame = 0.0f;
+        zone.ran = zone.timedOnGpu = false;
+    }
+
+    std::uint64_t gpuCursor = 0;
+    for (const Event &event : slot.events)
+    {
+        Zone &zone = zones[event.zone];
+        std::uint64_t cpuTime = event.cpuEnd - event.cpuBegin;
+        zone.cpuFrame += (float)cpuTime * 1e-6f;
+        zone.ran = true;
+        if (isCapturing && capture.size() < MAX_CAPTURE_EVENTS)
+            capture.push_back({ event.cpuBegin, cpuTime, event.zone, false });
+
+        if (event.query < 0 || !gpuReady)
+            continue;
+        GLuint64 gpuTime = 0;
+        glGetQueryObjectui64v(slot.queries[event.query].get(), GL_QUERY_RESULT, &gpuTime);
+        zone.gpuFrame += (float)gpuTime * 1e-6f;
+        zone.timedOnGpu = true;
+        if (isCapturing && capture.size() < MAX_CAPTURE_EVENTS)
+        {
+            std::uint64_t begin = std::max(event.cpuBegin, gpuCursor);
+            capture.push_back({ begin, gpuTime, event.zone, true });
+            gpuCursor = begin + gpuTime;
+        }
+    }
+
+    for (Zone &zone : zones)
+    {
+        if (zone.ran)
+            record(zone.cpuHistory, zone.cpuCount, zone.cpuFrame);
+        if (zone.timedOnGpu)
+            record(zone.gpuHistory, zone.gpuCount, zone.gpuFrame);
+    }
+    slot.pending = false;
+}
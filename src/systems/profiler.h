@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "render/gl_handle.h"
+
+using ProfileZoneId = std::uint16_t;
+constexpr ProfileZoneId NO_PROFILE_ZONE = 0xFFFF;
+
+// Rolling percentiles of a zone's time per frame, summed over every time it ran in the frame.
+struct ProfileZoneStats
+{
+    unsigned int samples = 0;
+    float cpuP50 = 0.0f, cpuP95 = 0.0f, cpuP99 = 0.0f; // ms
+    unsigned int gpuSamples = 0;
+    float gpuP50 = 0.0f, gpuP95 = 0.0f, gpuP99 = 0.0f; // ms
+};
+
+// Frame profiler combining scoped CPU zones with GL_TIME_ELAPSED queries for zones that ask
+// for GPU time. Queries come from a ring of per-frame pools and are read FRAME_LATENCY
+// frames later, and only if the driver already has them, so profiling never stalls the
+// pipeline; frames whose results are late just lose their GPU times.
+//
+// Timer queries cannot nest, so a GPU zone opened inside another one is timed on the CPU
+// only. Zones are registered once up front; begin()/end() do not allocate. GL thread only.
+class Profiler
+{
+public:
+    static constexpr unsigned int FRAME_LATENCY = 4;
+    static constexpr unsigned int HISTORY_FRAMES = 240;
+    static constexpr unsigned int MAX_EVENTS_PER_FRAME = 1024;
+    static constexpr unsigned int MAX_QUERIES_PER_FRAME = 128;
+    static constexpr unsigned int MAX_DEPTH = 16;
+    static constexpr std::size_t MAX_CAPTURE_EVENTS = 1 << 20;
+
+    static constexpr ProfileZoneId FRAME_ZONE = 0; // from beginFrame() to endFrame()
+
+    // Needs a current GL context for the query pools.
+    Profiler();
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    ProfileZoneId zone(std::string name, bool gpu = false);
+    const std::string &zoneName(ProfileZoneId zone) const { return zones[zone].name; }
+    std::size_t zoneCount() const { return zones.size(); }
+
+    void beginFrame();
+    void endFrame();
+
+    void begin(ProfileZoneId zone);
+    void end(); // closes the innermost open zone
+
+    ProfileZoneStats stats(ProfileZoneId zone) const;
+    void printSummary() const;
+    unsigned int lateGpuFrames() const { return lateFrames; }
+
+    // Records every resolved event until stopCapture() or MAX_CAPTURE_EVENTS.
+    void startCapture();
+    bool capturing() const { return isCapturing; }
+    // Writes the capture in Chrome's trace-event JSON (chrome://tracing, ui.perfetto.dev).
+    // GPU events go on their own track; only their durations are measured, so each is
+    // placed at its CPU submission time or right after the previous one.
+    bool stopCapture(const std::string &path);
+
+private:
+    struct Zone
+    {
+        std::string name;
+        bool gpu;
+        std::vector<float> cpuHistory; // ms per frame, ring of HISTORY_FRAMES
+        std::vector<float> gpuHistory;
+        unsigned int cpuCount = 0;
+        unsigned int gpuCount = 0;
+        // totals of the frame being resolved
+        float cpuFrame = 0.0f;
+        float gpuFrame = 0.0f;
+        bool ran = false;
+        bool timedOnGpu = false;
+    };
+
+    struct Event
+    {
+        std::uint64_t cpuBegin; // ns since the profiler was created
+        std::uint64_t cpuEnd;
+        ProfileZoneId zone;
+        std::uint16_t depth;
+        std::int32_t query; // index into the frame's pool, -1 for CPU-only
+    };
+
+    struct FrameSlot
+    {
+        std::vector<Event> events;
+        std::vector<GLQuery> queries;
+        unsigned int queriesUsed = 0;
+        bool pending = false;
+    };
+
+    struct TraceEvent
+    {
+        std::uint64_t begin; // ns
+        std::uint64_t duration;
+        ProfileZoneId zone;
+        bool gpu;
+    };
+
+    std::vector<Zone> zones;
+    std::array<FrameSlot, FRAME_LATENCY> slots;
+    std::uint64_t frameIndex = 0;
+    FrameSlot *current = nullptr;
+    std::array<std::uint32_t, MAX_DEPTH> openEvents{};
+    unsigned int depth = 0;
+    unsigned int overflowDepth = 0; // zones opened past MAX_DEPTH, ignored
+    bool gpuQueryOpen = false;
+    unsigned int lateFrames = 0;
+    std::chrono::steady_clock::time_point epoch;
+
+    std::vector<TraceEvent> capture;
+    bool isCapturing = false;
+
+    std::uint64_t now() const;
+    void resolve(FrameSlot &slot);
+};
+
+// Opens a zone for the rest of the enclosing scope.
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler &profiler, ProfileZoneId zone) : profiler(profiler) { profiler.begin(zone); }
+    ~ProfileScope() { profiler.end(); }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    Profiler &profiler;
+};
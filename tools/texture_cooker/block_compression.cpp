@@ -0,0 +1,560 @@
+#include "block_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    constexpr int BLOCK_TEXELS = 16;
+
+    // BC7 4-bit index interpolation weights, out of 64
+    constexpr int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    float clampChannel(float value)
+    {
+        return std::clamp(value, 0.0f, 255.0f);
+    }
+
+    // Endpoints at the extreme projections of the texels onto their axis of greatest
+    // variance, found by power iteration on the covariance matrix.
+    void fitPrincipalAxis(const std::uint8_t *texels, int channels, float lo[4], float hi[4])
+    {
+        float mean[4] = {};
+        for (int i = 0; i < BLOCK_TEXELS; i++)
+            for (int c = 0; c < channels; c++)
+                mean[c] += texels[i * 4 + c];
+        for (int c = 0; c < channels; c++)
+            mean[c] /= BLOCK_TEXELS;
+
+        float covariance[4][4] = {};
+        for (int i = 0; i < BLOCK_TEXELS; i++)
+            for (int a = 0; a < channels; a++)
+                for (int b = 0; b < channels; b++)
+                    covariance[a][b] += (texels[i * 4 + a] - mean[a]) * (texels[i * 4 + b] - mean[b]);
+
+        // start from the covariance column with the most energy, so anti-correlated channels still converge
+        int start = 0;
+        for (int c = 1; c < channels; c++)
+            if (covariance[c][c] > covariance[start][start])
+                start = c;
+        float axis[4] = {};
+        for (int c = 0; c < channels; c++)
+            axis[c] = covariance[c][start];
+
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {};
+            float length = 0.0f;
+            for (int a = 0; a < channels; a++)
+            {
+                for (int b = 0; b < channels; b++)
+                    next[a] += covariance[a][b] * axis[b];
+                length += next[a] * next[a];
+            }
+            if (length < 1e-12f)
+                break;
+            length = std::sqrt(length);
+            for (int c = 0; c < channels; c++)
+                axis[c] = next[c] / length;
+        }
+
+        float minT = 0.0f, maxT = 0.0f;
+        for (int i = 0; i < BLOCK_TEXELS; i++)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < channels; c++)
+                t += (texels[i * 4 + c] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        for (int c = 0; c < channels; c++)
+        {
+            lo[c] = clampChannel(mean[c] + axis[c] * minT);
+            hi[c] = clampChannel(mean[c] + axis[c] * maxT);
+        }
+    }
+
+    // Least-squares endpoints for fixed per-texel weights (weight = share of the second endpoint).
+    bool refineEndpoints(const std::uint8_t *texels, int channels, const float *weights, float e0[4], float e1[4])
+    {
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+        float ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < BLOCK_TEXELS; i++)
+        {
+            float b = weights[i], a = 1.0f - b;
+            aa += a * a;
+            bb += b * b;
+            ab += a * b;
+            for (int c = 0; c < channels; c++)
+            {
+                ax[c] += a * texels[i * 4 + c];
+                bx[c] += b * texels[i * 4 + c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f)
+            return false;
+
+        for (int c = 0; c < channels; c++)
+        {
+            e0[c] = clampChannel((ax[c] * bb - bx[c] * ab) / determinant);
+            e1[c] = clampChannel((bx[c] * aa - ax[c] * ab) / determinant);
+        }
+        return true;
+    }
+
+    int squaredError(const std::uint8_t *texel, const int *color, int channels)
+    {
+        int error = 0;
+        for (int c = 0; c < channels; c++)
+        {
+            int d = texel[c] - color[c];
+            error += d * d;
+        }
+        return error;
+    }
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::uint8_t *out, std::size_t bytes) : out(out) { std::memset(out, 0, bytes); }
+
+        void write(std::uint32_t value, int bits)
+        {
+            for (int b = 0; b < bits; b++, position++)
+                if ((value >> b) & 1)
+                    out[position >> 3] |= (std::uint8_t)(1u << (position & 7));
+        }
+
+    private:
+        std::uint8_t *out;
+        int position = 0;
+    };
+
+    class BitReader
+    {
+    public:
+        explicit BitReader(const std::uint8_t *in) : in(in) {}
+
+        std::uint32_t read(int bits)
+        {
+            std::uint32_t value = 0;
+            for (int b = 0; b < bits; b++, position++)
+                value |= (std::uint32_t)((in[position >> 3] >> (position & 7)) & 1) << b;
+            return value;
+        }
+
+    private:
+        const std::uint8_t *in;
+        int position = 0;
+    };
+
+    /* BC1 */
+
+    std::uint16_t to565(const float *color)
+    {
+        auto r = (std::uint16_t)std::lround(color[0] * 31.0f / 255.0f);
+        auto g = (std::uint16_t)std::lround(color[1] * 63.0f / 255.0f);
+        auto b = (std::uint16_t)std::lround(color[2] * 31.0f / 255.0f);
+        return (std::uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    void from565(std::uint16_t value, int *color)
+    {
+        int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    struct Bc1Block
+    {
+        std::uint16_t color0;
+        std::uint16_t color1;
+        std::uint32_t indices;
+        int error;
+    };
+
+    // Four-colour mode needs color0 > color1; equal endpoints would select the
+    // three-colour mode, where index 3 is transparent black, so they use index 0 only.
+    Bc1Block encodeBc1Indices(const std::uint8_t *texels, std::uint16_t color0, std::uint16_t color1)
+    {
+        if (color0 < color1)
+            std::swap(color0, color1);
+
+        int palette[4][3];
+        from565(color0, palette[0]);
+        from565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        int usable = color0 == color1 ? 1 : 4;
+
+        Bc1Block block{ color0, color1, 0, 0 };
+        for (int i = 0; i < BLOCK_TEXELS; i++)
+        {
+            int best = 0, bestError = squaredError(texels + i * 4, palette[0], 3);
+            for (int j = 1; j < usable; j++)
+            {
+                int error = squaredError(texels + i * 4, palette[j], 3);
+                if (error < bestError)
+                {
+                    best = j;
+                    bestError = error;
+                }
+            }
+            block.indices |= (std::uint32_t)best << (i * 2);
+            block.error += bestError;
+        }
+        return block;
+    }
+
+    void writeBc1(const Bc1Block &block, std::uint8_t *out)
+    {
+        out[0] = (std::uint8_t)(block.color0 & 0xFF);
+        out[1] = (std::uint8_t)(block.color0 >> 8);
+        out[2] = (std::uint8_t)(block.color1 & 0xFF);
+        out[3] = (std::uint8_t)(block.color1 >> 8);
+        for (int b = 0; b < 4; b++)
+            out[4 + b] = (std::uint8_t)(block.indices >> (b * 8));
+    }
+
+    /* BC3 alpha (the BC4 layout) */
+
+    void encodeAlphaBlock(const std::uint8_t *texels, std::uint8_t *out)
+    {
+        int alphaMin = 255, alphaMax = 0;
+        for (int i = 0; i < BLOCK_TEXELS; i++)
+        {
+            alphaMin = std::min<int>(alphaMin, texels[i * 4 + 3]);
+            alphaMax = std::max<int>(alphaMax, texels[i * 4 + 3]);
+        }
+
+        // alpha0 > alpha1 selects eight interpolated values, both extremes included
+        int palette[8] = { alphaMax, alphaMin };
+        for (int k = 1; k <= 6; k++)
+            palette[k + 1] = ((7 - k) * alphaMax + k * alphaMin) / 7;
+
+        std::uint64_t indices = 0;
+        if (alphaMax != alphaMin)
+        {
+            for (int i = 0; i < BLOCK_TEXELS; i++)
+            {
+                int alpha = texels[i * 4 + 3];
+                int best = 0;
+                for (int j = 1; j < 8; j++)
+                    if (std::abs(palette[j] - alpha) < std::abs(palette[best] - alpha))
+                        best = j;
+                indices |= (std::uint64_t)best << (i * 3);
+            }
+        }
+
+        out[0] = (std::uint8_t)alphaMax;
+        out[1] = (std::uint8_t)alphaMin;
+        for (int b = 0; b < 6; b++)
+            out[2 + b] = (std::uint8_t)(indices >> (b * 8));
+    }
+
+    void decodeAlphaBlock(const std::uint8_t *block, std::uint8_t *texels)
+    {
+        int palette[8] = { block[0], block[1] };
+        if (palette[0] > palette[1])
+        {
+            for (int k = 1; k <= 6; k++)
+                palette[k + 1] = ((7 - k) * palette[0] + k * palette[1]) / 7;
+        }
+        else
+        {
+            for (int k = 1; k <= 4; k++)
+                palette[k + 1] = ((5 - k) * palette[0] + k * palette[1]) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        std::uint64_t indices = 0;
+        for (int b = 0; b < 6; b++)
+            indices |= (std::uint64_t)block[2 + b] << (b * 8);
+        for (int i = 0; i < BLOCK_TEXELS; i++)
+            texels[i * 4 + 3] = (std::uint8_t)palette[(indices >> (i * 3)) & 7];
+    }
+
+    /* BC7 mode 6: one subset, RGBA 7-bit endpoints with a p-bit each, 4-bit indices */
+
+    void quantizeBc7Endpoint(const float *endpoint, int *quantized, int &pBit)
+    {
+        int bestError = -1;
+        for (int p = 0; p < 2; p++)
+        {
+            int candidate[4];
+            int error = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                candidate[c] = std::clamp((int)std::lround((endpoint[c] - (float)p) / 2.0f), 0, 127);
+                float d = (float)(candidate[c] * 2 + p) - endpoint[c];
+                error += (int)(d * d);
+            }
+            if (bestError < 0 || error < bestError)
+            {
+                bestError = error;
+                pBit = p;
+                std::copy(candidate, candidate + 4, quantized);
+            }
+        }
+    }
+
+    struct Bc7Block
+    {
+        int endpoint0[4], endpoint1[4]; // 7-bit
+        int pBit0, pBit1;
+        int indices[BLOCK_TEXELS];
+        int error;
+    };
+
+    Bc7Block encodeBc7Indices(const std::uint8_t *texels, const float *e0, const float *e1)
+    {
+        Bc7Block block{};
+        quantizeBc7Endpoint(e0, block.endpoint0, block.pBit0);
+        quantizeBc7Endpoint(e1, block.endpoint1, block.pBit1);
+
+        int palette[16][4];
+        for (int k = 0; k < 16; k++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                int a = block.endpoint0[c] * 2 + block.pBit0;
+                int b = block.endpoint1[c] * 2 + block.pBit1;
+                palette[k][c] = ((64 - BC7_WEIGHTS[k]) * a + BC7_WEIGHTS[k] * b + 32) >> 6;
+            }
+        }
+
+        for (int i = 0; i < BLOCK_TEXELS; i++)
+        {
+            int best = 0, bestError = squaredError(texels + i * 4, palette[0], 4);
+            for (int k = 1; k < 16; k++)
+            {
+                int error = squaredError(texels + i * 4, palette[k], 4);
+                if (error < bestError)
+                {
+                    best = k;
+                    bestError = error;
+                }
+            }
+            block.indices[i] = best;
+            block.error += bestError;
+        }
+        return block;
+    }
+
+    void writeBc7Mode6(Bc7Block block, std::uint8_t *out)
+    {
+        // the anchor index is stored without its top bit, so it must be below 8
+        if (block.indices[0] >= 8)
+        {
+            std::swap(block.endpoint0, block.endpoint1);
+            std::swap(block.pBit0, block.pBit1);
+            for (int &index : block.indices)
+                index = 15 - index;
+        }
+
+        BitWriter bits(out, 16);
+        bits.write(1u << 6, 7); // mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            bits.write((std::uint32_t)block.endpoint0[c], 7);
+            bits.write((std::uint32_t)block.endpoint1[c], 7);
+        }
+        bits.write((std::uint32_t)block.pBit0, 1);
+        bits.write((std::uint32_t)block.pBit1, 1);
+        bits.write((std::uint32_t)block.indices[0], 3);
+        for (int i = 1; i < BLOCK_TEXELS; i++)
+            bits.write((std::uint32_t)block.indices[i], 4);
+    }
+
+    using BlockEncoder = void (*)(const std::uint8_t *, std::uint8_t *);
+    using BlockDecoder = void (*)(const std::uint8_t *, std::uint8_t *);
+}
+
+void encodeBc1Block(const std::uint8_t *texels, std::uint8_t *out)
+{
+    float lo[4], hi[4];
+    fitPrincipalAxis(texels, 3, lo, hi);
+    Bc1Block block = encodeBc1Indices(texels, to565(hi), to565(lo));
+
+    // one least-squares pass against the chosen indices, kept only if it helps
+    constexpr float WEIGHT_OF_COLOR1[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    float weights[BLOCK_TEXELS];
+    for (int i = 0; i < BLOCK_TEXELS; i++)
+        weights[i] = WEIGHT_OF_COLOR1[(block.indices >> (i * 2)) & 3];
+    float e0[4], e1[4];
+    if (block.error > 0 && refineEndpoints(texels, 3, weights, e0, e1))
+    {
+        Bc1Block refined = encodeBc1Indices(texels, to565(e0), to565(e1));
+        if (refined.error < block.error)
+            block = refined;
+    }
+    writeBc1(block, out);
+}
+
+void encodeBc3Block(const std::uint8_t *texels, std::uint8_t *out)
+{
+    encodeAlphaBlock(texels, out);
+    encodeBc1Block(texels, out + 8);
+}
+
+void encodeBc7Block(const std::uint8_t *texels, std::uint8_t *out)
+{
+    float lo[4], hi[4];
+    fitPrincipalAxis(texels, 4, lo, hi);
+    Bc7Block block = encodeBc7Indices(texels, lo, hi);
+
+    float weights[BLOCK_TEXELS];
+    for (int i = 0; i < BLOCK_TEXELS; i++)
+        weights[i] = BC7_WEIGHTS[block.indices[i]] / 64.0f;
+    float e0[4], e1[4];
+    if (block.error > 0 && refineEndpoints(texels, 4, weights, e0, e1))
+    {
+        Bc7Block refined = encodeBc7Indices(texels, e0, e1);
+        if (refined.error < block.error)
+            block = refined;
+    }
+    writeBc7Mode6(block, out);
+}
+
+void decodeBc1Block(const std::uint8_t *block, std::uint8_t *texels)
+{
+    auto color0 = (std::uint16_t)(block[0] | (block[1] << 8));
+    auto color1 = (std::uint16_t)(block[2] | (block[3] << 8));
+    int palette[4][4];
+    from565(color0, palette[0]);
+    from565(color1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+    for (int c = 0; c < 3; c++)
+    {
+        if (color0 > color1)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    if (color0 <= color1)
+        palette[3][3] = 0;
+
+    std::uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((std::uint32_t)block[7] << 24);
+    for (int i = 0; i < BLOCK_TEXELS; i++)
+    {
+        const int *color = palette[(indices >> (i * 2)) & 3];
+        for (int c = 0; c < 4; c++)
+            texels[i * 4 + c] = (std::uint8_t)color[c];
+    }
+}
+
+void decodeBc3Block(const std::uint8_t *block, std::uint8_t *texels)
+{
+    decodeBc1Block(block + 8, texels);
+    decodeAlphaBlock(block, texels);
+}
+
+void decodeBc7Block(const std::uint8_t *block, std::uint8_t *texels)
+{
+    // only mode 6 is ever written by the cooker; anything else decodes as black
+    BitReader bits(block);
+    if (bits.read(7) != (1u << 6))
+    {
+        std::memset(texels, 0, BLOCK_TEXELS * 4);
+        return;
+    }
+
+    int endpoint0[4], endpoint1[4];
+    for (int c = 0; c < 4; c++)
+    {
+        endpoint0[c] = (int)bits.read(7);
+        endpoint1[c] = (int)bits.read(7);
+    }
+    int pBit0 = (int)bits.read(1), pBit1 = (int)bits.read(1);
+    for (int i = 0; i < BLOCK_TEXELS; i++)
+    {
+        int index = (int)bits.read(i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; c++)
+        {
+            int a = endpoint0[c] * 2 + pBit0, b = endpoint1[c] * 2 + pBit1;
+            texels[i * 4 + c] = (std::uint8_t)(((64 - BC7_WEIGHTS[index]) * a + BC7_WEIGHTS[index] * b + 32) >> 6);
+        }
+    }
+}
+
+std::vector<std::byte> compressImage(const RgbaImage &image, TextureFormat format)
+{
+    if (format == TEXTURE_RGBA8)
+    {
+        const auto *bytes = (const std::byte *)image.pixels.data();
+        return { bytes, bytes + image.pixels.size() };
+    }
+
+    BlockEncoder encode = format == TEXTURE_BC1 ? encodeBc1Block : format == TEXTURE_BC3 ? encodeBc3Block : encodeBc7Block;
+    std::size_t blockSize = format == TEXTURE_BC1 ? 8 : 16;
+    std::vector<std::byte> result(TextureContainer::levelSize(format, image.width, image.height));
+
+    std::uint8_t texels[BLOCK_TEXELS * 4];
+    auto *out = (std::uint8_t *)result.data();
+    for (int blockY = 0; blockY < image.height; blockY += 4)
+    {
+        for (int blockX = 0; blockX < image.width; blockX += 4)
+        {
+            for (int y = 0; y < 4; y++)
+            {
+                int sourceY = std::min(blockY + y, image.height - 1);
+                for (int x = 0; x < 4; x++)
+                {
+                    int sourceX = std::min(blockX + x, image.width - 1);
+                    std::memcpy(texels + (y * 4 + x) * 4,
+                                image.pixels.data() + ((std::size_t)sourceY * image.width + sourceX) * 4, 4);
+                }
+            }
+            encode(texels, out);
+            out += blockSize;
+        }
+    }
+    return result;
+}
+
+RgbaImage decompressImage(const std::vector<std::byte> &data, int width, int height, TextureFormat format)
+{
+    RgbaImage image;
+    image.width = width;
+    image.height = height;
+    if (format == TEXTURE_RGBA8)
+    {
+        const auto *bytes = (const std::uint8_t *)data.data();
+        image.pixels.assign(bytes, bytes + data.size());
+        return image;
+    }
+
+    BlockDecoder decode = format == TEXTURE_BC1 ? decodeBc1Block : format == TEXTURE_BC3 ? decodeBc3Block : decodeBc7Block;
+    std::size_t blockSize = format == TEXTURE_BC1 ? 8 : 16;
+    image.pixels.resize((std::size_t)width * height * 4);
+
+    std::uint8_t texels[BLOCK_TEXELS * 4];
+    const auto *in = (const std::uint8_t *)data.data();
+    for (int blockY = 0; blockY < height; blockY += 4)
+    {
+        for (int blockX = 0; blockX < width; blockX += 4)
+        {
+            decode(in, texels);
+            in += blockSize;
+            for (int y = 0; y < 4 && blockY + y < height; y++)
+                for (int x = 0; x < 4 && blockX + x < width; x++)
+                    std::memcpy(image.pixels.data() + ((std::size_t)(blockY + y) * width + blockX + x) * 4,
+                                texels + (y * 4 + x) * 4, 4);
+        }
+    }
+    return image;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "render/texture_container.h"
+#include "mip_chain.h"
+
+// CPU block encoders for the texture cooker. Every encoder takes one 4x4 block of RGBA8
+// texels (64 bytes, row major) and writes one compressed block.
+void encodeBc1Block(const std::uint8_t *texels, std::uint8_t *out); // 8 bytes, alpha ignored
+void encodeBc3Block(const std::uint8_t *texels, std::uint8_t *out); // 16 bytes
+void encodeBc7Block(const std::uint8_t *texels, std::uint8_t *out); // 16 bytes, mode 6
+
+// The matching decoders, used to report the error the encoders introduced.
+void decodeBc1Block(const std::uint8_t *block, std::uint8_t *texels);
+void decodeBc3Block(const std::uint8_t *block, std::uint8_t *texels);
+void decodeBc7Block(const std::uint8_t *block, std::uint8_t *texels);
+
+// Compresses a whole image; edge blocks repeat the last row/column.
+std::vector<std::byte> compressImage(const RgbaImage &image, TextureFormat format);
+RgbaImage decompressImage(const std::vector<std::byte> &data, int width, int height, TextureFormat format);
@@ -0,0 +1,118 @@
+// Offline texture cooker: decodes a source image, builds its full mip chain and writes
+// it, optionally block compressed, as a container the engine uploads without decoding.
+//
+//     texture_cooker <source image> <output .tex> [--format auto|rgba8|bc1|bc3|bc7]
+//
+// "auto" picks BC1 for opaque images and BC3 when any texel has alpha below 255.
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <vector>
+#include <stb_image.h>
+
+#include "render/texture_container.h"
+#include "block_compression.h"
+#include "mip_chain.h"
+
+namespace
+{
+    bool parseFormat(std::string_view name, bool &automatic, TextureFormat &format)
+    {
+        automatic = name == "auto";
+        if (automatic || name == "rgba8")
+            format = TEXTURE_RGBA8;
+        else if (name == "bc1")
+            format = TEXTURE_BC1;
+        else if (name == "bc3")
+            format = TEXTURE_BC3;
+        else if (name == "bc7")
+            format = TEXTURE_BC7;
+        else
+            return false;
+        return true;
+    }
+
+    bool hasTranslucency(const RgbaImage &image)
+    {
+        for (std::size_t i = 3; i < image.pixels.size(); i += 4)
+            if (image.pixels[i] != 255)
+                return true;
+        return false;
+    }
+
+    double psnr(const RgbaImage &reference, const RgbaImage &decoded, int channels)
+    {
+        double squaredError = 0.0;
+        for (std::size_t i = 0; i < reference.pixels.size(); i += 4)
+            for (int c = 0; c < channels; c++)
+            {
+                double d = (double)reference.pixels[i + c] - decoded.pixels[i + c];
+                squaredError += d * d;
+            }
+        double mse = squaredError / ((double)reference.pixels.size() / 4 * channels);
+        return mse == 0.0 ? INFINITY : 10.0 * std::log10(255.0 * 255.0 / mse);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3 && !(argc == 5 && std::strcmp(argv[3], "--format") == 0))
+    {
+        std::cout << "usage: texture_cooker <source image> <output .tex> [--format auto|rgba8|bc1|bc3|bc7]" << std::endl;
+        return 1;
+    }
+
+    bool automatic = true;
+    TextureFormat format = TEXTURE_RGBA8;
+    if (argc == 5 && !parseFormat(argv[4], automatic, format))
+    {
+        std::cout << "ERROR::TEXTURE_COOKER::UNKNOWN_FORMAT " << argv[4] << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // same orientation as the runtime loader
+    stbi_set_flip_vertically_on_load(true);
+    RgbaImage base;
+    int nChannels;
+    unsigned char *data = stbi_load(argv[1], &base.width, &base.height, &nChannels, 4);
+    if (data == nullptr)
+    {
+        std::cout << "ERROR::TEXTURE_COOKER::LOAD_FAILED " << argv[1] << ": " << stbi_failure_reason() << std::endl;
+        return 1;
+    }
+    base.pixels.assign(data, data + (std::size_t)base.width * base.height * 4);
+    stbi_image_free(data);
+
+    if (automatic)
+        format = hasTranslucency(base) ? TEXTURE_BC3 : TEXTURE_BC1;
+
+    std::vector<RgbaImage> chain = buildMipChain(std::move(base));
+    std::vector<std::vector<std::byte>> levels;
+    std::size_t cookedBytes = 0, rawBytes = 0;
+    for (const RgbaImage &level : chain)
+    {
+        levels.push_back(compressImage(level, format));
+        cookedBytes += levels.back().size();
+        rawBytes += level.pixels.size() / 4 * (std::size_t)(nChannels == 4 ? 4 : 3);
+    }
+
+    if (!TextureContainer::write(argv[2], format, chain[0].width, chain[0].height, levels))
+    {
+        std::cout << "ERROR::TEXTURE_COOKER::WRITE_FAILED " << argv[2] << std::endl;
+        return 1;
+    }
+
+    RgbaImage decoded = decompressImage(levels[0], chain[0].width, chain[0].height, format);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << argv[1] << " -> " << argv[2] << ": " << TextureContainer::formatName(format) << ", "
+        << chain[0].width << "x" << chain[0].height << ", " << levels.size() << " levels, "
+        << cookedBytes << " bytes (" << (double)rawBytes / (double)cookedBytes << "x smaller than raw "
+        << (nChannels == 4 ? "RGBA8" : "RGB8") << "), PSNR " << psnr(chain[0], decoded, format == TEXTURE_BC1 ? 3 : 4)
+        << " dB, " << elapsed.count() << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "mip_chain.h"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define LEARN_OPENGL_HAS_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // Averages the 2x2 texels at (x0|x1, y0|y1) with rounding, one channel at a time.
+    void averageTexel(int x0, int x1, const std::uint8_t *row0, const std::uint8_t *row1,
+                      std::uint8_t *out)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            unsigned int sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+            out[c] = (std::uint8_t)((sum + 2) / 4);
+        }
+    }
+
+#ifdef LEARN_OPENGL_HAS_SSE
+    // Two output texels per step: 16 bytes from each source row, widened to 16 bits, summed
+    // vertically and then horizontally, rounded and packed back to bytes.
+    int downsampleRowSse(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *out, int outWidth)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi16(2);
+        int x = 0;
+        for (; x + 2 <= outWidth; x += 2)
+        {
+            __m128i top = _mm_loadu_si128((const __m128i *)(row0 + x * 8));
+            __m128i bottom = _mm_loadu_si128((const __m128i *)(row1 + x * 8));
+            __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+            __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+            _mm_storel_epi64((__m128i *)(out + x * 4), _mm_packus_epi16(sum, zero));
+        }
+        return x;
+    }
+#endif
+}
+
+RgbaImage downsample(const RgbaImage &source)
+{
+    RgbaImage result;
+    result.width = std::max(1, source.width / 2);
+    result.height = std::max(1, source.height / 2);
+    result.pixels.resize((std::size_t)result.width * result.height * 4);
+
+    for (int y = 0; y < result.height; y++)
+    {
+        int y0 = std::min(y * 2, source.height - 1);
+        int y1 = std::min(y * 2 + 1, source.height - 1);
+        const std::uint8_t *row0 = source.pixels.data() + (std::size_t)y0 * source.width * 4;
+        const std::uint8_t *row1 = source.pixels.data() + (std::size_t)y1 * source.width * 4;
+        std::uint8_t *out = result.pixels.data() + (std::size_t)y * result.width * 4;
+
+        int x = 0;
+#ifdef LEARN_OPENGL_HAS_SSE
+        // only pairs of complete 2x2 footprints; the odd edge column goes through the scalar path
+        x = downsampleRowSse(row0, row1, out, source.width / 2);
+#endif
+        for (; x < result.width; x++)
+        {
+            int x0 = std::min(x * 2, source.width - 1);
+            int x1 = std::min(x * 2 + 1, source.width - 1);
+            averageTexel(x0, x1, row0, row1, out + x * 4);
+        }
+    }
+    return result;
+}
+
+std::vector<RgbaImage> buildMipChain(RgbaImage base)
+{
+    std::vector<RgbaImage> chain;
+    chain.push_back(std::move(base));
+    while (chain.back().width > 1 || chain.back().height > 1)
+        chain.push_back(downsample(chain.back()));
+    return chain;
+}
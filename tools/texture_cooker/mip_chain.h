@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Tightly packed 8-bit RGBA pixels, rows top to bottom.
+struct RgbaImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> pixels;
+};
+
+// Box-filters down to 1x1; element 0 is the input. Odd edges repeat their last texel.
+std::vector<RgbaImage> buildMipChain(RgbaImage base);
+
+RgbaImage downsample(const RgbaImage &source);